@@ -0,0 +1,274 @@
+/*
+ * Tracepoints for the Sony laptop extras driver
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM sony_laptop
+
+#if !defined(_SONY_LAPTOP_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _SONY_LAPTOP_TRACE_H
+
+#include <linux/tracepoint.h>
+
+/* SNC handle calls through SN06/SN07 */
+TRACE_EVENT(sony_snc_call_entry,
+
+	TP_PROTO(const char *method, unsigned int handle, u64 argument),
+
+	TP_ARGS(method, handle, argument),
+
+	TP_STRUCT__entry(
+		__string(method,	method)
+		__field(unsigned int,	handle)
+		__field(u64,		argument)
+	),
+
+	TP_fast_assign(
+		__assign_str(method, method);
+		__entry->handle		= handle;
+		__entry->argument	= argument;
+	),
+
+	TP_printk("%s handle=0x%.4x argument=0x%.4llx",
+		__get_str(method), __entry->handle,
+		(unsigned long long) __entry->argument)
+);
+
+TRACE_EVENT(sony_snc_call_exit,
+
+	TP_PROTO(const char *method, unsigned int handle, u64 argument,
+		unsigned int result, int ret, s64 duration),
+
+	TP_ARGS(method, handle, argument, result, ret, duration),
+
+	TP_STRUCT__entry(
+		__string(method,	method)
+		__field(unsigned int,	handle)
+		__field(u64,		argument)
+		__field(unsigned int,	result)
+		__field(int,		ret)
+		__field(s64,		duration)
+	),
+
+	TP_fast_assign(
+		__assign_str(method, method);
+		__entry->handle		= handle;
+		__entry->argument	= argument;
+		__entry->result		= result;
+		__entry->ret		= ret;
+		__entry->duration	= duration;
+	),
+
+	TP_printk("%s handle=0x%.4x argument=0x%.4llx result=0x%.4x ret=%d "
+		"duration=%lldns", __get_str(method), __entry->handle,
+		(unsigned long long) __entry->argument, __entry->result,
+		__entry->ret, (long long) __entry->duration)
+);
+
+/* SPIC command port accesses, bytes written and value read back */
+TRACE_EVENT(sony_pic_call,
+
+	TP_PROTO(unsigned int nargs, u8 dev, u8 fn, u8 v, u16 result),
+
+	TP_ARGS(nargs, dev, fn, v, result),
+
+	TP_STRUCT__entry(
+		__field(unsigned int,	nargs)
+		__field(u8,		dev)
+		__field(u8,		fn)
+		__field(u8,		v)
+		__field(u16,		result)
+	),
+
+	TP_fast_assign(
+		__entry->nargs		= nargs;
+		__entry->dev		= dev;
+		__entry->fn		= fn;
+		__entry->v		= v;
+		__entry->result		= result;
+	),
+
+	TP_printk("call%u dev=0x%.2x fn=0x%.2x v=0x%.2x result=0x%.4x",
+		__entry->nargs, __entry->dev, __entry->fn, __entry->v,
+		__entry->result)
+);
+
+/* SPIC interrupt decoding, event is 0 when not decoded */
+TRACE_EVENT(sony_pic_irq,
+
+	TP_PROTO(u8 data, u8 data_mask, unsigned int port, u8 event),
+
+	TP_ARGS(data, data_mask, port, event),
+
+	TP_STRUCT__entry(
+		__field(u8,		data)
+		__field(u8,		data_mask)
+		__field(unsigned int,	port)
+		__field(u8,		event)
+	),
+
+	TP_fast_assign(
+		__entry->data		= data;
+		__entry->data_mask	= data_mask;
+		__entry->port		= port;
+		__entry->event		= event;
+	),
+
+	TP_printk("[%.2x] [%.2x] port=0x%.4x event=%u", __entry->data,
+		__entry->data_mask, __entry->port, __entry->event)
+);
+
+/* sonypi events reported to the input layer, key is 0 if not mapped */
+TRACE_EVENT(sony_input_event,
+
+	TP_PROTO(u8 event, int key),
+
+	TP_ARGS(event, key),
+
+	TP_STRUCT__entry(
+		__field(u8,	event)
+		__field(int,	key)
+	),
+
+	TP_fast_assign(
+		__entry->event	= event;
+		__entry->key	= key;
+	),
+
+	TP_printk("event=%u key=%d", __entry->event, __entry->key)
+);
+
+/* key releases, latency is the time since the press was reported */
+TRACE_EVENT(sony_input_release,
+
+	TP_PROTO(int key, s64 latency),
+
+	TP_ARGS(key, latency),
+
+	TP_STRUCT__entry(
+		__field(int,	key)
+		__field(s64,	latency)
+	),
+
+	TP_fast_assign(
+		__entry->key		= key;
+		__entry->latency	= latency;
+	),
+
+	TP_printk("key=%d latency=%lldus", __entry->key,
+		(long long) __entry->latency)
+);
+
+/* SNC notifications, ev and value as sent to userspace */
+TRACE_EVENT(sony_nc_notify,
+
+	TP_PROTO(u32 event, unsigned int handle, u8 ev, int value),
+
+	TP_ARGS(event, handle, ev, value),
+
+	TP_STRUCT__entry(
+		__field(u32,		event)
+		__field(unsigned int,	handle)
+		__field(u8,		ev)
+		__field(int,		value)
+	),
+
+	TP_fast_assign(
+		__entry->event	= event;
+		__entry->handle	= handle;
+		__entry->ev	= ev;
+		__entry->value	= value;
+	),
+
+	TP_printk("event=0x%.2x handle=0x%.4x ev=%u value=0x%x",
+		__entry->event, __entry->handle, __entry->ev, __entry->value)
+);
+
+/* SNC probe steps, handle 0 is the handles discovery */
+TRACE_EVENT(sony_nc_handle_setup,
+
+	TP_PROTO(unsigned int handle, int ret, s64 duration),
+
+	TP_ARGS(handle, ret, duration),
+
+	TP_STRUCT__entry(
+		__field(unsigned int,	handle)
+		__field(int,		ret)
+		__field(s64,		duration)
+	),
+
+	TP_fast_assign(
+		__entry->handle		= handle;
+		__entry->ret		= ret;
+		__entry->duration	= duration;
+	),
+
+	TP_printk("handle=0x%.4x ret=%d duration=%lldns", __entry->handle,
+		__entry->ret, (long long) __entry->duration)
+);
+
+/* stage latencies of an event, from its entry in the driver, in ns */
+TRACE_EVENT(sony_event_latency,
+
+	TP_PROTO(u16 source, u16 code, s64 decode, s64 input, s64 queue),
+
+	TP_ARGS(source, code, decode, input, queue),
+
+	TP_STRUCT__entry(
+		__field(u16,	source)
+		__field(u16,	code)
+		__field(s64,	decode)
+		__field(s64,	input)
+		__field(s64,	queue)
+	),
+
+	TP_fast_assign(
+		__entry->source		= source;
+		__entry->code		= code;
+		__entry->decode		= decode;
+		__entry->input		= input;
+		__entry->queue		= queue;
+	),
+
+	TP_printk("source=%u code=0x%.2x decode=%lldns input=%lldns "
+		"queue=%lldns", __entry->source, __entry->code,
+		(long long) __entry->decode, (long long) __entry->input,
+		(long long) __entry->queue)
+);
+
+/* a reader woke up for or dequeued an event, latency from its entry */
+TRACE_EVENT(sony_event_delivery,
+
+	TP_PROTO(u16 source, u16 code, s64 latency),
+
+	TP_ARGS(source, code, latency),
+
+	TP_STRUCT__entry(
+		__field(u16,	source)
+		__field(u16,	code)
+		__field(s64,	latency)
+	),
+
+	TP_fast_assign(
+		__entry->source		= source;
+		__entry->code		= code;
+		__entry->latency	= latency;
+	),
+
+	TP_printk("source=%u code=0x%.2x latency=%lldns", __entry->source,
+		__entry->code, (long long) __entry->latency)
+);
+
+#endif /* _SONY_LAPTOP_TRACE_H */
+
+/* this part must be outside the header guard */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE sony-laptop-trace
+#include <trace/define_trace.h>
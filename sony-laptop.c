@@ -54,6 +54,7 @@
 
 #include <linux/kernel.h>
 #include <linux/module.h>
+#include <linux/async.h>
 #include <linux/moduleparam.h>
 #include <linux/init.h>
 #include <linux/types.h>
@@ -67,6 +68,7 @@
 #include <linux/input.h>
 #include <linux/kfifo.h>
 #include <linux/workqueue.h>
+#include <linux/rcupdate.h>
 #include <linux/acpi.h>
 #include <linux/slab.h>
 #include <acpi/acpi_drivers.h>
@@ -75,13 +77,22 @@
 #include <linux/sonypi.h>
 #include <linux/sony-laptop.h>
 #include <linux/rfkill.h>
-#ifdef CONFIG_SONYPI_COMPAT
 #include <linux/poll.h>
 #include <linux/miscdevice.h>
-#endif
+#include <linux/vmalloc.h>
+#include <linux/mm.h>
 #ifdef SONY_ZSERIES
 #include <linux/version.h>
 #endif
+#ifdef CONFIG_DEBUG_FS
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/suspend.h>
+#endif
+#include <linux/ktime.h>
+
+#define CREATE_TRACE_POINTS
+#include "sony-laptop-trace.h"
 
 
 #define dprintk(fmt, ...)			\
@@ -124,8 +135,14 @@ module_param(compat, int, 0444);
 MODULE_PARM_DESC(compat,
 		 "set this if you want to enable backward compatibility mode");
 
+static int sony_pic_mask_set(const char *val, const struct kernel_param *kp);
+static struct kernel_param_ops sony_pic_mask_ops = {
+	.set = sony_pic_mask_set,
+	.get = param_get_ulong,
+};
+
 static unsigned long mask = 0xffffffff;
-module_param(mask, ulong, 0644);
+module_param_cb(mask, &sony_pic_mask_ops, &mask, 0644);
 MODULE_PARM_DESC(mask,
 		 "set this to the mask of event you want to enable (see doc)");
 
@@ -163,6 +180,121 @@ MODULE_PARM_DESC(force_shock_notifications,
 		"events, even though the notebook do not support head "
 		"unloading for the installed drive drive");
 
+/* read-through cache lifetime of the SNC feature queries, 0 disables it */
+static unsigned int fan_cache_ttl = 500;
+module_param(fan_cache_ttl, uint, 0644);
+MODULE_PARM_DESC(fan_cache_ttl,
+		 "milliseconds a fan query result is cached (default: 500)");
+
+static unsigned int battery_care_cache_ttl = 5000;
+module_param(battery_care_cache_ttl, uint, 0644);
+MODULE_PARM_DESC(battery_care_cache_ttl,
+		 "milliseconds a battery care query result is cached "
+		 "(default: 5000)");
+
+static unsigned int thermal_cache_ttl = 5000;
+module_param(thermal_cache_ttl, uint, 0644);
+MODULE_PARM_DESC(thermal_cache_ttl,
+		 "milliseconds a thermal control query result is cached "
+		 "(default: 5000)");
+
+static unsigned int gsensor_cache_ttl = 1000;
+module_param(gsensor_cache_ttl, uint, 0644);
+MODULE_PARM_DESC(gsensor_cache_ttl,
+		 "milliseconds a G sensor settings query result is cached "
+		 "(default: 1000)");
+
+static unsigned int als_cache_ttl = 1000;
+module_param(als_cache_ttl, uint, 0644);
+MODULE_PARM_DESC(als_cache_ttl,
+		 "milliseconds an ALS settings query result is cached "
+		 "(default: 1000)");
+
+static int async_store;	/* = 0 */
+module_param(async_store, int, 0644);
+MODULE_PARM_DESC(async_store,
+		 "set this to 1 to run the slow sysfs stores in background, "
+		 "completion is reported through command_seq and uevents "
+		 "(default: 0)");
+
+static unsigned int jogdial_coalesce = 10;
+module_param(jogdial_coalesce, uint, 0644);
+MODULE_PARM_DESC(jogdial_coalesce,
+		 "milliseconds the jog dial rotations are accumulated before "
+		 "being reported, 0 reports every step (default: 10)");
+
+static int sony_laptop_input_resize(const char *val,
+		const struct kernel_param *kp);
+static struct kernel_param_ops sony_laptop_input_size_ops = {
+	.set = sony_laptop_input_resize,
+	.get = param_get_uint,
+};
+
+static unsigned int input_fifo_size = 32;
+module_param_cb(input_fifo_size, &sony_laptop_input_size_ops,
+		&input_fifo_size, 0644);
+MODULE_PARM_DESC(input_fifo_size,
+		 "number of pressed keys waiting for their release, can only "
+		 "be changed while none is pending (default: 32)");
+
+#ifdef CONFIG_SONYPI_COMPAT
+static int sonypi_compat_resize(const char *val,
+		const struct kernel_param *kp);
+static struct kernel_param_ops sonypi_compat_size_ops = {
+	.set = sonypi_compat_resize,
+	.get = param_get_uint,
+};
+
+static unsigned int compat_fifo_size = 128;
+module_param_cb(compat_fifo_size, &sonypi_compat_size_ops,
+		&compat_fifo_size, 0644);
+MODULE_PARM_DESC(compat_fifo_size,
+		 "number of events queued for the sonypi compat readers, can "
+		 "only be changed while the device is closed (default: 128)");
+#endif
+
+/* what to do with an event when its fifo is full */
+enum sony_fifo_overflow {
+	SONY_OVERFLOW_DROP_NEWEST,
+	SONY_OVERFLOW_DROP_OLDEST,
+	SONY_OVERFLOW_COALESCE,	/* merge into the last queued if equal */
+};
+static const char * const sony_fifo_overflow_names[] = {
+	"drop-newest", "drop-oldest", "coalesce",
+};
+
+static int fifo_overflow = SONY_OVERFLOW_DROP_NEWEST;
+
+static int sony_fifo_overflow_set(const char *val,
+		const struct kernel_param *kp)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(sony_fifo_overflow_names); i++) {
+		if (sysfs_streq(val, sony_fifo_overflow_names[i])) {
+			ACCESS_ONCE(fifo_overflow) = i;
+			return 0;
+		}
+	}
+
+	return -EINVAL;
+}
+
+static int sony_fifo_overflow_get(char *buffer, const struct kernel_param *kp)
+{
+	return sprintf(buffer, "%s", sony_fifo_overflow_names[fifo_overflow]);
+}
+
+static struct kernel_param_ops sony_fifo_overflow_ops = {
+	.set = sony_fifo_overflow_set,
+	.get = sony_fifo_overflow_get,
+};
+module_param_cb(fifo_overflow, &sony_fifo_overflow_ops, &fifo_overflow, 0644);
+MODULE_PARM_DESC(fifo_overflow,
+		 "what to do when an event fifo is full: drop-newest, "
+		 "drop-oldest or coalesce duplicates of the last queued event "
+		 "(default: drop-newest)");
+
 #ifdef SONY_ZSERIES
 static int speed_stamina;
 module_param(speed_stamina, int, 0444);
@@ -179,28 +311,94 @@ static char *sony_acpi_path_hsc1[] =
 	"\\_SB.PCI0.LPC.SNC.HSC1",
 	"\\_SB.PCI0.LPCB.SNC.HSC1"
 };
+/* methods resolved once at sony_pf_probe time */
+static acpi_handle sony_dsm_handle;
+static acpi_handle sony_hsc1_handle;
+static acpi_handle sony_psr_handle;
 /* static acpi_handle sony_nc_acpi_handle; */
-static int acpi_callgetfunc(acpi_handle, char*, unsigned int*);
+static int __acpi_callgetfunc(acpi_handle, char *, unsigned int *);
+static int acpi_callgetfunc(acpi_handle, const char *, unsigned int *);
 #endif
+/*********** Event Counters ***********/
+
+#define SONY_EVENT_SRC_SNC	1
+#define SONY_EVENT_SRC_SPIC	2
+
+enum sony_event_fifo {
+	SONY_FIFO_INPUT,
+	SONY_FIFO_COMPAT,
+	SONY_FIFO_COMPAT_RECORD,
+	SONY_FIFOS,
+};
+
+/* summed over the CPUs, high_water is the maximum of them, in bytes */
+struct sony_event_counters {
+	unsigned long events[2][0x100];	/* per source and event code */
+	unsigned long unknown[2];
+	unsigned long dropped[SONY_FIFOS];
+	unsigned long coalesced[SONY_FIFOS];
+	unsigned int high_water[SONY_FIFOS];
+};
+static DEFINE_PER_CPU(struct sony_event_counters, sony_event_counters);
+
+static inline void sony_event_count(u16 source, u16 code)
+{
+	this_cpu_inc(sony_event_counters.events[source - 1][code & 0xff]);
+}
+
+static inline void sony_event_count_unknown(u16 source)
+{
+	this_cpu_inc(sony_event_counters.unknown[source - 1]);
+}
+
+/* to be called under the lock of the fifo, right after queueing to it */
+static inline void sony_event_fifo_account(enum sony_event_fifo fifo,
+		struct kfifo *kf, bool dropped)
+{
+	struct sony_event_counters *c = this_cpu_ptr(&sony_event_counters);
+	unsigned int len = kfifo_len(kf);
+
+	if (dropped)
+		c->dropped[fifo]++;
+	if (len > c->high_water[fifo])
+		c->high_water[fifo] = len;
+}
+
+static inline void sony_event_fifo_coalesced(enum sony_event_fifo fifo)
+{
+	this_cpu_inc(sony_event_counters.coalesced[fifo]);
+}
+
+/* serializes the fifos allocation with their resizing */
+static DEFINE_MUTEX(sony_laptop_fifo_mutex);
+
 /*********** Input Devices ***********/
 
-#define SONY_LAPTOP_BUF_SIZE	128
+#define SONY_LAPTOP_FIFO_MAX	4096	/* entries */
+#define SONY_LAPTOP_RELEASE_DELAY	10	/* ms */
+struct sony_laptop_keypress {
+	struct input_dev *dev;
+	int key;
+	unsigned long deadline;	/* jiffies, when to release the key */
+	ktime_t pressed;
+};
+
 struct sony_laptop_input_s {
 	atomic_t		users;
 	struct input_dev	*jog_dev;
 	struct input_dev	*key_dev;
 	struct kfifo		fifo;
 	spinlock_t		fifo_lock;
+	struct sony_laptop_keypress	last;	/* last queued key */
 	struct timer_list	release_key_timer;
+	struct timer_list	jog_timer;
+	spinlock_t		jog_lock;
+	int			jog_delta;	/* not reported yet */
 };
 
 static struct sony_laptop_input_s sony_laptop_input = {
 	.users = ATOMIC_INIT(0),
-};
-
-struct sony_laptop_keypress {
-	struct input_dev *dev;
-	int key;
+	.fifo_lock = __SPIN_LOCK_UNLOCKED(sony_laptop_input.fifo_lock),
 };
 
 /* Correspondance table between sonypi events
@@ -346,7 +544,20 @@ static int sony_laptop_input_keycode_map[] = {
 	KEY_VENDOR,	/* 59 SONYPI_EVENT_VENDOR_PRESSED */
 };
 
-/* release buttons after a short delay if pressed */
+static void sony_laptop_release_key(struct sony_laptop_keypress *kp)
+{
+	input_report_key(kp->dev, kp->key, 0);
+	input_sync(kp->dev);
+	if (trace_sony_input_release_enabled())
+		trace_sony_input_release(kp->key,
+				ktime_us_delta(ktime_get(), kp->pressed));
+}
+
+/*
+ * release buttons after a short delay if pressed, every key has its own
+ * deadline and the fifo is sorted by deadline: release all the keys due
+ * and schedule the next one
+ */
 static void do_sony_laptop_release_key(unsigned long unused)
 {
 	struct sony_laptop_keypress kp;
@@ -354,48 +565,158 @@ static void do_sony_laptop_release_key(unsigned long unused)
 
 	spin_lock_irqsave(&sony_laptop_input.fifo_lock, flags);
 
-	if (kfifo_out(&sony_laptop_input.fifo,
-		      (unsigned char *)&kp, sizeof(kp)) == sizeof(kp)) {
-		input_report_key(kp.dev, kp.key, 0);
-		input_sync(kp.dev);
-	}
+	while (kfifo_out_peek(&sony_laptop_input.fifo,
+			(unsigned char *)&kp, sizeof(kp)) == sizeof(kp)) {
+		if (time_before(jiffies, kp.deadline)) {
+			mod_timer(&sony_laptop_input.release_key_timer,
+					kp.deadline);
+			break;
+		}
+
+		if (kfifo_out(&sony_laptop_input.fifo, (unsigned char *)&kp,
+					sizeof(kp)) != sizeof(kp))
+			break;
 
-	/* If there is something in the fifo schedule next release. */
-	if (kfifo_len(&sony_laptop_input.fifo) != 0)
-		mod_timer(&sony_laptop_input.release_key_timer,
-			  jiffies + msecs_to_jiffies(10));
+		sony_laptop_release_key(&kp);
+	}
 
 	spin_unlock_irqrestore(&sony_laptop_input.fifo_lock, flags);
 }
 
+/* wheel steps of the jog dial rotation events, 0 for the others */
+static int sony_laptop_jog_delta(u8 event)
+{
+	switch (event) {
+	case SONYPI_EVENT_JOGDIAL_UP:
+	case SONYPI_EVENT_JOGDIAL_UP_PRESSED:
+		return 1;
+	case SONYPI_EVENT_JOGDIAL_DOWN:
+	case SONYPI_EVENT_JOGDIAL_DOWN_PRESSED:
+		return -1;
+	case SONYPI_EVENT_JOGDIAL_FAST_UP:
+	case SONYPI_EVENT_JOGDIAL_FAST_UP_PRESSED:
+		return 2;
+	case SONYPI_EVENT_JOGDIAL_FAST_DOWN:
+	case SONYPI_EVENT_JOGDIAL_FAST_DOWN_PRESSED:
+		return -2;
+	case SONYPI_EVENT_JOGDIAL_VFAST_UP:
+	case SONYPI_EVENT_JOGDIAL_VFAST_UP_PRESSED:
+		return 3;
+	case SONYPI_EVENT_JOGDIAL_VFAST_DOWN:
+	case SONYPI_EVENT_JOGDIAL_VFAST_DOWN_PRESSED:
+		return -3;
+	default:
+		return 0;
+	}
+}
+
+/* report the rotation accumulated during the coalescing window */
+static void do_sony_laptop_jog_flush(unsigned long unused)
+{
+	struct input_dev *jog_dev = sony_laptop_input.jog_dev;
+	unsigned long flags;
+	int delta;
+
+	spin_lock_irqsave(&sony_laptop_input.jog_lock, flags);
+	delta = sony_laptop_input.jog_delta;
+	sony_laptop_input.jog_delta = 0;
+	spin_unlock_irqrestore(&sony_laptop_input.jog_lock, flags);
+
+	if (delta && jog_dev) {
+		input_report_rel(jog_dev, REL_WHEEL, delta);
+		input_sync(jog_dev);
+	}
+}
+
+static void sony_laptop_report_jog(int delta)
+{
+	struct input_dev *jog_dev = sony_laptop_input.jog_dev;
+	unsigned long flags;
+
+	if (!jogdial_coalesce) {
+		input_report_rel(jog_dev, REL_WHEEL, delta);
+		input_sync(jog_dev);
+		return;
+	}
+
+	/* the first step of a burst opens the window */
+	spin_lock_irqsave(&sony_laptop_input.jog_lock, flags);
+	sony_laptop_input.jog_delta += delta;
+	if (!timer_pending(&sony_laptop_input.jog_timer))
+		mod_timer(&sony_laptop_input.jog_timer,
+				jiffies + msecs_to_jiffies(jogdial_coalesce));
+	spin_unlock_irqrestore(&sony_laptop_input.jog_lock, flags);
+}
+
+/*
+ * queue the key for its release following the overflow policy, fifo_lock
+ * held, false if it could not be queued and has to be released now
+ */
+static bool sony_laptop_queue_key(struct sony_laptop_keypress *kp)
+{
+	struct kfifo *fifo = &sony_laptop_input.fifo;
+	struct sony_laptop_keypress *last = &sony_laptop_input.last;
+	struct sony_laptop_keypress old;
+	bool dropped = false;
+
+	if (kfifo_avail(fifo) < sizeof(*kp)) {
+		switch (ACCESS_ONCE(fifo_overflow)) {
+		case SONY_OVERFLOW_COALESCE:
+			/* still down, the pending release covers it */
+			if (last->dev == kp->dev && last->key == kp->key) {
+				sony_event_fifo_coalesced(SONY_FIFO_INPUT);
+				return true;
+			}
+			break;
+		case SONY_OVERFLOW_DROP_OLDEST:
+			/* the oldest is the first due, release it early */
+			if (kfifo_out(fifo, (unsigned char *)&old,
+					sizeof(old)) == sizeof(old)) {
+				sony_laptop_release_key(&old);
+				dropped = true;
+			}
+			break;
+		}
+	}
+
+	if (kfifo_avail(fifo) < sizeof(*kp)) {
+		sony_event_fifo_account(SONY_FIFO_INPUT, fifo, true);
+		return false;
+	}
+
+	kfifo_in(fifo, (unsigned char *)kp, sizeof(*kp));
+	*last = *kp;
+	sony_event_fifo_account(SONY_FIFO_INPUT, fifo, dropped);
+
+	return true;
+}
+
 /* forward event to the input subsystem */
 static void sony_laptop_report_input_event(u8 event)
 {
 	struct input_dev *jog_dev = sony_laptop_input.jog_dev;
 	struct input_dev *key_dev = sony_laptop_input.key_dev;
 	struct sony_laptop_keypress kp = { NULL };
+	unsigned long flags;
+	int delta;
 
 	if (event == SONYPI_EVENT_FNKEY_RELEASED ||
 			event == SONYPI_EVENT_ANYBUTTON_RELEASED) {
 		/* Nothing, not all VAIOs generate this event */
+		trace_sony_input_event(event, 0);
 		return;
 	}
 
-	/* report events */
-	switch (event) {
-	/* jog_dev events */
-	case SONYPI_EVENT_JOGDIAL_UP:
-	case SONYPI_EVENT_JOGDIAL_UP_PRESSED:
-		input_report_rel(jog_dev, REL_WHEEL, 1);
-		input_sync(jog_dev);
-		return;
-
-	case SONYPI_EVENT_JOGDIAL_DOWN:
-	case SONYPI_EVENT_JOGDIAL_DOWN_PRESSED:
-		input_report_rel(jog_dev, REL_WHEEL, -1);
-		input_sync(jog_dev);
+	/* jog_dev events, FAST and VFAST rotations are bigger steps */
+	delta = sony_laptop_jog_delta(event);
+	if (delta) {
+		trace_sony_input_event(event, REL_WHEEL);
+		sony_laptop_report_jog(delta);
 		return;
+	}
 
+	/* report events */
+	switch (event) {
 	/* key_dev events */
 	case SONYPI_EVENT_JOGDIAL_PRESSED:
 		kp.key = BTN_MIDDLE;
@@ -403,11 +724,9 @@ static void sony_laptop_report_input_event(u8 event)
 		break;
 
 	default:
-		if (event >= ARRAY_SIZE(sony_laptop_input_index)) {
-			dprintk("sony_laptop_report_input_event, "
-				"event not known: %d\n", event);
+		if (event >= ARRAY_SIZE(sony_laptop_input_index))
 			break;
-		}
+
 		if (sony_laptop_input_index[event] != -1) {
 			kp.key = sony_laptop_input_keycode_map[sony_laptop_input_index[event]];
 			if (kp.key != KEY_UNKNOWN)
@@ -416,6 +735,8 @@ static void sony_laptop_report_input_event(u8 event)
 		break;
 	}
 
+	trace_sony_input_event(event, kp.dev ? kp.key : 0);
+
 	if (kp.dev) {
 		input_report_key(kp.dev, kp.key, 1);
 		/* we emit the scancode so we can always remap the key */
@@ -423,13 +744,21 @@ static void sony_laptop_report_input_event(u8 event)
 		input_sync(kp.dev);
 
 		/* schedule key release */
-		kfifo_in_locked(&sony_laptop_input.fifo,
-				(unsigned char *)&kp, sizeof(kp),
-				&sony_laptop_input.fifo_lock);
-		mod_timer(&sony_laptop_input.release_key_timer,
-			  jiffies + msecs_to_jiffies(10));
-	} else
-		dprintk("unknown input event %.2x\n", event);
+		kp.pressed = ktime_get();
+		kp.deadline = jiffies +
+			msecs_to_jiffies(SONY_LAPTOP_RELEASE_DELAY);
+		spin_lock_irqsave(&sony_laptop_input.fifo_lock, flags);
+		if (!sony_laptop_queue_key(&kp)) {
+			/* too many keys pending, do not leave it stuck */
+			sony_laptop_release_key(&kp);
+		} else if (!timer_pending(
+				&sony_laptop_input.release_key_timer)) {
+			/* otherwise already armed for an earlier key */
+			mod_timer(&sony_laptop_input.release_key_timer,
+					kp.deadline);
+		}
+		spin_unlock_irqrestore(&sony_laptop_input.fifo_lock, flags);
+	}
 }
 
 static int sony_laptop_setup_input(struct acpi_device *acpi_device)
@@ -444,9 +773,11 @@ static int sony_laptop_setup_input(struct acpi_device *acpi_device)
 		return 0;
 
 	/* kfifo */
-	spin_lock_init(&sony_laptop_input.fifo_lock);
-	error = kfifo_alloc(&sony_laptop_input.fifo,
-			    SONY_LAPTOP_BUF_SIZE, GFP_KERNEL);
+	mutex_lock(&sony_laptop_fifo_mutex);
+	error = kfifo_alloc(&sony_laptop_input.fifo, input_fifo_size *
+			    sizeof(struct sony_laptop_keypress), GFP_KERNEL);
+	memset(&sony_laptop_input.last, 0, sizeof(sony_laptop_input.last));
+	mutex_unlock(&sony_laptop_fifo_mutex);
 	if (error) {
 		pr_err("kfifo_alloc failed\n");
 		goto err_dec_users;
@@ -455,6 +786,11 @@ static int sony_laptop_setup_input(struct acpi_device *acpi_device)
 	setup_timer(&sony_laptop_input.release_key_timer,
 		    do_sony_laptop_release_key, 0);
 
+	spin_lock_init(&sony_laptop_input.jog_lock);
+	sony_laptop_input.jog_delta = 0;
+	setup_timer(&sony_laptop_input.jog_timer,
+		    do_sony_laptop_jog_flush, 0);
+
 	/* input keys */
 	key_dev = input_allocate_device();
 	if (!key_dev) {
@@ -519,7 +855,9 @@ err_free_keydev:
 	input_free_device(key_dev);
 
 err_free_kfifo:
+	mutex_lock(&sony_laptop_fifo_mutex);
 	kfifo_free(&sony_laptop_input.fifo);
+	mutex_unlock(&sony_laptop_fifo_mutex);
 
 err_dec_users:
 	atomic_dec(&sony_laptop_input.users);
@@ -535,30 +873,1111 @@ static void sony_laptop_remove_input(void)
 		return;
 
 	del_timer_sync(&sony_laptop_input.release_key_timer);
+	del_timer_sync(&sony_laptop_input.jog_timer);
 
 	/*
 	 * Generate key-up events for remaining keys. Note that we don't
 	 * need locking since nobody is adding new events to the kfifo.
 	 */
 	while (kfifo_out(&sony_laptop_input.fifo,
-			 (unsigned char *)&kp, sizeof(kp)) == sizeof(kp)) {
-		input_report_key(kp.dev, kp.key, 0);
-		input_sync(kp.dev);
+			 (unsigned char *)&kp, sizeof(kp)) == sizeof(kp))
+		sony_laptop_release_key(&kp);
+
+	/* destroy input devs */
+	input_unregister_device(sony_laptop_input.key_dev);
+	sony_laptop_input.key_dev = NULL;
+
+	if (sony_laptop_input.jog_dev) {
+		input_unregister_device(sony_laptop_input.jog_dev);
+		sony_laptop_input.jog_dev = NULL;
+	}
+
+	mutex_lock(&sony_laptop_fifo_mutex);
+	kfifo_free(&sony_laptop_input.fifo);
+	mutex_unlock(&sony_laptop_fifo_mutex);
+}
+
+/* swap in a fifo of the new size, only while no key is pending */
+static int sony_laptop_input_resize(const char *val,
+		const struct kernel_param *kp)
+{
+	struct kfifo fifo, old;
+	unsigned long flags, size;
+	int ret;
+
+	ret = strict_strtoul(val, 10, &size);
+	if (ret)
+		return ret;
+	if (!size || size > SONY_LAPTOP_FIFO_MAX)
+		return -EINVAL;
+
+	mutex_lock(&sony_laptop_fifo_mutex);
+	/* not in use yet, the value is used at allocation */
+	if (!kfifo_initialized(&sony_laptop_input.fifo))
+		goto out;
+
+	ret = kfifo_alloc(&fifo, size * sizeof(struct sony_laptop_keypress),
+			GFP_KERNEL);
+	if (ret)
+		goto out_unlock;
+
+	spin_lock_irqsave(&sony_laptop_input.fifo_lock, flags);
+	if (kfifo_len(&sony_laptop_input.fifo)) {
+		spin_unlock_irqrestore(&sony_laptop_input.fifo_lock, flags);
+		kfifo_free(&fifo);
+		ret = -EBUSY;
+		goto out_unlock;
+	}
+	old = sony_laptop_input.fifo;
+	sony_laptop_input.fifo = fifo;
+	spin_unlock_irqrestore(&sony_laptop_input.fifo_lock, flags);
+	kfifo_free(&old);
+
+out:
+	input_fifo_size = size;
+out_unlock:
+	mutex_unlock(&sony_laptop_fifo_mutex);
+	return ret;
+}
+
+/*********** Event Ring ***********/
+/*
+ * Shared ring of the SNC and SPIC events, mapped read-only by the
+ * consumers through /dev/sony-events.  The first page holds the header,
+ * the records follow from the second page.  There is a single producer,
+ * each consumer keeps its own tail and acknowledges it once the records
+ * before it are used:
+ *
+ *	tail = hdr->head;
+ *	for (;;) {
+ *		head = hdr->head; rmb();
+ *		if (head - tail > hdr->records)
+ *			tail = head - hdr->records;	(overrun)
+ *		while (tail != head) {
+ *			copy rec[tail % hdr->records]; rmb();
+ *			if (hdr->head - tail <= hdr->records)
+ *				use the copy;		(not overwritten)
+ *			tail++;
+ *		}
+ *		ioctl(fd, SONY_EVENT_IOCACK, &tail);
+ *		poll(fd, POLLIN);
+ *	}
+ *
+ * The tail starts at the head of the open.  poll() reports POLLIN while
+ * the acknowledged tail is behind the head and changes nothing, the
+ * acknowledged records are accounted as delivered.  The threads sharing
+ * a file share its tail.
+ */
+#define SONY_EVENT_RING_VERSION	1
+#define SONY_EVENT_RING_RECORDS	256
+#define SONY_EVENT_IOCACK	_IOW('v', 0x42, __u32)
+
+/*
+ * an event is stamped when it enters sony_nc_notify() or sony_pic_irq()
+ * and then after each stage of its way to userspace
+ */
+enum sony_event_stage {
+	SONY_EVENT_DECODE,
+	SONY_EVENT_INPUT,
+	SONY_EVENT_QUEUE,
+	SONY_EVENT_DELIVER,
+	SONY_EVENT_STAGES,
+};
+
+struct sony_event_stamp {
+	u16 source;
+	u16 code;
+	ktime_t start;
+	ktime_t stage[SONY_EVENT_STAGES];
+};
+
+static inline void sony_event_stamp(struct sony_event_stamp *st,
+		enum sony_event_stage stage)
+{
+	st->stage[stage] = ktime_get();
+}
+
+static void sony_event_delivered(u16 source, u16 code, ktime_t start);
+
+struct sony_event_ring_header {
+	__u32	version;
+	__u32	records;	/* power of 2 */
+	__u32	head;		/* records produced, wraps */
+	__u32	reserved;
+};
+
+struct sony_event_record {
+	__u64	time;		/* monotonic entry time, ns */
+	__u16	source;		/* SONY_EVENT_SRC_* */
+	__u16	code;		/* SNC notification or sonypi event */
+	__s32	value;
+};
+
+static struct sony_event_ring {
+	void				*mem;
+	struct sony_event_ring_header	*hdr;
+	struct sony_event_record	*records;
+	spinlock_t			lock;
+	wait_queue_head_t		wait;
+	struct mutex			ack_lock;	/* the file tails */
+} sony_event_ring;
+
+/* the SNC notify and the SPIC irq thread are serialized into one producer */
+static void sony_event_ring_put(struct sony_event_stamp *st, s32 value)
+{
+	struct sony_event_record *rec;
+	unsigned long flags;
+	u32 head;
+
+	if (!sony_event_ring.mem)
+		return;
+
+	spin_lock_irqsave(&sony_event_ring.lock, flags);
+	head = sony_event_ring.hdr->head;
+	rec = &sony_event_ring.records[head & (SONY_EVENT_RING_RECORDS - 1)];
+	rec->time = ktime_to_ns(st->start);
+	rec->source = st->source;
+	rec->code = st->code;
+	rec->value = value;
+	/* the record must be complete before it gets published */
+	smp_wmb();
+	ACCESS_ONCE(sony_event_ring.hdr->head) = head + 1;
+	spin_unlock_irqrestore(&sony_event_ring.lock, flags);
+
+	wake_up_interruptible(&sony_event_ring.wait);
+}
+
+static inline u32 sony_event_ring_tail(struct file *file)
+{
+	return (unsigned long) ACCESS_ONCE(file->private_data);
+}
+
+static int sony_event_ring_open(struct inode *inode, struct file *file)
+{
+	/* tail acknowledged by the consumer */
+	file->private_data =
+		(void *)(unsigned long) ACCESS_ONCE(sony_event_ring.hdr->head);
+	return 0;
+}
+
+static unsigned int sony_event_ring_poll(struct file *file, poll_table *wait)
+{
+	u32 head;
+
+	poll_wait(file, &sony_event_ring.wait, wait);
+	head = ACCESS_ONCE(sony_event_ring.hdr->head);
+	if (head == sony_event_ring_tail(file))
+		return 0;
+
+	return POLLIN | POLLRDNORM;
+}
+
+/* the records before tail are used, account those not overwritten */
+static int sony_event_ring_ack(struct file *file, u32 tail)
+{
+	struct sony_event_record rec;
+	unsigned long flags;
+	u32 old, head, first;
+	bool valid;
+
+	mutex_lock(&sony_event_ring.ack_lock);
+	old = sony_event_ring_tail(file);
+	head = ACCESS_ONCE(sony_event_ring.hdr->head);
+	if (tail - old > head - old) {
+		mutex_unlock(&sony_event_ring.ack_lock);
+		return -EINVAL;
+	}
+
+	/* records before first were overwritten, never delivered */
+	first = head - SONY_EVENT_RING_RECORDS;
+	if (head - old > SONY_EVENT_RING_RECORDS)
+		old = tail - old > first - old ? first : tail;
+
+	for (; old != tail; old++) {
+		spin_lock_irqsave(&sony_event_ring.lock, flags);
+		valid = sony_event_ring.hdr->head - old <=
+			SONY_EVENT_RING_RECORDS;
+		if (valid)
+			rec = sony_event_ring.records[old &
+				(SONY_EVENT_RING_RECORDS - 1)];
+		spin_unlock_irqrestore(&sony_event_ring.lock, flags);
+
+		if (valid)
+			sony_event_delivered(rec.source, rec.code,
+					ns_to_ktime(rec.time));
+	}
+
+	ACCESS_ONCE(file->private_data) = (void *)(unsigned long) tail;
+	mutex_unlock(&sony_event_ring.ack_lock);
+
+	return 0;
+}
+
+static long sony_event_ring_ioctl(struct file *file, unsigned int cmd,
+		unsigned long arg)
+{
+	u32 tail;
+
+	if (cmd != SONY_EVENT_IOCACK)
+		return -ENOTTY;
+	if (copy_from_user(&tail, (void __user *) arg, sizeof(tail)))
+		return -EFAULT;
+
+	return sony_event_ring_ack(file, tail);
+}
+
+static int sony_event_ring_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	return remap_vmalloc_range(vma, sony_event_ring.mem, vma->vm_pgoff);
+}
+
+static const struct file_operations sony_event_ring_fops = {
+	.owner		= THIS_MODULE,
+	.open		= sony_event_ring_open,
+	.poll		= sony_event_ring_poll,
+	.unlocked_ioctl	= sony_event_ring_ioctl,
+	.mmap		= sony_event_ring_mmap,
+	.llseek		= noop_llseek,
+};
+
+static struct miscdevice sony_event_ring_device = {
+	.minor		= MISC_DYNAMIC_MINOR,
+	.name		= "sony-events",
+	.fops		= &sony_event_ring_fops,
+};
+
+static int sony_event_ring_setup(void)
+{
+	int error;
+
+	/* vmalloc_user hands out zeroed memory */
+	sony_event_ring.mem = vmalloc_user(PAGE_SIZE + PAGE_ALIGN(
+			SONY_EVENT_RING_RECORDS *
+			sizeof(struct sony_event_record)));
+	if (!sony_event_ring.mem)
+		return -ENOMEM;
+
+	sony_event_ring.hdr = sony_event_ring.mem;
+	sony_event_ring.hdr->version = SONY_EVENT_RING_VERSION;
+	sony_event_ring.hdr->records = SONY_EVENT_RING_RECORDS;
+	sony_event_ring.records = sony_event_ring.mem + PAGE_SIZE;
+	spin_lock_init(&sony_event_ring.lock);
+	init_waitqueue_head(&sony_event_ring.wait);
+	mutex_init(&sony_event_ring.ack_lock);
+
+	error = misc_register(&sony_event_ring_device);
+	if (error) {
+		pr_err("unable to register the event ring device\n");
+		vfree(sony_event_ring.mem);
+		sony_event_ring.mem = NULL;
+		return error;
 	}
 
-	/* destroy input devs */
-	input_unregister_device(sony_laptop_input.key_dev);
-	sony_laptop_input.key_dev = NULL;
+	return 0;
+}
+
+static void sony_event_ring_cleanup(void)
+{
+	if (!sony_event_ring.mem)
+		return;
+
+	misc_deregister(&sony_event_ring_device);
+	vfree(sony_event_ring.mem);
+	sony_event_ring.mem = NULL;
+}
+
+/*********** ACPI evaluation statistics ***********/
+
+/*
+ * contention and hold times of the locks serializing the EC accesses,
+ * the counters are updated with the lock held and sony_lock_stats_lock
+ * taken, the readers and the reset only take sony_lock_stats_lock
+ */
+struct sony_lock_stats {
+	const char *name;
+	unsigned int handle;	/* SNC handle, 0 for the method locks */
+	unsigned long acquired;
+	unsigned long contended;
+	u64 wait_us;
+	u64 max_wait_us;
+	u64 hold_us;
+	u64 max_hold_us;
+	ktime_t since;
+};
+
+static struct sony_lock_stats sony_sn06_lock_stats = { .name = "SN06" };
+/* one per SNC handle offset, kept out of the handles for debugfs */
+static struct sony_lock_stats sony_snc_lock_stats[0x10];
+static DEFINE_SPINLOCK(sony_lock_stats_lock);
+
+static void sony_lock_timed(struct mutex *lock, struct sony_lock_stats *st)
+{
+	ktime_t start;
+	u64 us;
+
+	if (mutex_trylock(lock)) {
+		st->since = ktime_get();
+		spin_lock(&sony_lock_stats_lock);
+		st->acquired++;
+		spin_unlock(&sony_lock_stats_lock);
+		return;
+	}
+
+	start = ktime_get();
+	mutex_lock(lock);
+	st->since = ktime_get();
+	us = ktime_us_delta(st->since, start);
+
+	spin_lock(&sony_lock_stats_lock);
+	st->acquired++;
+	st->contended++;
+	st->wait_us += us;
+	if (us > st->max_wait_us)
+		st->max_wait_us = us;
+	spin_unlock(&sony_lock_stats_lock);
+}
+
+static void sony_unlock_timed(struct mutex *lock, struct sony_lock_stats *st)
+{
+	u64 us = ktime_us_delta(ktime_get(), st->since);
+
+	spin_lock(&sony_lock_stats_lock);
+	st->hold_us += us;
+	if (us > st->max_hold_us)
+		st->max_hold_us = us;
+	spin_unlock(&sony_lock_stats_lock);
+
+	mutex_unlock(lock);
+}
+
+static void sony_lock_stats_reset(struct sony_lock_stats *st)
+{
+	spin_lock(&sony_lock_stats_lock);
+	st->acquired = st->contended = 0;
+	st->wait_us = st->max_wait_us = 0;
+	st->hold_us = st->max_hold_us = 0;
+	spin_unlock(&sony_lock_stats_lock);
+}
+
+#ifdef CONFIG_DEBUG_FS
+static struct dentry *sony_laptop_debugfs;
+
+/*
+ * latency of the AML evaluations per (method, handle, sub-command),
+ * bucket i counts the calls that took [2^i, 2^(i+1)) microseconds
+ */
+#define SONY_STATS_BUCKETS	20
+#define SONY_STATS_ENTRIES	128
+struct sony_acpi_stats {
+	const char *method;
+	unsigned int handle;
+	unsigned int cmd;
+	unsigned long calls;
+	unsigned long errors;
+	unsigned long buckets[SONY_STATS_BUCKETS];
+};
+
+static struct sony_acpi_stats sony_acpi_stats[SONY_STATS_ENTRIES];
+static unsigned long sony_acpi_stats_lost;
+static DEFINE_SPINLOCK(sony_acpi_stats_lock);
+
+static unsigned int sony_stats_bucket(s64 us)
+{
+	unsigned int bucket;
+
+	bucket = us > 1 ? fls(us > UINT_MAX ? UINT_MAX : us) - 1 : 0;
+	if (bucket >= SONY_STATS_BUCKETS)
+		bucket = SONY_STATS_BUCKETS - 1;
+
+	return bucket;
+}
+
+static void sony_acpi_stats_account(const char *method, unsigned int handle,
+		unsigned int cmd, ktime_t start, int error)
+{
+	struct sony_acpi_stats *entry = NULL;
+	s64 us = ktime_us_delta(ktime_get(), start);
+	unsigned int i, bucket, slot;
+	unsigned long flags;
+
+	bucket = sony_stats_bucket(us);
+
+	slot = (method[0] + method[strlen(method) - 1] + (handle << 4) + cmd)
+		% SONY_STATS_ENTRIES;
+
+	spin_lock_irqsave(&sony_acpi_stats_lock, flags);
+	for (i = 0; i < SONY_STATS_ENTRIES; i++) {
+		entry = &sony_acpi_stats[(slot + i) % SONY_STATS_ENTRIES];
+		if (!entry->method) {
+			entry->method = method;
+			entry->handle = handle;
+			entry->cmd = cmd;
+			break;
+		}
+		if (entry->handle == handle && entry->cmd == cmd &&
+				!strcmp(entry->method, method))
+			break;
+	}
+
+	if (i == SONY_STATS_ENTRIES) {
+		sony_acpi_stats_lost++;
+	} else {
+		entry->calls++;
+		if (error)
+			entry->errors++;
+		entry->buckets[bucket]++;
+	}
+	spin_unlock_irqrestore(&sony_acpi_stats_lock, flags);
+}
+
+static int sony_acpi_stats_show(struct seq_file *m, void *v)
+{
+	unsigned int i, j;
+	unsigned long flags;
+
+	seq_puts(m, "method handle cmd    calls    errors   buckets (log2 us)\n");
+
+	spin_lock_irqsave(&sony_acpi_stats_lock, flags);
+	for (i = 0; i < SONY_STATS_ENTRIES; i++) {
+		struct sony_acpi_stats *entry = &sony_acpi_stats[i];
+
+		if (!entry->method)
+			continue;
+
+		seq_printf(m, "%-6s 0x%.4x 0x%.4x %-8lu %-8lu",
+				entry->method, entry->handle, entry->cmd,
+				entry->calls, entry->errors);
+		for (j = 0; j < SONY_STATS_BUCKETS; j++)
+			seq_printf(m, " %lu", entry->buckets[j]);
+		seq_puts(m, "\n");
+	}
+	if (sony_acpi_stats_lost)
+		seq_printf(m, "lost: %lu\n", sony_acpi_stats_lost);
+	spin_unlock_irqrestore(&sony_acpi_stats_lock, flags);
+
+	return 0;
+}
+
+static int sony_acpi_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, sony_acpi_stats_show, NULL);
+}
+
+static const struct file_operations sony_acpi_stats_fops = {
+	.owner = THIS_MODULE,
+	.open = sony_acpi_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+/* sony_lock_stats_lock held */
+static void sony_lock_stats_print(struct seq_file *m,
+		struct sony_lock_stats *st)
+{
+	seq_printf(m, "%s", st->name);
+	if (st->handle)
+		seq_printf(m, ":0x%.4x", st->handle);
+	else
+		seq_puts(m, "       ");
+
+	seq_printf(m, " %-10lu %-10lu %-10llu %-10llu %-10llu %llu\n",
+			st->acquired, st->contended,
+			(unsigned long long) st->wait_us,
+			(unsigned long long) st->max_wait_us,
+			(unsigned long long) st->hold_us,
+			(unsigned long long) st->max_hold_us);
+}
+
+static int sony_lock_stats_show(struct seq_file *m, void *v)
+{
+	unsigned int i;
+
+	seq_puts(m, "lock        acquired   contended  wait(us)   "
+			"max wait   hold(us)   max hold\n");
+
+	spin_lock(&sony_lock_stats_lock);
+	for (i = 0; i < ARRAY_SIZE(sony_snc_lock_stats); i++) {
+		if (sony_snc_lock_stats[i].name)
+			sony_lock_stats_print(m, &sony_snc_lock_stats[i]);
+	}
+	sony_lock_stats_print(m, &sony_sn06_lock_stats);
+	spin_unlock(&sony_lock_stats_lock);
+
+	return 0;
+}
+
+static int sony_lock_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, sony_lock_stats_show, NULL);
+}
+
+static const struct file_operations sony_lock_stats_fops = {
+	.owner = THIS_MODULE,
+	.open = sony_lock_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+/* any write clears the collected statistics */
+static ssize_t sony_acpi_stats_reset_write(struct file *file,
+		const char __user *buf, size_t count, loff_t *pos)
+{
+	unsigned long flags;
+	unsigned int i;
+
+	spin_lock_irqsave(&sony_acpi_stats_lock, flags);
+	memset(sony_acpi_stats, 0, sizeof(sony_acpi_stats));
+	sony_acpi_stats_lost = 0;
+	spin_unlock_irqrestore(&sony_acpi_stats_lock, flags);
+
+	for (i = 0; i < ARRAY_SIZE(sony_snc_lock_stats); i++)
+		sony_lock_stats_reset(&sony_snc_lock_stats[i]);
+	sony_lock_stats_reset(&sony_sn06_lock_stats);
+
+	return count;
+}
+
+static const struct file_operations sony_acpi_stats_reset_fops = {
+	.owner = THIS_MODULE,
+	.write = sony_acpi_stats_reset_write,
+};
+
+/*
+ * resume profiles: the time spent in every step of the resume paths,
+ * a new profile is started by each suspend and the last
+ * SONY_RESUME_PROFILES are kept
+ */
+#define SONY_RESUME_PROFILES	8
+#define SONY_RESUME_STEPS	32
+
+struct sony_resume_step {
+	const char *name;
+	unsigned int handle;
+	s64 duration;	/* us */
+};
+
+struct sony_resume_profile {
+	unsigned int seq;
+	unsigned int steps_num;
+	unsigned int lost;
+	struct sony_resume_step steps[SONY_RESUME_STEPS];
+};
+
+static struct sony_resume_profile sony_resume_profiles[SONY_RESUME_PROFILES];
+static unsigned int sony_resume_seq;
+static DEFINE_SPINLOCK(sony_resume_lock);
+
+/* account the step started at start, handle is 0 for non SNC steps */
+static void sony_resume_step(const char *name, unsigned int handle,
+		ktime_t start)
+{
+	struct sony_resume_profile *p;
+	s64 us = ktime_us_delta(ktime_get(), start);
+	unsigned long flags;
+
+	spin_lock_irqsave(&sony_resume_lock, flags);
+	p = &sony_resume_profiles[sony_resume_seq % SONY_RESUME_PROFILES];
+	if (p->steps_num < SONY_RESUME_STEPS) {
+		p->steps[p->steps_num].name = name;
+		p->steps[p->steps_num].handle = handle;
+		p->steps[p->steps_num].duration = us;
+		p->steps_num++;
+	} else {
+		p->lost++;
+	}
+	spin_unlock_irqrestore(&sony_resume_lock, flags);
+}
+
+static int sony_resume_pm_notify(struct notifier_block *nb,
+		unsigned long action, void *data)
+{
+	struct sony_resume_profile *p;
+	unsigned long flags;
+
+	if (action != PM_SUSPEND_PREPARE && action != PM_HIBERNATION_PREPARE)
+		return NOTIFY_DONE;
+
+	spin_lock_irqsave(&sony_resume_lock, flags);
+	p = &sony_resume_profiles[++sony_resume_seq % SONY_RESUME_PROFILES];
+	p->seq = sony_resume_seq;
+	p->steps_num = 0;
+	p->lost = 0;
+	spin_unlock_irqrestore(&sony_resume_lock, flags);
+
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block sony_resume_pm_nb = {
+	.notifier_call = sony_resume_pm_notify,
+};
+
+static int sony_resume_profile_show(struct seq_file *m, void *v)
+{
+	unsigned int i, j;
+	unsigned long flags;
+
+	spin_lock_irqsave(&sony_resume_lock, flags);
+	for (i = SONY_RESUME_PROFILES; i > 0; i--) {
+		struct sony_resume_profile *p;
+		s64 total = 0;
+
+		if (sony_resume_seq < i - 1)
+			continue;
+
+		p = &sony_resume_profiles[(sony_resume_seq - (i - 1)) %
+			SONY_RESUME_PROFILES];
+		if (!p->steps_num)
+			continue;
+
+		seq_printf(m, "resume %u\n", p->seq);
+		for (j = 0; j < p->steps_num; j++) {
+			struct sony_resume_step *st = &p->steps[j];
+
+			seq_printf(m, "  %-12s", st->name);
+			if (st->handle)
+				seq_printf(m, " 0x%.4x", st->handle);
+			else
+				seq_puts(m, "       ");
+			seq_printf(m, " %10lld us\n", (long long) st->duration);
+			total += st->duration;
+		}
+		if (p->lost)
+			seq_printf(m, "  %u steps lost\n", p->lost);
+		seq_printf(m, "  total        %18lld us\n", (long long) total);
+	}
+	spin_unlock_irqrestore(&sony_resume_lock, flags);
+
+	return 0;
+}
+
+static int sony_resume_profile_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, sony_resume_profile_show, NULL);
+}
+
+static const struct file_operations sony_resume_profile_fops = {
+	.owner = THIS_MODULE,
+	.open = sony_resume_profile_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+/* event latency from the entry in the driver to the end of each stage */
+static const char * const sony_event_source_names[] = { "", "SNC", "SPIC" };
+static const char * const sony_event_stage_names[SONY_EVENT_STAGES] = {
+	"decode", "input", "queue", "deliver",
+};
+
+static unsigned long
+sony_event_latency[3][SONY_EVENT_STAGES][SONY_STATS_BUCKETS];
+static DEFINE_SPINLOCK(sony_event_latency_lock);
+
+static void sony_event_latency_account(u16 source,
+		enum sony_event_stage stage, s64 ns)
+{
+	unsigned long flags;
+
+	if (source >= ARRAY_SIZE(sony_event_latency))
+		return;
+
+	spin_lock_irqsave(&sony_event_latency_lock, flags);
+	sony_event_latency[source][stage][sony_stats_bucket(ns / 1000)]++;
+	spin_unlock_irqrestore(&sony_event_latency_lock, flags);
+}
+
+static int sony_event_latency_show(struct seq_file *m, void *v)
+{
+	unsigned int i, j, k;
+	unsigned long flags;
+
+	seq_puts(m, "source stage    buckets (log2 us)\n");
+
+	spin_lock_irqsave(&sony_event_latency_lock, flags);
+	for (i = 1; i < ARRAY_SIZE(sony_event_latency); i++) {
+		for (j = 0; j < SONY_EVENT_STAGES; j++) {
+			seq_printf(m, "%-6s %-8s", sony_event_source_names[i],
+					sony_event_stage_names[j]);
+			for (k = 0; k < SONY_STATS_BUCKETS; k++)
+				seq_printf(m, " %lu",
+						sony_event_latency[i][j][k]);
+			seq_puts(m, "\n");
+		}
+	}
+	spin_unlock_irqrestore(&sony_event_latency_lock, flags);
+
+	return 0;
+}
+
+static int sony_event_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, sony_event_latency_show, NULL);
+}
+
+/* any write clears the histograms */
+static ssize_t sony_event_latency_write(struct file *file,
+		const char __user *buf, size_t count, loff_t *pos)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&sony_event_latency_lock, flags);
+	memset(sony_event_latency, 0, sizeof(sony_event_latency));
+	spin_unlock_irqrestore(&sony_event_latency_lock, flags);
+
+	return count;
+}
+
+static const struct file_operations sony_event_latency_fops = {
+	.owner = THIS_MODULE,
+	.open = sony_event_latency_open,
+	.read = seq_read,
+	.write = sony_event_latency_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int sony_event_counters_show(struct seq_file *m, void *v)
+{
+	static const char * const fifos[SONY_FIFOS] = {
+		"input", "compat", "compat-record",
+	};
+	unsigned long count, total[SONY_FIFOS], coalesced[SONY_FIFOS];
+	unsigned int high_water[SONY_FIFOS];
+	unsigned int i, j;
+	int cpu;
+
+	memset(total, 0, sizeof(total));
+	memset(coalesced, 0, sizeof(coalesced));
+	memset(high_water, 0, sizeof(high_water));
+	for_each_possible_cpu(cpu) {
+		struct sony_event_counters *c =
+			per_cpu_ptr(&sony_event_counters, cpu);
+
+		for (i = 0; i < SONY_FIFOS; i++) {
+			total[i] += c->dropped[i];
+			coalesced[i] += c->coalesced[i];
+			high_water[i] = max(high_water[i], c->high_water[i]);
+		}
+	}
+
+	seq_puts(m, "fifo           high-water dropped    coalesced\n");
+	for (i = 0; i < SONY_FIFOS; i++)
+		seq_printf(m, "%-14s %-10u %-10lu %lu\n", fifos[i],
+				high_water[i], total[i], coalesced[i]);
+
+	seq_puts(m, "\nsource code  events\n");
+	for (i = 0; i < 2; i++) {
+		count = 0;
+		for_each_possible_cpu(cpu)
+			count += per_cpu_ptr(&sony_event_counters,
+					cpu)->unknown[i];
+		seq_printf(m, "%-6s %-5s %lu\n",
+				sony_event_source_names[i + 1], "?", count);
+
+		for (j = 0; j < 0x100; j++) {
+			count = 0;
+			for_each_possible_cpu(cpu)
+				count += per_cpu_ptr(&sony_event_counters,
+						cpu)->events[i][j];
+			if (count)
+				seq_printf(m, "%-6s 0x%.2x  %lu\n",
+					sony_event_source_names[i + 1], j,
+					count);
+		}
+	}
+
+	return 0;
+}
+
+static int sony_event_counters_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, sony_event_counters_show, NULL);
+}
+
+/* any write clears the counters */
+static ssize_t sony_event_counters_write(struct file *file,
+		const char __user *buf, size_t count, loff_t *pos)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		memset(per_cpu_ptr(&sony_event_counters, cpu), 0,
+				sizeof(struct sony_event_counters));
+
+	return count;
+}
+
+static const struct file_operations sony_event_counters_fops = {
+	.owner = THIS_MODULE,
+	.open = sony_event_counters_open,
+	.read = seq_read,
+	.write = sony_event_counters_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static void sony_laptop_debugfs_setup(void)
+{
+	sony_laptop_debugfs = debugfs_create_dir("sony-laptop", NULL);
+	if (IS_ERR_OR_NULL(sony_laptop_debugfs)) {
+		sony_laptop_debugfs = NULL;
+		return;
+	}
+
+	debugfs_create_file("acpi_latency", S_IRUGO, sony_laptop_debugfs,
+			NULL, &sony_acpi_stats_fops);
+	debugfs_create_file("acpi_latency_reset", S_IWUSR,
+			sony_laptop_debugfs, NULL,
+			&sony_acpi_stats_reset_fops);
+	debugfs_create_file("lock_contention", S_IRUGO, sony_laptop_debugfs,
+			NULL, &sony_lock_stats_fops);
+	debugfs_create_file("resume_profile", S_IRUGO, sony_laptop_debugfs,
+			NULL, &sony_resume_profile_fops);
+	debugfs_create_file("event_latency", S_IRUGO | S_IWUSR,
+			sony_laptop_debugfs, NULL, &sony_event_latency_fops);
+	debugfs_create_file("event_counters", S_IRUGO | S_IWUSR,
+			sony_laptop_debugfs, NULL, &sony_event_counters_fops);
+
+	register_pm_notifier(&sony_resume_pm_nb);
+}
+
+static void sony_laptop_debugfs_cleanup(void)
+{
+	if (sony_laptop_debugfs)
+		unregister_pm_notifier(&sony_resume_pm_nb);
+	debugfs_remove_recursive(sony_laptop_debugfs);
+	sony_laptop_debugfs = NULL;
+}
+#else
+static inline void sony_acpi_stats_account(const char *method,
+		unsigned int handle, unsigned int cmd, ktime_t start,
+		int error) { }
+static inline void sony_resume_step(const char *name, unsigned int handle,
+		ktime_t start) { }
+static inline void sony_event_latency_account(u16 source,
+		enum sony_event_stage stage, s64 ns) { }
+static inline void sony_laptop_debugfs_setup(void) { }
+static inline void sony_laptop_debugfs_cleanup(void) { }
+#endif
+
+/* the event reached every queue, account the stages it went through */
+static void sony_event_stamp_done(struct sony_event_stamp *st)
+{
+	s64 ns[SONY_EVENT_DELIVER];
+	unsigned int i;
+
+	for (i = 0; i < SONY_EVENT_DELIVER; i++) {
+		ns[i] = ktime_to_ns(ktime_sub(st->stage[i], st->start));
+		sony_event_latency_account(st->source, i, ns[i]);
+	}
+
+	trace_sony_event_latency(st->source, st->code,
+			ns[SONY_EVENT_DECODE], ns[SONY_EVENT_INPUT],
+			ns[SONY_EVENT_QUEUE]);
+}
+
+/* a reader dequeued or acknowledged the event that entered at start */
+static void sony_event_delivered(u16 source, u16 code, ktime_t start)
+{
+	s64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	sony_event_latency_account(source, SONY_EVENT_DELIVER, ns);
+	trace_sony_event_delivery(source, code, ns);
+}
+
+/*
+ * Firmware access: every AML evaluation, EC access and SPIC port access
+ * of the driver goes through sony_backend, tools/emu replaces it with
+ * an emulated SNC/EC/SPIC to run the driver in userspace.
+ */
+struct sony_laptop_backend {
+	acpi_status (*evaluate)(acpi_handle handle, char *name,
+			struct acpi_object_list *params,
+			struct acpi_buffer *output);
+	int (*ec_read)(u8 addr, u8 *value);
+	int (*ec_write)(u8 addr, u8 value);
+	u8 (*inb)(unsigned long port);
+	void (*outb)(u8 value, unsigned long port);
+};
+
+static u8 sony_native_inb(unsigned long port)
+{
+	return inb_p(port);
+}
+
+static void sony_native_outb(u8 value, unsigned long port)
+{
+	outb(value, port);
+}
+
+static const struct sony_laptop_backend sony_native_backend = {
+	.evaluate = acpi_evaluate_object,
+	.ec_read = ec_read,
+	.ec_write = ec_write,
+	.inb = sony_native_inb,
+	.outb = sony_native_outb,
+};
+
+static const struct sony_laptop_backend *sony_backend = &sony_native_backend;
+
+static acpi_status sony_acpi_evaluate(acpi_handle handle, char *name,
+		struct acpi_object_list *params, struct acpi_buffer *output)
+{
+	return sony_backend->evaluate(handle, name, params, output);
+}
+
+static inline int sony_ec_read(u8 addr, u8 *value)
+{
+	return sony_backend->ec_read(addr, value);
+}
+
+static inline int sony_ec_write(u8 addr, u8 value)
+{
+	return sony_backend->ec_write(addr, value);
+}
+
+static inline u8 sony_inb(unsigned long port)
+{
+	return sony_backend->inb(port);
+}
+
+static inline void sony_outb(u8 value, unsigned long port)
+{
+	sony_backend->outb(value, port);
+}
+
+/*********** Platform Device ***********/
+static struct platform_device *sony_pf_device;
+
+/*
+ * The non critical part of the SNC resume runs in background once the
+ * tasks are thawed, the paths changing the state it restores wait for
+ * it to complete first.  Done from the module load on, the SPIC alone
+ * registers such paths too.
+ */
+static DECLARE_COMPLETION(sony_nc_resume_done);
+
+static int sony_nc_resume_wait(void)
+{
+	if (wait_for_completion_interruptible(&sony_nc_resume_done))
+		return -ERESTARTSYS;
+
+	return 0;
+}
+
+/*
+ * Ordered command queue for the slow sysfs stores: when async_store
+ * is set the store only validates its input, queues the EC/ACPI part
+ * and returns. Commands are numbered, the number of the last completed
+ * one is available in command_seq and sent with a uevent.
+ */
+struct sony_pf_cmd {
+	struct work_struct work;
+	int (*set)(unsigned long);
+	unsigned long value;
+	unsigned int seq;
+};
+
+static struct workqueue_struct *sony_pf_wq;
+static DEFINE_SPINLOCK(sony_pf_cmd_lock);
+static unsigned int sony_pf_cmd_queued;
+static unsigned int sony_pf_cmd_done;
+static int sony_pf_cmd_status;
+
+static void sony_pf_cmd_work(struct work_struct *work)
+{
+	struct sony_pf_cmd *cmd = container_of(work, struct sony_pf_cmd, work);
+	char seq[32], status[32];
+	char *env[] = { seq, status, NULL };
+	int ret = cmd->set(cmd->value);
+
+	spin_lock(&sony_pf_cmd_lock);
+	sony_pf_cmd_done = cmd->seq;
+	sony_pf_cmd_status = ret;
+	spin_unlock(&sony_pf_cmd_lock);
+
+	snprintf(seq, sizeof(seq), "SONY_CMD_SEQ=%u", cmd->seq);
+	snprintf(status, sizeof(status), "SONY_CMD_STATUS=%d", ret);
+	kobject_uevent_env(&sony_pf_device->dev.kobj, KOBJ_CHANGE, env);
+
+	kfree(cmd);
+}
+
+/* run the setter of a validated store, in background if requested */
+static ssize_t sony_pf_cmd_submit(int (*set)(unsigned long),
+		unsigned long value, size_t count)
+{
+	struct sony_pf_cmd *cmd = NULL;
+	int ret;
+
+	ret = sony_nc_resume_wait();
+	if (ret)
+		return ret;
+
+	if (async_store)
+		cmd = kmalloc(sizeof(struct sony_pf_cmd), GFP_KERNEL);
+
+	if (cmd) {
+		INIT_WORK(&cmd->work, sony_pf_cmd_work);
+		cmd->set = set;
+		cmd->value = value;
+
+		/* numbering and queueing must happen in the same order */
+		spin_lock(&sony_pf_cmd_lock);
+		if (sony_pf_wq) {
+			cmd->seq = ++sony_pf_cmd_queued;
+			queue_work(sony_pf_wq, &cmd->work);
+			spin_unlock(&sony_pf_cmd_lock);
+			return count;
+		}
+		spin_unlock(&sony_pf_cmd_lock);
+		kfree(cmd);
+	}
+
+	ret = set(value);
+	return ret < 0 ? ret : count;
+}
+
+/*
+ * complete the queued commands and stop queueing new ones, has to be
+ * called before the features the commands refer to are released
+ */
+static void sony_pf_cmd_drain(void)
+{
+	struct workqueue_struct *wq;
+
+	spin_lock(&sony_pf_cmd_lock);
+	wq = sony_pf_wq;
+	sony_pf_wq = NULL;
+	spin_unlock(&sony_pf_cmd_lock);
+
+	if (wq)
+		destroy_workqueue(wq);
+}
+
+/* queued, completed sequence numbers and status of the last command */
+static ssize_t sony_pf_cmd_seq_show(struct device *dev,
+		struct device_attribute *attr, char *buffer)
+{
+	ssize_t count;
 
-	if (sony_laptop_input.jog_dev) {
-		input_unregister_device(sony_laptop_input.jog_dev);
-		sony_laptop_input.jog_dev = NULL;
-	}
+	spin_lock(&sony_pf_cmd_lock);
+	count = snprintf(buffer, PAGE_SIZE, "%u %u %d\n", sony_pf_cmd_queued,
+			sony_pf_cmd_done, sony_pf_cmd_status);
+	spin_unlock(&sony_pf_cmd_lock);
 
-	kfifo_free(&sony_laptop_input.fifo);
+	return count;
 }
 
-/*********** Platform Device ***********/
+static struct device_attribute sony_pf_cmd_seq_attr =
+	__ATTR(command_seq, S_IRUGO, sony_pf_cmd_seq_show, NULL);
+
 #ifdef SONY_ZSERIES
 static int sony_ovga_dsm(int func, int arg)
 {
@@ -571,6 +1990,7 @@ static int sony_ovga_dsm(int func, int arg)
 	struct acpi_object_list input;
 	union acpi_object params[4];
 	int result;
+	ktime_t start;
 
 	input.count = 4;
 	input.pointer = params;
@@ -584,7 +2004,9 @@ static int sony_ovga_dsm(int func, int arg)
 	params[3].type = ACPI_TYPE_INTEGER;
 	params[3].integer.value = arg;
 
-	result = acpi_evaluate_object(NULL, (char*)sony_acpi_path_dsm[sony_dsm_type], &input, &output);
+	start = ktime_get();
+	result = sony_acpi_evaluate(sony_dsm_handle, NULL, &input, &output);
+	sony_acpi_stats_account("_DSM", func, arg, start, result);
 	if (result) {
 		printk("%s failed: %d, func %d, para, %d.\n", sony_acpi_path_dsm[sony_dsm_type], result, func, arg);
 		return -1;
@@ -624,23 +2046,32 @@ static int sony_dgpu_on(void)
 	return sony_ovga_dsm(3, 0x01);
 }
 
-static ssize_t sony_pf_store_speed_stamina(struct device *dev,
-			       struct device_attribute *attr,
-			       const char *buffer, size_t count)
+static int sony_pf_speed_stamina_set(unsigned long speed)
 {
-	if (!strncmp(buffer, "speed", strlen("speed"))) {
+	if (speed) {
 		sony_dgpu_on();
 		sony_led_speed();
 		speed_stamina = 1;
-	} else
-	if (!strncmp(buffer, "stamina", strlen("stamina"))) {
+	} else {
 		sony_dgpu_off();
 		sony_led_stamina();
 		speed_stamina = 0;
-	} else
-		return -EINVAL;
+	}
 
-	return count;
+	return 0;
+}
+
+static ssize_t sony_pf_store_speed_stamina(struct device *dev,
+			       struct device_attribute *attr,
+			       const char *buffer, size_t count)
+{
+	if (!strncmp(buffer, "speed", strlen("speed")))
+		return sony_pf_cmd_submit(sony_pf_speed_stamina_set, 1, count);
+	else
+	if (!strncmp(buffer, "stamina", strlen("stamina")))
+		return sony_pf_cmd_submit(sony_pf_speed_stamina_set, 0, count);
+	else
+		return -EINVAL;
 }
 
 static ssize_t sony_pf_show_speed_stamina(struct device *dev,
@@ -658,16 +2089,24 @@ static int sony_pf_probe(struct platform_device *pdev)
 	int result;
 
 	/* Determine which variant, VGN or VPC */
-	if(ACPI_SUCCESS(acpi_callgetfunc(NULL, "\\_SB.PCI0.P0P2.DGPU._STA", &result)))
+	if(ACPI_SUCCESS(__acpi_callgetfunc(NULL, "\\_SB.PCI0.P0P2.DGPU._STA", &result)))
 		sony_dsm_type = 1;
 
 	pr_info("Determined GFX switch ACPI path as %s.\n", sony_acpi_path_dsm[sony_dsm_type]);
+
+	if (ACPI_FAILURE(acpi_get_handle(NULL, sony_acpi_path_dsm[sony_dsm_type], &sony_dsm_handle)))
+		sony_dsm_handle = NULL;
+	if (ACPI_FAILURE(acpi_get_handle(NULL, sony_acpi_path_hsc1[sony_dsm_type], &sony_hsc1_handle)))
+		sony_hsc1_handle = NULL;
+	if (ACPI_FAILURE(acpi_get_handle(NULL, "\\_SB.ADP1._PSR", &sony_psr_handle)))
+		sony_psr_handle = NULL;
+
 	result = device_create_file(&pdev->dev, &sony_pf_speed_stamina_attr);
 	if (result)
 		printk(KERN_DEBUG "sony_pf_probe: failed to add speed/stamina switch\n");
 
 	/* initialize default, look at module param speed_stamina or switch */
-	if (!ACPI_SUCCESS(acpi_callgetfunc(NULL, sony_acpi_path_hsc1[sony_dsm_type], &result))) {
+	if (!ACPI_SUCCESS(acpi_callgetfunc(sony_hsc1_handle, "HSC1", &result))) {
 		result = -1;
 		dprintk("sony_nc_notify: "
 			"cannot query speed/stamina switch\n");
@@ -679,7 +2118,7 @@ static int sony_pf_probe(struct platform_device *pdev)
 			speed_stamina = 1;
 		else if((result & 0x80) && sony_dsm_type == 1)
 		{
-			if((ACPI_SUCCESS(acpi_callgetfunc(NULL, "\\_SB.ADP1._PSR", &result))) && (result == 1))
+			if((ACPI_SUCCESS(acpi_callgetfunc(sony_psr_handle, "_PSR", &result))) && (result == 1))
 			{
 				pr_info("PSU connected - Selecting speed mode.\n");
 				speed_stamina = 1;
@@ -698,6 +2137,8 @@ static int sony_pf_probe(struct platform_device *pdev)
 }
 static int sony_resume_noirq(struct device *pdev)
 {
+	ktime_t start = ktime_get();
+
 	/* on resume, restore previous state */
 	if (speed_stamina == 1) {
 		sony_dgpu_on();
@@ -706,6 +2147,7 @@ static int sony_resume_noirq(struct device *pdev)
 		sony_dgpu_off();
 		sony_led_stamina();
 	}
+	sony_resume_step("DSM", 0, start);
 	return 0;
 }
 
@@ -731,7 +2173,6 @@ static struct platform_driver sony_pf_driver = {
 	.probe  = sony_pf_probe,
 #endif
 };
-static struct platform_device *sony_pf_device;
 
 static int sony_pf_add(void)
 {
@@ -755,6 +2196,14 @@ static int sony_pf_add(void)
 	if (ret)
 		goto out_platform_alloced;
 
+	sony_pf_wq = alloc_ordered_workqueue("sony-laptop", 0);
+	if (!sony_pf_wq)
+		pr_warn("unable to create the command queue, "
+				"stores will be synchronous\n");
+	else if (device_create_file(&sony_pf_device->dev,
+				&sony_pf_cmd_seq_attr))
+		pr_warn("unable to create command_seq\n");
+
 	return 0;
 
 out_platform_alloced:
@@ -773,6 +2222,9 @@ static void sony_pf_remove(void)
 	if (!atomic_dec_and_test(&sony_pf_users))
 		return;
 
+	sony_pf_cmd_drain();
+	device_remove_file(&sony_pf_device->dev, &sony_pf_cmd_seq_attr);
+
 	platform_device_unregister(sony_pf_device);
 	platform_driver_unregister(&sony_pf_driver);
 }
@@ -797,6 +2249,8 @@ struct sony_nc_value {
 	char *name;		/* name of the entry */
 	char **acpiget;		/* names of the ACPI get function */
 	char **acpiset;		/* names of the ACPI set function */
+	acpi_handle getter;	/* resolved ACPI get function */
+	acpi_handle setter;	/* resolved ACPI set function */
 	int (*validate)(const int, const int);	/* input/output validation */
 	int value;		/* current setting */
 	int valid;		/* Has ever been set */
@@ -879,10 +2333,52 @@ static struct sony_nc_value sony_nc_values[] = {
 static acpi_handle sony_nc_acpi_handle;
 static struct acpi_device *sony_nc_acpi_device;
 
+/* SNC methods resolved once at sony_nc_add time, NULL if not present */
+enum sony_nc_method {
+	SNC_SN00,
+	SNC_SN01,
+	SNC_SN02,
+	SNC_SN03,
+	SNC_SN05,
+	SNC_SN06,
+	SNC_SN07,
+	SNC_GBRT,
+	SNC_SBRT,
+	SNC_ECON,
+	N_SNC_METHODS
+};
+
+static const char * const sony_nc_method_names[N_SNC_METHODS] = {
+	[SNC_SN00] = "SN00",
+	[SNC_SN01] = "SN01",
+	[SNC_SN02] = "SN02",
+	[SNC_SN03] = "SN03",
+	[SNC_SN05] = "SN05",
+	[SNC_SN06] = "SN06",
+	[SNC_SN07] = "SN07",
+	[SNC_GBRT] = "GBRT",
+	[SNC_SBRT] = "SBRT",
+	[SNC_ECON] = "ECON",
+};
+
+static acpi_handle sony_nc_methods[N_SNC_METHODS];
+
+static void sony_nc_resolve_methods(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < N_SNC_METHODS; i++) {
+		if (ACPI_FAILURE(acpi_get_handle(sony_nc_acpi_handle,
+					(char *) sony_nc_method_names[i],
+					&sony_nc_methods[i])))
+			sony_nc_methods[i] = NULL;
+	}
+}
+
 /*
  * acpi_evaluate_object wrappers
  */
-static int acpi_callgetfunc(acpi_handle handle, char *name,
+static int __acpi_callgetfunc(acpi_handle handle, char *name,
 				unsigned int *result)
 {
 	struct acpi_buffer output;
@@ -892,7 +2388,7 @@ static int acpi_callgetfunc(acpi_handle handle, char *name,
 	output.length = sizeof(out_obj);
 	output.pointer = &out_obj;
 
-	status = acpi_evaluate_object(handle, name, NULL, &output);
+	status = sony_acpi_evaluate(handle, name, NULL, &output);
 	if ((status == AE_OK) && (out_obj.type == ACPI_TYPE_INTEGER)) {
 		*result = out_obj.integer.value;
 		return 0;
@@ -903,7 +2399,7 @@ static int acpi_callgetfunc(acpi_handle handle, char *name,
 	return -1;
 }
 
-static int acpi_callsetfunc(acpi_handle handle, char *name, u32 value,
+static int __acpi_callsetfunc(acpi_handle handle, char *name, u32 value,
 				unsigned int *result)
 {
 	struct acpi_object_list params;
@@ -920,7 +2416,7 @@ static int acpi_callsetfunc(acpi_handle handle, char *name, u32 value,
 	output.length = sizeof(out_obj);
 	output.pointer = &out_obj;
 
-	status = acpi_evaluate_object(handle, name, &params, &output);
+	status = sony_acpi_evaluate(handle, name, &params, &output);
 	if (status == AE_OK) {
 		if (result != NULL) {
 			if (out_obj.type != ACPI_TYPE_INTEGER) {
@@ -938,6 +2434,73 @@ static int acpi_callsetfunc(acpi_handle handle, char *name, u32 value,
 	return -1;
 }
 
+/*
+ * preallocated SN06 result, large enough for the biggest known reply
+ * (the 32 bytes ODD table).  SN06 may write to the firmware, a longer
+ * reply is an error, the method is never evaluated twice.
+ */
+#define SN06_BUFFER_SIZE	64
+static struct {
+	union acpi_object obj;
+	u8 data[SN06_BUFFER_SIZE];
+} sony_nc_sn06_result;
+static DEFINE_MUTEX(sony_nc_sn06_lock);
+
+/* evaluations accounted in the statistics under label and cmd */
+static int acpi_callgetfunc(acpi_handle handle, const char *label,
+				unsigned int *result)
+{
+	ktime_t start = ktime_get();
+	int ret = __acpi_callgetfunc(handle, NULL, result);
+
+	sony_acpi_stats_account(label, 0, 0, start, ret);
+
+	return ret;
+}
+
+static int acpi_callsetfunc(acpi_handle handle, const char *label,
+		unsigned int cmd, u32 value, unsigned int *result)
+{
+	ktime_t start = ktime_get();
+	int ret = __acpi_callsetfunc(handle, NULL, value, result);
+
+	sony_acpi_stats_account(label, 0, cmd, start, ret);
+
+	return ret;
+}
+
+/* the SN00 argument is a sub-command, the other methods take values */
+static int sony_nc_method_get(int method, unsigned int *result)
+{
+	return acpi_callgetfunc(sony_nc_methods[method],
+			sony_nc_method_names[method], result);
+}
+
+static int sony_nc_method_set(int method, u32 value, unsigned int *result)
+{
+	return acpi_callsetfunc(sony_nc_methods[method],
+			sony_nc_method_names[method],
+			method == SNC_SN00 ? value : 0, value, result);
+}
+
+/* the names are left on the resolved method by sony_nc_add */
+static const char *sony_nc_value_label(char **names)
+{
+	return names && *names ? *names : "?";
+}
+
+static int sony_nc_value_get(struct sony_nc_value *item, unsigned int *value)
+{
+	return acpi_callgetfunc(item->getter,
+			sony_nc_value_label(item->acpiget), value);
+}
+
+static int sony_nc_value_set(struct sony_nc_value *item, u32 value)
+{
+	return acpi_callsetfunc(item->setter,
+			sony_nc_value_label(item->acpiset), 0, value, NULL);
+}
+
 static int acpi_callsetfunc_buffer(acpi_handle handle, u64 value,
 					u8 array[], unsigned int size)
 {
@@ -946,7 +2509,8 @@ static int acpi_callsetfunc_buffer(acpi_handle handle, u64 value,
 	struct acpi_object_list params;
 	union acpi_object in_obj;
 	union acpi_object *values;
-	struct acpi_buffer output = {ACPI_ALLOCATE_BUFFER, NULL};
+	struct acpi_buffer output = { sizeof(sony_nc_sn06_result),
+					&sony_nc_sn06_result };
 	acpi_status status;
 
 	if (!array || !size)
@@ -964,8 +2528,14 @@ static int acpi_callsetfunc_buffer(acpi_handle handle, u64 value,
 	/* since SN06 is the only known method returning a buffer we
 	 * can hard code it, it is not necessary to have a parameter
 	 */
-	status = acpi_evaluate_object(sony_nc_acpi_handle, "SN06", &params,
+	sony_lock_timed(&sony_nc_sn06_lock, &sony_sn06_lock_stats);
+	status = sony_acpi_evaluate(sony_nc_methods[SNC_SN06], NULL, &params,
 			&output);
+	if (status == AE_BUFFER_OVERFLOW) {
+		pr_warn("SN06 reply too long (%u bytes)\n",
+				(unsigned int) output.length);
+		goto error;
+	}
 	values = (union acpi_object *) output.pointer;
 	if (ACPI_FAILURE(status) || !values) {
 		dprintk("acpi_evaluate_object failed\n");
@@ -1000,17 +2570,61 @@ static int acpi_callsetfunc_buffer(acpi_handle handle, u64 value,
 	}
 
 error:
-	kfree(output.pointer);
+	mutex_unlock(&sony_nc_sn06_lock);
 	return length;
 }
 
+/*
+ * SNC handles registry: every known handle is bound once at setup time
+ * to its feature callbacks, any of them can be NULL
+ */
+struct sony_nc_handle_ops {
+	int (*setup)(struct platform_device *, unsigned int);
+	int (*cleanup)(struct platform_device *);
+	void (*resume)(unsigned int);
+	/* returns the event type or < 0 when the event has been consumed */
+	int (*notify)(struct acpi_device *, unsigned int, int *);
+	/* lifetime (ms) of the cached query results */
+	unsigned int *cache_ttl;
+};
+
+/* handles in the 0x01xx range are resolved through a direct index */
+#define SNC_HANDLE_BASE		0x0100
+#define SNC_HANDLE_INDEX(h)	((h) - SNC_HANDLE_BASE)
+#define SNC_HANDLE_INDEXED(h)	(((h) & 0xff00) == SNC_HANDLE_BASE)
+
 struct sony_nc_handles {
 	u16 cap[0x10];
+	s8 offset[0x100];	/* handle -> offset, -1 if not present */
+	const struct sony_nc_handle_ops *ops[0x10];
+	/* serializes the commands and transactions on a single handle */
+	struct mutex lock[0x10];
 	struct device_attribute devattr;
 };
 
 static struct sony_nc_handles *handles;
 
+/*
+ * ops[] is set once the setup of the feature is over and read without
+ * a lock by the notifications and the cached calls
+ */
+static inline void sony_nc_handle_ops_set(unsigned int offset,
+		const struct sony_nc_handle_ops *ops)
+{
+	smp_wmb();
+	ACCESS_ONCE(handles->ops[offset]) = ops;
+}
+
+static inline const struct sony_nc_handle_ops *sony_nc_handle_ops(
+		unsigned int offset)
+{
+	const struct sony_nc_handle_ops *ops =
+		ACCESS_ONCE(handles->ops[offset]);
+
+	smp_rmb();
+	return ops;
+}
+
 static ssize_t sony_nc_handles_show(struct device *dev,
 		struct device_attribute *attr, char *buffer)
 {
@@ -1034,12 +2648,24 @@ static int sony_nc_handles_setup(struct platform_device *pd)
 	if (!handles)
 		return -ENOMEM;
 
+	memset(handles->offset, 0xff, sizeof(handles->offset));
+
 	for (i = 0; i < ARRAY_SIZE(handles->cap); i++) {
-		if (!acpi_callsetfunc(sony_nc_acpi_handle,
-					"SN00", i + 0x20, &result)) {
+		mutex_init(&handles->lock[i]);
+
+		if (!sony_nc_method_set(SNC_SN00, i + 0x20, &result)) {
 			dprintk("caching handle 0x%.4x (offset: 0x%.2x)\n",
 					result, i);
 			handles->cap[i] = result;
+			if (result) {
+				sony_snc_lock_stats[i].name = "SN07";
+				sony_snc_lock_stats[i].handle = result;
+			}
+
+			/* keep the first offset found for a handle */
+			if (result && SNC_HANDLE_INDEXED(result) &&
+				handles->offset[SNC_HANDLE_INDEX(result)] < 0)
+				handles->offset[SNC_HANDLE_INDEX(result)] = i;
 		}
 	}
 
@@ -1079,7 +2705,16 @@ static int sony_find_snc_handle(unsigned int handle)
 	if (!handles || !handle)
 		return -1;
 
-	for (i = 0; i < 0x10; i++) {
+	if (SNC_HANDLE_INDEXED(handle)) {
+		i = handles->offset[SNC_HANDLE_INDEX(handle)];
+		if (i >= 0)
+			return i;
+
+		dprintk("handle 0x%.4x not found\n", handle);
+		return -1;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(handles->cap); i++) {
 		if (handles->cap[i] == handle) {
 			dprintk("found handle 0x%.4x (offset: 0x%.2x)\n",
 					handle, i);
@@ -1090,22 +2725,332 @@ static int sony_find_snc_handle(unsigned int handle)
 	return -1;
 }
 
-/* call command method SN07, accepts a 32 bit integer, returns a integer */
-static int sony_call_snc_handle(unsigned int handle, unsigned int argument,
-				unsigned int *result)
+/*
+ * Every handle has its own lock, multi-step transactions on a feature
+ * take it with sony_nc_handle_lock() and use the __ prefixed calls,
+ * everything else locks around the single call.
+ */
+static int sony_nc_handle_lock(unsigned int handle)
+{
+	int offset = sony_find_snc_handle(handle);
+
+	if (offset < 0)
+		return -1;
+
+	sony_lock_timed(&handles->lock[offset], &sony_snc_lock_stats[offset]);
+
+	return 0;
+}
+
+static void sony_nc_handle_unlock(unsigned int handle)
+{
+	int offset = sony_find_snc_handle(handle);
+
+	if (offset < 0)
+		return;
+
+	sony_unlock_timed(&handles->lock[offset],
+			&sony_snc_lock_stats[offset]);
+}
+
+/* call command method SN07, the handle lock must be held */
+static int __sony_call_snc_handle(unsigned int handle, unsigned int argument,
+				unsigned int *result)
+{
+	int ret = 0;
+	int offset = sony_find_snc_handle(handle);
+	ktime_t start;
+
+	if (offset < 0)
+		return -1;
+
+	/* max 32 bit wide argument, for wider input use SN06 */
+	trace_sony_snc_call_entry("SN07", handle, argument);
+	start = ktime_get();
+	ret = __acpi_callsetfunc(sony_nc_methods[SNC_SN07], NULL,
+			offset | argument, result);
+	sony_acpi_stats_account("SN07", handle, argument & 0xffff, start, ret);
+	if (trace_sony_snc_call_exit_enabled())
+		trace_sony_snc_call_exit("SN07", handle, argument, *result,
+				ret,
+				ktime_to_ns(ktime_sub(ktime_get(), start)));
+	return ret;
+}
+
+/* call command method SN07, accepts a 32 bit integer, returns a integer */
+static int sony_call_snc_handle(unsigned int handle, unsigned int argument,
+				unsigned int *result)
+{
+	int ret;
+
+	if (sony_nc_handle_lock(handle))
+		return -1;
+
+	ret = __sony_call_snc_handle(handle, argument, result);
+	sony_nc_handle_unlock(handle);
+
+	return ret;
+}
+
+/* a single SN07 command of a batch, result and ret are filled in */
+struct sony_nc_command {
+	unsigned int handle;
+	unsigned int argument;
+	unsigned int result;
+	int ret;
+};
+
+/*
+ * run a sequence of SN07 commands, the locks of the handles involved
+ * must be held; all the commands are executed regardless of failures,
+ * returns -1 if any of them failed
+ */
+static int __sony_call_snc_handle_batch(struct sony_nc_command *cmds,
+					unsigned int num)
+{
+	unsigned int i;
+	int ret = 0;
+
+	for (i = 0; i < num; i++) {
+		cmds[i].result = 0;
+		cmds[i].ret = __sony_call_snc_handle(cmds[i].handle,
+				cmds[i].argument, &cmds[i].result);
+		if (cmds[i].ret)
+			ret = -1;
+	}
+
+	return ret;
+}
+
+/* same as above, the whole sequence runs under a single lock hold */
+static int sony_call_snc_handle_batch(struct sony_nc_command *cmds,
+					unsigned int num)
+{
+	unsigned int i;
+	u16 offsets = 0;
+	int ret;
+
+	if (!handles)
+		return -1;
+
+	/* lock in offset order, batches may span several handles */
+	for (i = 0; i < num; i++) {
+		int offset = sony_find_snc_handle(cmds[i].handle);
+
+		if (offset >= 0)
+			offsets |= 1 << offset;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(handles->lock); i++) {
+		if (offsets & (1 << i))
+			sony_lock_timed(&handles->lock[i],
+					&sony_snc_lock_stats[i]);
+	}
+
+	ret = __sony_call_snc_handle_batch(cmds, num);
+
+	for (i = ARRAY_SIZE(handles->lock); i > 0; i--) {
+		if (offsets & (1 << (i - 1)))
+			sony_unlock_timed(&handles->lock[i - 1],
+					&sony_snc_lock_stats[i - 1]);
+	}
+
+	return ret;
+}
+
+/*
+ * SN07 read-through cache, slots are kept per handle offset and hold
+ * the last results of the plain queries (no input value) of a feature
+ */
+#define SNC_CACHE_SLOTS	4
+struct sony_nc_cache_entry {
+	unsigned int argument;
+	unsigned int result;
+	unsigned long expires;
+	bool valid;
+};
+
+static struct sony_nc_cache_entry sony_nc_cache[0x10][SNC_CACHE_SLOTS];
+static unsigned int sony_nc_cache_next[0x10];
+/* bumped by every invalidation, a query overlapping one is not cached */
+static unsigned int sony_nc_cache_gen[0x10];
+static DEFINE_SPINLOCK(sony_nc_cache_lock);
+
+static void sony_nc_cache_invalidate_offset(int offset)
+{
+	unsigned int i;
+
+	if (offset < 0 || offset >= ARRAY_SIZE(sony_nc_cache))
+		return;
+
+	spin_lock(&sony_nc_cache_lock);
+	for (i = 0; i < SNC_CACHE_SLOTS; i++)
+		sony_nc_cache[offset][i].valid = false;
+	sony_nc_cache_gen[offset]++;
+	spin_unlock(&sony_nc_cache_lock);
+}
+
+/* to be called by every path changing the state behind a handle */
+static void sony_nc_cache_invalidate(unsigned int handle)
+{
+	sony_nc_cache_invalidate_offset(sony_find_snc_handle(handle));
+}
+
+/* SN07 writes, the cached results are dropped once the write is done */
+static int __sony_call_snc_handle_write(unsigned int handle,
+				unsigned int argument, unsigned int *result)
+{
+	int ret = __sony_call_snc_handle(handle, argument, result);
+
+	sony_nc_cache_invalidate(handle);
+	return ret;
+}
+
+static int sony_call_snc_handle_write(unsigned int handle,
+				unsigned int argument, unsigned int *result)
+{
+	int ret = sony_call_snc_handle(handle, argument, result);
+
+	sony_nc_cache_invalidate(handle);
+	return ret;
+}
+
+static void sony_nc_cache_invalidate_all(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(sony_nc_cache); i++)
+		sony_nc_cache_invalidate_offset(i);
+}
+
+/* same as sony_call_snc_handle, serves the result from the cache if fresh */
+static int sony_call_snc_handle_cached(unsigned int handle,
+				unsigned int argument, unsigned int *result)
+{
+	const struct sony_nc_handle_ops *ops;
+	struct sony_nc_cache_entry *entry;
+	unsigned int i, gen, ttl = 0;
+	int ret;
+	int offset = sony_find_snc_handle(handle);
+
+	if (offset < 0)
+		return -1;
+
+	ops = sony_nc_handle_ops(offset);
+	if (ops && ops->cache_ttl)
+		ttl = *ops->cache_ttl;
+
+	if (!ttl)
+		return sony_call_snc_handle(handle, argument, result);
+
+	spin_lock(&sony_nc_cache_lock);
+	for (i = 0; i < SNC_CACHE_SLOTS; i++) {
+		entry = &sony_nc_cache[offset][i];
+		if (entry->valid && entry->argument == argument &&
+				time_before(jiffies, entry->expires)) {
+			*result = entry->result;
+			spin_unlock(&sony_nc_cache_lock);
+			return 0;
+		}
+	}
+	gen = sony_nc_cache_gen[offset];
+	spin_unlock(&sony_nc_cache_lock);
+
+	ret = sony_call_snc_handle(handle, argument, result);
+	if (ret)
+		return ret;
+
+	spin_lock(&sony_nc_cache_lock);
+	/* a write completed meanwhile, the result may predate it */
+	if (gen != sony_nc_cache_gen[offset]) {
+		spin_unlock(&sony_nc_cache_lock);
+		return 0;
+	}
+	/* refresh the slot already holding the argument or take the next */
+	for (i = 0; i < SNC_CACHE_SLOTS; i++) {
+		if (sony_nc_cache[offset][i].argument == argument)
+			break;
+	}
+	if (i == SNC_CACHE_SLOTS) {
+		i = sony_nc_cache_next[offset];
+		sony_nc_cache_next[offset] = (i + 1) % SNC_CACHE_SLOTS;
+	}
+	entry = &sony_nc_cache[offset][i];
+	entry->argument = argument;
+	entry->result = *result;
+	entry->expires = jiffies + msecs_to_jiffies(ttl);
+	entry->valid = true;
+	spin_unlock(&sony_nc_cache_lock);
+
+	return 0;
+}
+
+/*
+ * Shadow copy of the writable settings: the last value successfully
+ * written is kept here and on resume it is written back only when the
+ * value read from the firmware differs.
+ */
+enum sony_nc_shadow_id {
+	SNC_SHADOW_THERMAL,
+	SNC_SHADOW_BATTCARE,
+	SNC_SHADOW_FAN,
+	N_SNC_SHADOWS,
+};
+
+struct sony_nc_shadow {
+	const char *name;
+	int (*get)(unsigned int *value);
+	int (*set)(unsigned long value);
+	unsigned int value;
+	bool valid;
+};
+
+static struct sony_nc_shadow sony_nc_shadows[N_SNC_SHADOWS] = {
+	[SNC_SHADOW_THERMAL] = { .name = "thermal_control" },
+	[SNC_SHADOW_BATTCARE] = { .name = "battery_care_limiter" },
+	[SNC_SHADOW_FAN] = { .name = "fan_control" },
+};
+
+static void sony_nc_shadow_register(enum sony_nc_shadow_id id,
+		int (*get)(unsigned int *), int (*set)(unsigned long))
+{
+	sony_nc_shadows[id].get = get;
+	sony_nc_shadows[id].set = set;
+	sony_nc_shadows[id].valid = false;
+}
+
+static void sony_nc_shadow_unregister(enum sony_nc_shadow_id id)
+{
+	sony_nc_shadows[id].get = NULL;
+	sony_nc_shadows[id].set = NULL;
+	sony_nc_shadows[id].valid = false;
+}
+
+static void sony_nc_shadow_store(enum sony_nc_shadow_id id,
+		unsigned int value)
 {
-	int ret = 0;
-	int offset = sony_find_snc_handle(handle);
+	sony_nc_shadows[id].value = value;
+	sony_nc_shadows[id].valid = true;
+}
 
-	if (offset < 0)
-		return -1;
+/* a single read back pass, write only what the firmware lost */
+static void sony_nc_shadow_restore(void)
+{
+	unsigned int i, value;
 
-	/* max 32 bit wide argument, for wider input use SN06 */
-	ret = acpi_callsetfunc(sony_nc_acpi_handle, "SN07", offset | argument,
-			result);
-	dprintk("called SN07 with 0x%.4x (result: 0x%.4x)\n", offset | argument,
-			*result);
-	return ret;
+	for (i = 0; i < ARRAY_SIZE(sony_nc_shadows); i++) {
+		struct sony_nc_shadow *sh = &sony_nc_shadows[i];
+
+		if (!sh->valid || !sh->get || !sh->set)
+			continue;
+
+		if (!sh->get(&value) && value == sh->value)
+			continue;
+
+		dprintk("restoring %s: %u\n", sh->name, sh->value);
+		if (sh->set(sh->value))
+			pr_warn("unable to restore %s\n", sh->name);
+	}
 }
 
 /* call command method SN06, accepts a wide input buffer, returns a buffer */
@@ -1114,14 +3059,24 @@ static int sony_call_snc_handle_buffer(unsigned int handle, u64 argument,
 {
 	int ret = 0;
 	int offset = sony_find_snc_handle(handle);
+	ktime_t start;
 
 	if (offset < 0)
 		return -1;
 
+	sony_nc_handle_lock(handle);
+	trace_sony_snc_call_entry("SN06", handle, argument);
+	start = ktime_get();
 	ret = acpi_callsetfunc_buffer(sony_nc_acpi_handle,
 			offset | argument, result, size);
-	dprintk("called SN06 with 0x%.4llx (%u bytes read)\n",
-			offset | argument, ret);
+	sony_acpi_stats_account("SN06", handle, argument & 0xffff, start,
+			ret < 0);
+	/* the result is the number of bytes read */
+	if (trace_sony_snc_call_exit_enabled())
+		trace_sony_snc_call_exit("SN06", handle, argument, ret,
+				ret < 0 ? -1 : 0,
+				ktime_to_ns(ktime_sub(ktime_get(), start)));
+	sony_nc_handle_unlock(handle);
 
 	return ret;
 }
@@ -1172,10 +3127,10 @@ static ssize_t sony_nc_sysfs_show(struct device *dev,
 	struct sony_nc_value *item =
 	    container_of(attr, struct sony_nc_value, devattr);
 
-	if (!*item->acpiget)
+	if (!item->getter)
 		return -EIO;
 
-	if (acpi_callgetfunc(sony_nc_acpi_handle, *item->acpiget, &value) < 0)
+	if (sony_nc_value_get(item, &value) < 0)
 		return -EIO;
 
 	if (item->validate)
@@ -1192,7 +3147,7 @@ static ssize_t sony_nc_sysfs_store(struct device *dev,
 	struct sony_nc_value *item =
 	    container_of(attr, struct sony_nc_value, devattr);
 
-	if (!item->acpiset)
+	if (!item->setter)
 		return -EIO;
 
 	if (count > 31)
@@ -1201,14 +3156,16 @@ static ssize_t sony_nc_sysfs_store(struct device *dev,
 	if (strict_strtoul(buffer, 10, &value))
 		return -EINVAL;
 
-	if (item->validate)
-		value = item->validate(SNC_VALIDATE_IN, value);
+	/* value is unsigned, the validation error has to be checked first */
+	if (item->validate) {
+		int ret = item->validate(SNC_VALIDATE_IN, value);
 
-	if (value < 0)
-		return value;
+		if (ret < 0)
+			return ret;
+		value = ret;
+	}
 
-	if (acpi_callsetfunc(sony_nc_acpi_handle,
-				*item->acpiset, value, NULL) < 0)
+	if (sony_nc_value_set(item, value) < 0)
 		return -EIO;
 	item->value = value;
 	item->valid = 1;
@@ -1288,7 +3245,13 @@ static struct sony_nc_event sony_127_events[] = {
 /*
  * ACPI device
  */
-static int sony_nc_function_setup(unsigned int handle)
+#define EV_HOTKEYS	1
+#define EV_RFKILL	2
+#define EV_ALS		3
+#define EV_GSENSOR	4
+#define	EV_HGFX		5
+
+static void sony_nc_function_resume(unsigned int handle)
 {
 	unsigned int result;
 
@@ -1296,45 +3259,176 @@ static int sony_nc_function_setup(unsigned int handle)
 		sony_call_snc_handle(0x0102, 0x100, &result);
 	else
 		sony_call_snc_handle(handle, 0, &result);
+}
+
+static int sony_nc_function_setup(struct platform_device *pd,
+					unsigned int handle)
+{
+	sony_nc_function_resume(handle);
 
 	return 0;
 }
 
+/*
+ * direct lookup tables of the hotkey codes, built from the tables above
+ * when the handle is set up and extendable through hotkeys_map
+ */
+struct sony_nc_hotkeys_map {
+	unsigned int handle;
+	const struct sony_nc_event *events;
+	u8 map[0x100];	/* hotkey code -> sonypi event, 0 if unknown */
+};
+
+static struct sony_nc_hotkeys_map sony_nc_hotkeys_maps[] = {
+	{ 0x0100, sony_100_events },
+	{ 0x0127, sony_127_events },
+};
+
+static atomic_t sony_nc_hotkeys_users = ATOMIC_INIT(0);
+
+static struct sony_nc_hotkeys_map *sony_nc_hotkeys_map_find(
+							unsigned int handle)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(sony_nc_hotkeys_maps); i++) {
+		if (sony_nc_hotkeys_maps[i].handle == handle)
+			return &sony_nc_hotkeys_maps[i];
+	}
+
+	return NULL;
+}
+
+static void sony_nc_hotkeys_map_build(struct sony_nc_hotkeys_map *m)
+{
+	const struct sony_nc_event *key_event;
+
+	memset(m->map, 0, sizeof(m->map));
+	for (key_event = m->events; key_event->data; key_event++)
+		m->map[key_event->data] = key_event->event;
+}
+
 static int sony_nc_hotkeys_decode(unsigned int handle)
 {
 	int ret = -EINVAL;
 	unsigned int result = 0;
-	struct sony_nc_event *key_event;
+	struct sony_nc_hotkeys_map *m = sony_nc_hotkeys_map_find(handle);
 
-	if (sony_call_snc_handle(handle, 0x200, &result)) {
+	if (!m || sony_call_snc_handle(handle, 0x200, &result)) {
 		dprintk("sony_nc_hotkeys_decode,"
 				" unable to retrieve the hotkey\n");
 	} else {
 		result &= 0xff;
 
-		if (handle == 0x100)
-			key_event = sony_100_events;
-		else
-			key_event = sony_127_events;
-
-		for (; key_event->data; key_event++) {
-			if (key_event->data == result) {
-				ret = key_event->event;
-				break;
-			}
-		}
-
-		if (!key_event->data)
+		if (!m->map[result]) {
 			pr_info("Unknown hotkey 0x%.2x (handle 0x%.2x)\n",
 							result, handle);
-		else
+		} else {
+			ret = m->map[result];
 			dprintk("sony_nc_hotkeys_decode, hotkey 0x%.2x decoded "
 					"to event 0x%.2x\n", result, ret);
+		}
 	}
 
 	return ret;
 }
 
+/* "<handle> <code> <event>" lines, event 0 drops the code */
+static ssize_t sony_nc_hotkeys_map_show(struct device *dev,
+		struct device_attribute *attr, char *buffer)
+{
+	ssize_t count = 0;
+	unsigned int i, code;
+
+	for (i = 0; i < ARRAY_SIZE(sony_nc_hotkeys_maps); i++) {
+		struct sony_nc_hotkeys_map *m = &sony_nc_hotkeys_maps[i];
+
+		if (sony_find_snc_handle(m->handle) < 0)
+			continue;
+
+		for (code = 0; code < ARRAY_SIZE(m->map); code++) {
+			if (!m->map[code])
+				continue;
+
+			/* room for a whole line */
+			if (count > PAGE_SIZE - 20)
+				return count;
+
+			count += snprintf(buffer + count, PAGE_SIZE - count,
+					"0x%.4x 0x%.2x %u\n", m->handle, code,
+					m->map[code]);
+		}
+	}
+
+	return count;
+}
+
+static ssize_t sony_nc_hotkeys_map_store(struct device *dev,
+		struct device_attribute *attr,
+		const char *buffer, size_t count)
+{
+	unsigned int handle, code, event;
+	struct sony_nc_hotkeys_map *m;
+
+	if (count > 31)
+		return -EINVAL;
+
+	if (sscanf(buffer, "%x %x %u", &handle, &code, &event) != 3 ||
+			code > 0xff || event > 0xff)
+		return -EINVAL;
+
+	m = sony_nc_hotkeys_map_find(handle);
+	if (!m || sony_find_snc_handle(handle) < 0)
+		return -ENODEV;
+
+	m->map[code] = event;
+
+	return count;
+}
+
+static struct device_attribute sony_nc_hotkeys_map_attr =
+	__ATTR(hotkeys_map, S_IRUGO | S_IWUSR, sony_nc_hotkeys_map_show,
+			sony_nc_hotkeys_map_store);
+
+static int sony_nc_hotkeys_setup(struct platform_device *pd,
+					unsigned int handle)
+{
+	struct sony_nc_hotkeys_map *m = sony_nc_hotkeys_map_find(handle);
+
+	if (m)
+		sony_nc_hotkeys_map_build(m);
+
+	/* a single file for both the hotkey handles */
+	if (atomic_inc_return(&sony_nc_hotkeys_users) == 1 &&
+			device_create_file(&pd->dev, &sony_nc_hotkeys_map_attr))
+		pr_warn("unable to create the hotkeys_map attribute\n");
+
+	return sony_nc_function_setup(pd, handle);
+}
+
+static int sony_nc_hotkeys_cleanup(struct platform_device *pd)
+{
+	if (atomic_dec_and_test(&sony_nc_hotkeys_users))
+		device_remove_file(&pd->dev, &sony_nc_hotkeys_map_attr);
+
+	return 0;
+}
+
+/* value is preloaded with the original event by sony_nc_notify */
+static int sony_nc_hotkeys_notify(struct acpi_device *device,
+					unsigned int handle, int *value)
+{
+	/* hotkey event, a key has been pressed, retrieve it */
+	int key = sony_nc_hotkeys_decode(handle);
+
+	if (key > 0) { /* known event */
+		sony_laptop_report_input_event(key);
+		*value = key;
+	}
+
+	return EV_HOTKEYS;
+}
+
 enum sony_nc_rfkill {
 	SONY_WIFI,
 	SONY_BLUETOOTH,
@@ -1397,7 +3491,7 @@ static int sony_nc_get_rfkill_hwblock(void)
 	return result & 0x1;
 }
 
-static void sony_nc_rfkill_cleanup(void)
+static int sony_nc_rfkill_cleanup(struct platform_device *pd)
 {
 	int i;
 
@@ -1407,14 +3501,21 @@ static void sony_nc_rfkill_cleanup(void)
 			rfkill_destroy(sony_rfkill.devices[i]);
 		}
 	}
+
+	return 0;
 }
 
 static int sony_nc_rfkill_set(void *data, bool blocked)
 {
 	unsigned int result, argument = sony_rfkill.address[(long) data];
+	int ret = 0;
+
+	/* the state check and the switch are one transaction */
+	if (sony_nc_handle_lock(sony_rfkill.handle))
+		return -1;
 
 	/* wwan state change not allowed when the battery is not present */
-	sony_call_snc_handle(sony_rfkill.handle, 0x0200, &result);
+	__sony_call_snc_handle(sony_rfkill.handle, 0x0200, &result);
 	if (((long) data == SONY_WWAN) && !(result & 0x2)) {
 		if (!blocked) {
 			/* notify user space: the battery must be present */
@@ -1426,19 +3527,24 @@ static int sony_nc_rfkill_set(void *data, bool blocked)
 					2, 2);
 		}
 
-		return -1;
+		ret = -1;
+		goto out;
 	}
 
 	/* do not force an already set state */
-	sony_call_snc_handle(sony_rfkill.handle, argument, &result);
+	__sony_call_snc_handle(sony_rfkill.handle, argument, &result);
 	if ((result & 0x1) == !blocked)
-		return 0;
+		goto out;
 
 	argument += 0x100;
 	if (!blocked)
 		argument |= 0xff0000;
 
-	return sony_call_snc_handle(sony_rfkill.handle, argument, &result);
+	ret = __sony_call_snc_handle(sony_rfkill.handle, argument, &result);
+
+out:
+	sony_nc_handle_unlock(sony_rfkill.handle);
+	return ret;
 }
 
 static const struct rfkill_ops sony_rfkill_ops = {
@@ -1452,8 +3558,11 @@ static int sony_nc_setup_rfkill(struct acpi_device *device,
 	struct rfkill *rfk;
 	enum rfkill_type type;
 	const char *name;
-	unsigned int result;
 	bool hwblock, swblock, wwblock;
+	struct sony_nc_command cmds[] = {
+		{ sony_rfkill.handle, 0x0200 },
+		{ sony_rfkill.handle, sony_rfkill.address[nc_type] },
+	};
 
 	switch (nc_type) {
 	case SONY_WIFI:
@@ -1481,14 +3590,10 @@ static int sony_nc_setup_rfkill(struct acpi_device *device,
 	if (!rfk)
 		return -ENOMEM;
 
-	sony_call_snc_handle(sony_rfkill.handle, 0x200, &result);
-	hwblock = !(result & 0x1);
-	wwblock = !(result & 0x2);
-
-	result = 0;
-	sony_call_snc_handle(sony_rfkill.handle, sony_rfkill.address[nc_type],
-				&result);
-	swblock = !(result & 0x2);
+	sony_call_snc_handle_batch(cmds, ARRAY_SIZE(cmds));
+	hwblock = !(cmds[0].result & 0x1);
+	wwblock = !(cmds[0].result & 0x2);
+	swblock = !(cmds[1].result & 0x2);
 
 	/* hard block the WWAN module if no battery is present */
 	if ((nc_type == SONY_WWAN) && wwblock)
@@ -1509,20 +3614,32 @@ static int sony_nc_setup_rfkill(struct acpi_device *device,
 static void sony_nc_rfkill_update(void)
 {
 	enum sony_nc_rfkill i;
-	unsigned int result;
+	unsigned int num = 1;
 	bool hwblock, swblock, wwblock;
+	struct sony_nc_command cmds[N_SONY_RFKILL + 1] = {
+		{ sony_rfkill.handle, 0x0200 },
+	};
 
-	sony_call_snc_handle(sony_rfkill.handle, 0x200, &result);
-	hwblock = !(result & 0x1);
-	wwblock = !(result & 0x2);
-
+	/* query the global state and all the registered devices at once */
 	for (i = 0; i < N_SONY_RFKILL; i++) {
-		unsigned int argument = sony_rfkill.address[i];
+		if (!sony_rfkill.devices[i])
+			continue;
+
+		cmds[num].handle = sony_rfkill.handle;
+		cmds[num++].argument = sony_rfkill.address[i];
+	}
+
+	sony_call_snc_handle_batch(cmds, num);
+	hwblock = !(cmds[0].result & 0x1);
+	wwblock = !(cmds[0].result & 0x2);
+
+	for (i = 0, num = 1; i < N_SONY_RFKILL; i++) {
+		unsigned int result;
 
 		if (!sony_rfkill.devices[i])
 			continue;
 
-		sony_call_snc_handle(sony_rfkill.handle, argument, &result);
+		result = cmds[num++].result;
 		/* block wwan when no battery is present */
 		if ((i == SONY_WWAN) && wwblock)
 			swblock = true;
@@ -1534,10 +3651,12 @@ static void sony_nc_rfkill_update(void)
 	}
 }
 
-static int sony_nc_rfkill_setup(struct acpi_device *device, unsigned int handle)
+static int sony_nc_rfkill_setup(struct platform_device *pd,
+					unsigned int handle)
 {
 #define	RFKILL_BUFF_SIZE 8
 	u8 dev_code, i, buff[RFKILL_BUFF_SIZE] = { 0 };
+	struct acpi_device *device = sony_nc_acpi_device;
 
 	sony_rfkill.handle = handle;
 
@@ -1595,6 +3714,38 @@ static int sony_nc_rfkill_setup(struct acpi_device *device, unsigned int handle)
 	return 0;
 }
 
+static void sony_nc_rfkill_resume(unsigned int handle)
+{
+	/* re-read rfkill state */
+	sony_nc_rfkill_update();
+}
+
+static int sony_nc_rfkill_notify(struct acpi_device *device,
+					unsigned int handle, int *value)
+{
+	unsigned int result = 0;
+
+	*value = 0;
+	sony_call_snc_handle(handle, 0x0100, &result);
+	result &= 0x03;
+	dprintk("sony_nc_notify, RFKILL event received "
+			"(reason: %s)\n", result == 1 ?
+			"switch state changed" : "battery");
+
+	if (result == 1) { /* hw swtich event */
+		sony_nc_rfkill_update();
+		*value = sony_nc_get_rfkill_hwblock();
+	} else if (result == 2) { /* battery event */
+		/*  we might need to change the WWAN rfkill
+		    state when the battery state changes
+		 */
+		sony_nc_rfkill_update_wwan();
+		return -1;
+	}
+
+	return EV_RFKILL;
+}
+
 /*	ALS controlled backlight feature	*/
 /* generic ALS data and interface */
 #define ALS_TABLE_SIZE	25
@@ -1773,14 +3924,33 @@ static const struct tsl256x_coeff tsl256x_coeff_cs[] = {
 };
 
 /*	TAOS helper & control functions		*/
+
+/* SN07 argument writing value to the register reg */
+static inline unsigned int tsl256x_writebyte_arg(unsigned int reg,
+						unsigned int value)
+{
+	return (value << 0x18) | (reg << 0x10) | 0x800500;
+}
+
+/* the ALS handle lock must be held */
+static inline int __tsl256x_exec_writebyte(unsigned int reg,
+						unsigned int const *value)
+{
+	unsigned int result;
+
+	return (__sony_call_snc_handle(sony_als->handle,
+		tsl256x_writebyte_arg(reg, *value), &result) ||
+		!(result & 0x01)) ? -EIO : 0;
+}
+
 static inline int tsl256x_exec_writebyte(unsigned int reg,
 						unsigned int const *value)
 {
 	unsigned int result;
 
-	return (sony_call_snc_handle(sony_als->handle, (*value << 0x18) |
-		(reg << 0x10) | 0x800500, &result) || !(result & 0x01))
-		? -EIO : 0;
+	return (sony_call_snc_handle(sony_als->handle,
+		tsl256x_writebyte_arg(reg, *value), &result) ||
+		!(result & 0x01)) ? -EIO : 0;
 }
 
 static inline int tsl256x_exec_writeword(unsigned int reg,
@@ -1844,7 +4014,9 @@ static int tsl256x_interrupt_ctrls(unsigned int *interrupt,
 
 static int tsl256x_setup(void)
 {
-	unsigned int interr = 1, zero = 0;
+	unsigned int zero = 0;
+	unsigned int interr = TSL256X_INT_MASK | tsl256x_handle->periods;
+	int ret;
 
 	/*
 	 *   reset the threshold settings to trigger an event as soon
@@ -1854,16 +4026,21 @@ static int tsl256x_setup(void)
 	tsl256x_exec_writeword(TSL256X_REG_TLOW, &zero);
 	tsl256x_exec_writeword(TSL256X_REG_THIGH, &zero);
 
-	/* set gain and time */
-	if (tsl256x_exec_writebyte(TSL256X_REG_TIMING,
-				&tsl256x_handle->gaintime))
+	/* both writes under a single lock hold */
+	if (sony_nc_handle_lock(sony_als->handle))
 		return -EIO;
 
+	/* set gain and time */
+	ret = __tsl256x_exec_writebyte(TSL256X_REG_TIMING,
+			&tsl256x_handle->gaintime);
+
 	/* restore persistence value and enable the interrupt generation */
-	if (tsl256x_interrupt_ctrls(&interr, &tsl256x_handle->periods))
-		return -EIO;
+	if (!ret)
+		ret = __tsl256x_exec_writebyte(TSL256X_REG_INT, &interr);
 
-	return 0;
+	sony_nc_handle_unlock(sony_als->handle);
+
+	return ret;
 }
 
 static int tsl256x_set_power(unsigned int status)
@@ -2239,7 +4416,7 @@ static int sony_nc_als_managed_set(unsigned int status)
 	 *  (and enable als_backlight writes)
 	 */
 	cmd = sony_als->handle == 0x0143 ? 0x2200 : 0x0900;
-	if (sony_call_snc_handle(sony_als->handle,
+	if (sony_call_snc_handle_write(sony_als->handle,
 		(status << 0x10) | cmd, &result))
 		return -EIO;
 
@@ -2290,7 +4467,7 @@ static int sony_nc_als_update_status(struct backlight_device *bd)
 
 		value = sony_als->levels[bd->props.brightness];
 		cmd = sony_als->handle == 0x0143 ? 0x3000 : 0x0100;
-		if (sony_call_snc_handle(sony_als->handle,
+		if (sony_call_snc_handle_write(sony_als->handle,
 					(value << 0x10) | cmd, &result))
 			return -EIO;
 	}
@@ -2331,6 +4508,10 @@ static ssize_t sony_nc_als_power_store(struct device *dev,
 	if (strict_strtoul(buffer, 10, &value) || value > 1)
 		return -EINVAL;
 
+	ret = sony_nc_resume_wait();
+	if (ret)
+		return ret;
+
 	/* no action if already set */
 	if (value == sony_als->power)
 		return count;
@@ -2349,7 +4530,7 @@ static ssize_t sony_nc_als_managed_show(struct device *dev,
 	unsigned int status, cmd;
 
 	cmd = sony_als->handle == 0x0143 ? 0x2100 : 0x0A00;
-	if (sony_call_snc_handle(sony_als->handle, cmd, &status))
+	if (sony_call_snc_handle_cached(sony_als->handle, cmd, &status))
 		return -EIO;
 
 	count = snprintf(buffer, PAGE_SIZE, "%d\n", status & 0x01);
@@ -2362,6 +4543,7 @@ static ssize_t sony_nc_als_managed_store(struct device *dev,
 		const char *buffer, size_t count)
 {
 	unsigned long value;
+	int ret;
 
 	if (count > 31)
 		return -EINVAL;
@@ -2369,8 +4551,12 @@ static ssize_t sony_nc_als_managed_store(struct device *dev,
 	if (strict_strtoul(buffer, 10, &value) || value > 1)
 		return -EINVAL;
 
+	ret = sony_nc_resume_wait();
+	if (ret)
+		return ret;
+
 	if (sony_als->managed != value) {
-		int ret = sony_nc_als_managed_set(value);
+		ret = sony_nc_als_managed_set(value);
 		if (ret)
 			return ret;
 	}
@@ -2424,7 +4610,7 @@ static ssize_t sony_nc_als_backlight_show(struct device *dev,
 	unsigned int result, cmd;
 
 	cmd = sony_als->handle == 0x0143 ? 0x3100 : 0x0200;
-	if (sony_call_snc_handle(sony_als->handle, cmd, &result))
+	if (sony_call_snc_handle_cached(sony_als->handle, cmd, &result))
 		return -EIO;
 
 	count = snprintf(buffer, PAGE_SIZE, "%d\n", result & 0xff);
@@ -2455,7 +4641,7 @@ static ssize_t sony_nc_als_backlight_store(struct device *dev,
 		return -EINVAL;
 
 	cmd = sony_als->handle == 0x0143 ? 0x3000 : 0x0100;
-	if (sony_call_snc_handle(sony_als->handle, (value << 0x10) | cmd,
+	if (sony_call_snc_handle_write(sony_als->handle, (value << 0x10) | cmd,
 				&result))
 		return -EIO;
 
@@ -2610,12 +4796,23 @@ nosensor:
 	return -1;
 }
 
-static void sony_nc_als_resume(void)
+static void sony_nc_als_resume(unsigned int handle)
 {
-	if (sony_als->managed) /* it restores the power state too */
+	unsigned int status;
+
+	if (!sony_als)
+		return;
+
+	/* the notification state cannot be read back, always restored */
+	if (sony_als->managed) { /* it restores the power state too */
 		sony_nc_als_managed_set(1);
-	else if (sony_als->power)
+	} else if (sony_als->power) {
+		if (sony_als->ops->get_power &&
+				!sony_als->ops->get_power(&status) && status)
+			return;
+
 		sony_nc_als_power_set(1);
+	}
 }
 
 static int sony_nc_als_cleanup(struct platform_device *pd)
@@ -2645,6 +4842,34 @@ static int sony_nc_als_cleanup(struct platform_device *pd)
 
 	return 0;
 }
+
+static int sony_nc_als_notify(struct acpi_device *device,
+					unsigned int handle, int *value)
+{
+	unsigned int result = 0;
+	char *env[2] = { NULL };
+
+	if (handle == 0x0143) {
+		sony_call_snc_handle(handle, 0x2000, &result);
+		/* event reasons are reverted */
+		*value = (result & 0x03) == 1 ? 2 : 1;
+	} else {
+		sony_call_snc_handle(handle, 0x0800, &result);
+		*value = result & 0x03;
+	}
+	dprintk("sony_nc_notify, ALS event received (reason:"
+			" %s change)\n", *value == 1 ? "light" :
+			"backlight");
+
+	/* lighting change reason, only the TAOS sensors need care */
+	if (handle != 0x0143 && *value == 1 && sony_als)
+		sony_nc_als_event_handler();
+
+	env[0] = (*value == 1) ? "ALS=1" : "ALS=2";
+	kobject_uevent_env(&device->dev.kobj, KOBJ_CHANGE, env);
+
+	return EV_ALS;
+}
 /*	end ALS code	*/
 
 /* Keyboard backlight feature */
@@ -2657,22 +4882,28 @@ static struct sony_kbdbl_data {
 	struct device_attribute timeout_attr;
 } *sony_kbdbl;
 
-static int __sony_nc_kbd_backlight_mode_set(u8 value)
+static int __sony_nc_kbd_backlight_mode_set(unsigned long value)
 {
 	unsigned int result;
 
 	if (value > 1)
 		return -EINVAL;
 
-	if (sony_call_snc_handle(sony_kbdbl->handle, (value << 0x10) |
-				(sony_kbdbl->base), &result))
+	if (sony_nc_handle_lock(sony_kbdbl->handle))
 		return -EIO;
 
+	if (__sony_call_snc_handle(sony_kbdbl->handle, (value << 0x10) |
+				(sony_kbdbl->base), &result)) {
+		sony_nc_handle_unlock(sony_kbdbl->handle);
+		return -EIO;
+	}
+
 	sony_kbdbl->mode = value;
 
 	/* Try to turn the light on/off immediately */
-	sony_call_snc_handle(sony_kbdbl->handle, (value << 0x10) |
+	__sony_call_snc_handle(sony_kbdbl->handle, (value << 0x10) |
 				(sony_kbdbl->base + 0x100), &result);
+	sony_nc_handle_unlock(sony_kbdbl->handle);
 
 	return 0;
 }
@@ -2681,20 +4912,16 @@ static ssize_t sony_nc_kbd_backlight_mode_store(struct device *dev,
 		struct device_attribute *attr,
 		const char *buffer, size_t count)
 {
-	int ret = 0;
 	unsigned long value;
 
 	if (count > 31)
 		return -EINVAL;
 
-	if (strict_strtoul(buffer, 10, &value))
+	if (strict_strtoul(buffer, 10, &value) || value > 1)
 		return -EINVAL;
 
-	ret = __sony_nc_kbd_backlight_mode_set(value);
-	if (ret < 0)
-		return ret;
-
-	return count;
+	return sony_pf_cmd_submit(__sony_nc_kbd_backlight_mode_set, value,
+			count);
 }
 
 static ssize_t sony_nc_kbd_backlight_mode_show(struct device *dev,
@@ -2707,7 +4934,7 @@ static ssize_t sony_nc_kbd_backlight_mode_show(struct device *dev,
 	return count;
 }
 
-static int __sony_nc_kbd_backlight_timeout_set(u8 value)
+static int __sony_nc_kbd_backlight_timeout_set(unsigned long value)
 {
 	unsigned int result;
 
@@ -2727,20 +4954,16 @@ static ssize_t sony_nc_kbd_backlight_timeout_store(struct device *dev,
 		struct device_attribute *attr,
 		const char *buffer, size_t count)
 {
-	int ret = 0;
 	unsigned long value;
 
 	if (count > 31)
 		return -EINVAL;
 
-	if (strict_strtoul(buffer, 10, &value))
+	if (strict_strtoul(buffer, 10, &value) || value > 3)
 		return -EINVAL;
 
-	ret = __sony_nc_kbd_backlight_timeout_set(value);
-	if (ret < 0)
-		return ret;
-
-	return count;
+	return sony_pf_cmd_submit(__sony_nc_kbd_backlight_timeout_set, value,
+			count);
 }
 
 static ssize_t sony_nc_kbd_backlight_timeout_show(struct device *dev,
@@ -2837,7 +5060,7 @@ static int sony_nc_kbd_backlight_cleanup(struct platform_device *pd)
 	return 0;
 }
 
-static void sony_nc_kbd_backlight_resume(void)
+static void sony_nc_kbd_backlight_resume(unsigned int handle)
 {
 	unsigned int result;
 
@@ -2888,8 +5111,10 @@ static int sony_nc_gsensor_support_get(unsigned int *support)
 
 static int sony_nc_gsensor_status_set(int value)
 {
-	unsigned int result, capable, reg, arg;
+	unsigned int result, capable, arg;
 	bool update = false;
+	struct sony_nc_command cmds[2];
+	int ret = -EIO;
 
 	if (sony_nc_gsensor_support_get(&capable))
 		return -EIO;
@@ -2903,21 +5128,29 @@ static int sony_nc_gsensor_status_set(int value)
 	 * notifications and call the ATA7 immediate idle command to
 	 * unload the heads. Just return after enabling notifications
 	*/
-	reg = sony_gsensor->handle == 0x0134 ?
+	cmds[0].handle = sony_gsensor->handle;
+	cmds[0].argument = sony_gsensor->handle == 0x0134 ?
 		(!value << 0x08) : (value << 0x10);
 
-	if (sony_call_snc_handle(sony_gsensor->handle, reg, &result))
+	/* along with the current protection setting when it can be changed */
+	cmds[1].handle = sony_gsensor->handle;
+	cmds[1].argument = sony_gsensor->handle == 0x0134 ? 0x0200 : 0x0400;
+
+	/* the read back and the update below are one transaction */
+	if (sony_nc_handle_lock(sony_gsensor->handle))
 		return -EIO;
 
+	if (__sony_call_snc_handle_batch(cmds, capable ? 2 : 1))
+		goto out;
+
+	ret = 0;
 	if (!capable)
-		return 0;
+		goto out;
 
 	/* if the requested protection setting is different
 	   from the current one
 	*/
-	reg = sony_gsensor->handle == 0x0134 ? 0x0200 : 0x0400;
-	if (sony_call_snc_handle(sony_gsensor->handle, reg, &result))
-		return -EIO;
+	result = cmds[1].result;
 
 	if (sony_gsensor->handle == 0x0134) {
 		if (!!(result & 0x04) != value) {
@@ -2931,11 +5164,15 @@ static int sony_nc_gsensor_status_set(int value)
 		}
 	}
 
-	if (update && sony_call_snc_handle(sony_gsensor->handle,
+	if (update && __sony_call_snc_handle(sony_gsensor->handle,
 			(arg << 0x10) | 0x0300, &result))
-		return -EIO;
+		ret = -EIO;
 
-	return 0;
+out:
+	/* after the writes, see sony_call_snc_handle_cached */
+	sony_nc_cache_invalidate(sony_gsensor->handle);
+	sony_nc_handle_unlock(sony_gsensor->handle);
+	return ret;
 }
 
 static int sony_nc_gsensor_axis_get(enum axis name)
@@ -2955,7 +5192,7 @@ static ssize_t sony_nc_gsensor_type_show(struct device *dev,
 	ssize_t count = 0;
 	unsigned int result;
 
-	if (sony_call_snc_handle(sony_gsensor->handle, 0x0200, &result))
+	if (sony_call_snc_handle_cached(sony_gsensor->handle, 0x0200, &result))
 		return -EIO;
 
 	count = snprintf(buffer, PAGE_SIZE, "%d\n", (result >> 0x03) & 0x03);
@@ -2973,6 +5210,7 @@ static ssize_t sony_nc_gsensor_type_store(struct device *dev,
 	 */
 	unsigned int result;
 	unsigned long value;
+	ssize_t ret = count;
 
 	/* sanity checks and conversion */
 	if (count > 31 || strict_strtoul(buffer, 10, &value) || value > 2)
@@ -2980,20 +5218,27 @@ static ssize_t sony_nc_gsensor_type_store(struct device *dev,
 
 	value <<= 0x03;
 
-	/* retrieve the current state / settings */
-	if (sony_call_snc_handle(sony_gsensor->handle, 0x0200, &result))
+	if (sony_nc_handle_lock(sony_gsensor->handle))
 		return -EIO;
 
+	/* retrieve the current state / settings */
+	if (__sony_call_snc_handle(sony_gsensor->handle, 0x0200, &result)) {
+		ret = -EIO;
+		goto out;
+	}
+
 	if ((result & 0x18) != value) {
 		/* the last 3 bits need to be preserved */
 		value |= (result & 0x07);
 
-		if (sony_call_snc_handle(sony_gsensor->handle,
+		if (__sony_call_snc_handle_write(sony_gsensor->handle,
 				(value << 0x10) | 0x0300, &result))
-				return -EIO;
+			ret = -EIO;
 	}
 
-	return count;
+out:
+	sony_nc_handle_unlock(sony_gsensor->handle);
+	return ret;
 }
 
 static ssize_t sony_nc_gsensor_axis_show(struct device *dev,
@@ -3029,13 +5274,13 @@ static ssize_t sony_nc_gsensor_status_show(struct device *dev,
 	unsigned int result;
 
 	if (sony_gsensor->handle == 0x0134) {
-		if (sony_call_snc_handle(sony_gsensor->handle, 0x0200,
+		if (sony_call_snc_handle_cached(sony_gsensor->handle, 0x0200,
 					&result))
 			return -EIO;
 
 		result = !!(result & 0x04);
 	} else {
-		if (sony_call_snc_handle(sony_gsensor->handle, 0x0400,
+		if (sony_call_snc_handle_cached(sony_gsensor->handle, 0x0400,
 					&result))
 			return -EIO;
 
@@ -3072,7 +5317,7 @@ static ssize_t sony_nc_gsensor_sensitivity_show(struct device *dev,
 	ssize_t count = 0;
 	unsigned int result;
 
-	if (sony_call_snc_handle(sony_gsensor->handle, 0x0200, &result))
+	if (sony_call_snc_handle_cached(sony_gsensor->handle, 0x0200, &result))
 		return -EINVAL;
 
 	count = snprintf(buffer, PAGE_SIZE, "%d\n", result & 0x03);
@@ -3085,22 +5330,30 @@ static ssize_t sony_nc_gsensor_sensitivity_store(struct device *dev,
 {
 	unsigned int result;
 	unsigned long value;
+	ssize_t ret = count;
 
 	if (count > 31)
 		return -EINVAL;
 	if (strict_strtoul(buffer, 10, &value) || value > 2)
 		return -EINVAL;
 
-	/* retrieve the other parameters to be stored as well */
-	if (sony_call_snc_handle(sony_gsensor->handle, 0x0200, &result))
+	if (sony_nc_handle_lock(sony_gsensor->handle))
 		return -EIO;
+
+	/* retrieve the other parameters to be stored as well */
+	if (__sony_call_snc_handle(sony_gsensor->handle, 0x0200, &result)) {
+		ret = -EIO;
+		goto out;
+	}
 	value |= (result & 0x1C); /* preserve only the needed bits */
 
-	if (sony_call_snc_handle(sony_gsensor->handle, (value << 0x10)
+	if (__sony_call_snc_handle_write(sony_gsensor->handle, (value << 0x10)
 		| 0x0300, &result))
-		return -EIO;
+		ret = -EIO;
 
-	return count;
+out:
+	sony_nc_handle_unlock(sony_gsensor->handle);
+	return ret;
 }
 
 static int sony_nc_gsensor_setup(struct platform_device *pd,
@@ -3210,6 +5463,18 @@ static int sony_nc_gsensor_cleanup(struct platform_device *pd)
 
 	return 0;
 }
+
+static int sony_nc_gsensor_notify(struct acpi_device *device,
+					unsigned int handle, int *value)
+{
+	char *env[2] = { "HDD_SHOCK=1", NULL };
+
+	/* hdd protection event, notify userspace */
+	*value = EV_GSENSOR;
+	kobject_uevent_env(&device->dev.kobj, KOBJ_CHANGE, env);
+
+	return EV_GSENSOR;
+}
 /*			end G sensor code			*/
 
 static struct sony_battcare_data {
@@ -3217,17 +5482,9 @@ static struct sony_battcare_data {
 	struct device_attribute attrs[2];
 } *sony_battcare;
 
-static ssize_t sony_nc_battery_care_limit_store(struct device *dev,
-		struct device_attribute *attr,
-		const char *buffer, size_t count)
+static int sony_nc_battery_care_limit_set(unsigned long value)
 {
 	unsigned int result, cmd;
-	unsigned long value;
-
-	if (count > 31)
-		return -EINVAL;
-	if (strict_strtoul(buffer, 10, &value))
-		return -EINVAL;
 
 	/*  limit values (2 bits):
 	 *  00 - none
@@ -3263,25 +5520,53 @@ static ssize_t sony_nc_battery_care_limit_store(struct device *dev,
 		return -EINVAL;
 	}
 
-	if (sony_call_snc_handle(sony_battcare->handle, (cmd << 0x10) | 0x0100,
+	if (sony_call_snc_handle_write(sony_battcare->handle,
+				(cmd << 0x10) | 0x0100, &result))
+		return -EIO;
+
+	sony_nc_shadow_store(SNC_SHADOW_BATTCARE, value);
+
+	return 0;
+}
+
+static int sony_nc_battery_care_limit_get(unsigned int *status)
+{
+	unsigned int result;
+
+	if (sony_call_snc_handle_cached(sony_battcare->handle, 0x0000,
 				&result))
 		return -EIO;
 
-	return count;
+	/* if disabled 0, else take the limit bits */
+	*status = !(result & 0x01) ? 0 : ((result & 0x30) >> 0x04);
+
+	return 0;
+}
+
+static ssize_t sony_nc_battery_care_limit_store(struct device *dev,
+		struct device_attribute *attr,
+		const char *buffer, size_t count)
+{
+	unsigned long value;
+
+	if (count > 31)
+		return -EINVAL;
+	if (strict_strtoul(buffer, 10, &value) || value > 2)
+		return -EINVAL;
+
+	return sony_pf_cmd_submit(sony_nc_battery_care_limit_set, value,
+			count);
 }
 
 static ssize_t sony_nc_battery_care_limit_show(struct device *dev,
 		struct device_attribute *attr, char *buffer)
 {
 	ssize_t count = 0;
-	unsigned int result, status;
+	unsigned int status;
 
-	if (sony_call_snc_handle(sony_battcare->handle, 0x0000, &result))
+	if (sony_nc_battery_care_limit_get(&status))
 		return -EIO;
 
-	/* if disabled 0, else take the limit bits */
-	status = !(result & 0x01) ? 0 : ((result & 0x30) >> 0x04);
-
 	count = snprintf(buffer, PAGE_SIZE, "%d\n", status);
 	return count;
 }
@@ -3292,7 +5577,8 @@ static ssize_t sony_nc_battery_care_health_show(struct device *dev,
 	ssize_t count = 0;
 	unsigned int health;
 
-	if (sony_call_snc_handle(sony_battcare->handle, 0x0200, &health))
+	if (sony_call_snc_handle_cached(sony_battcare->handle, 0x0200,
+				&health))
 		return -EIO;
 
 	count = snprintf(buffer, PAGE_SIZE, "%d\n", health & 0xff);
@@ -3318,6 +5604,10 @@ static int sony_nc_battery_care_setup(struct platform_device *pd,
 	if (device_create_file(&pd->dev, &sony_battcare->attrs[0]))
 		goto outkzalloc;
 
+	sony_nc_shadow_register(SNC_SHADOW_BATTCARE,
+			sony_nc_battery_care_limit_get,
+			sony_nc_battery_care_limit_set);
+
 	if (handle == 0x0115) /* no health indication */
 		return 0;
 
@@ -3332,6 +5622,7 @@ static int sony_nc_battery_care_setup(struct platform_device *pd,
 	return 0;
 
 outlimiter:
+	sony_nc_shadow_unregister(SNC_SHADOW_BATTCARE);
 	device_remove_file(&pd->dev, &sony_battcare->attrs[0]);
 outkzalloc:
 	kfree(sony_battcare);
@@ -3343,6 +5634,7 @@ outkzalloc:
 static int sony_nc_battery_care_cleanup(struct platform_device *pd)
 {
 	if (sony_battcare) {
+		sony_nc_shadow_unregister(SNC_SHADOW_BATTCARE);
 		device_remove_file(&pd->dev, &sony_battcare->attrs[0]);
 		if (sony_battcare->handle != 0x0115)
 			device_remove_file(&pd->dev, &sony_battcare->attrs[1]);
@@ -3361,7 +5653,7 @@ static struct sony_thermal_data {
 	struct device_attribute profiles_attr;
 } *sony_thermal;
 
-static int sony_nc_thermal_mode_set(unsigned int profile)
+static int sony_nc_thermal_mode_set(unsigned long profile)
 {
 	unsigned int cmd, result;
 
@@ -3378,10 +5670,11 @@ static int sony_nc_thermal_mode_set(unsigned int profile)
 		break;
 	}
 
-	if (sony_call_snc_handle(0x0122, cmd << 0x10 | 0x0200, &result))
+	if (sony_call_snc_handle_write(0x0122, cmd << 0x10 | 0x0200, &result))
 		return -EIO;
 
 	sony_thermal->mode = profile;
+	sony_nc_shadow_store(SNC_SHADOW_THERMAL, profile);
 
 	return 0;
 }
@@ -3390,7 +5683,7 @@ static int sony_nc_thermal_mode_get(unsigned int *profile)
 {
 	unsigned int result;
 
-	if (sony_call_snc_handle(0x0122, 0x0100, &result))
+	if (sony_call_snc_handle_cached(0x0122, 0x0100, &result))
 		return -EIO;
 
 	/* to avoid the 1 value hole when only 2 profiles are available */
@@ -3427,10 +5720,7 @@ static ssize_t sony_nc_thermal_mode_store(struct device *dev,
 		value > (sony_thermal->profiles - 1))
 		return -EINVAL;
 
-	if (sony_nc_thermal_mode_set(value))
-		return -EIO;
-
-	return count;
+	return sony_pf_cmd_submit(sony_nc_thermal_mode_set, value, count);
 }
 
 static ssize_t sony_nc_thermal_mode_show(struct device *dev,
@@ -3447,7 +5737,8 @@ static ssize_t sony_nc_thermal_mode_show(struct device *dev,
 	return count;
 }
 
-static int sony_nc_thermal_setup(struct platform_device *pd)
+static int sony_nc_thermal_setup(struct platform_device *pd,
+					unsigned int handle)
 {
 	sony_thermal = kzalloc(sizeof(struct sony_thermal_data), GFP_KERNEL);
 	if (!sony_thermal)
@@ -3480,6 +5771,11 @@ static int sony_nc_thermal_setup(struct platform_device *pd)
 	if (device_create_file(&pd->dev, &sony_thermal->mode_attr))
 		goto outprofiles;
 
+	/* the profile found at boot is restored too */
+	sony_nc_shadow_register(SNC_SHADOW_THERMAL, sony_nc_thermal_mode_get,
+			sony_nc_thermal_mode_set);
+	sony_nc_shadow_store(SNC_SHADOW_THERMAL, sony_thermal->mode);
+
 	return 0;
 
 outprofiles:
@@ -3493,6 +5789,7 @@ outkzalloc:
 static int sony_nc_thermal_cleanup(struct platform_device *pd)
 {
 	if (sony_thermal) {
+		sony_nc_shadow_unregister(SNC_SHADOW_THERMAL);
 		device_remove_file(&pd->dev, &sony_thermal->profiles_attr);
 		device_remove_file(&pd->dev, &sony_thermal->mode_attr);
 		kfree(sony_thermal);
@@ -3502,16 +5799,6 @@ static int sony_nc_thermal_cleanup(struct platform_device *pd)
 	return 0;
 }
 
-static void sony_nc_thermal_resume(void)
-{
-	unsigned int status;
-
-	sony_nc_thermal_mode_get(&status);
-
-	if (status != sony_thermal->mode)
-		sony_nc_thermal_mode_set(sony_thermal->mode);
-}
-
 static struct device_attribute *sony_lid;
 
 static ssize_t sony_nc_lid_resume_store(struct device *dev,
@@ -3552,7 +5839,8 @@ static ssize_t sony_nc_lid_resume_show(struct device *dev,
 	return count;
 }
 
-static int sony_nc_lid_resume_setup(struct platform_device *pd)
+static int sony_nc_lid_resume_setup(struct platform_device *pd,
+					unsigned int handle)
 {
 	sony_lid = kzalloc(sizeof(struct device_attribute), GFP_KERNEL);
 	if (!sony_lid)
@@ -3618,7 +5906,8 @@ static ssize_t sony_nc_highspeed_charging_show(struct device *dev,
 	return count;
 }
 
-static int sony_nc_highspeed_charging_setup(struct platform_device *pd)
+static int sony_nc_highspeed_charging_setup(struct platform_device *pd,
+					unsigned int handle)
 {
 	unsigned int result;
 
@@ -3740,11 +6029,35 @@ static struct sony_fan_device {
 	struct device_attribute	attrs[3];
 } *sony_fan;
 
+static int sony_nc_fan_control_set(unsigned long value)
+{
+	unsigned int result;
+
+	if (sony_call_snc_handle_write(SONY_FAN_HANDLE,
+				(value << 0x10) | 0x0200, &result))
+		return -EIO;
+
+	sony_nc_shadow_store(SNC_SHADOW_FAN, value);
+
+	return 0;
+}
+
+static int sony_nc_fan_control_get(unsigned int *value)
+{
+	unsigned int result;
+
+	if (sony_call_snc_handle_cached(SONY_FAN_HANDLE, 0x0100, &result))
+		return -EIO;
+
+	*value = result & 0xff;
+
+	return 0;
+}
+
 static ssize_t sony_nc_fan_control_store(struct device *dev,
 		struct device_attribute *attr,
 		const char *buffer, size_t count)
 {
-	unsigned int result;
 	unsigned long value;
 
 	if (count > 31)
@@ -3753,23 +6066,19 @@ static ssize_t sony_nc_fan_control_store(struct device *dev,
 		|| value > sony_fan->speeds_num)
 		return -EINVAL;
 
-	if (sony_call_snc_handle(SONY_FAN_HANDLE,
-				(value << 0x10) | 0x0200, &result))
-		return -EIO;
-
-	return count;
+	return sony_pf_cmd_submit(sony_nc_fan_control_set, value, count);
 }
 
 static ssize_t sony_nc_fan_control_show(struct device *dev,
 		struct device_attribute *attr, char *buffer)
 {
 	ssize_t count = 0;
-	unsigned int result;
+	unsigned int value;
 
-	if (sony_call_snc_handle(SONY_FAN_HANDLE, 0x0100, &result))
+	if (sony_nc_fan_control_get(&value))
 		return -EINVAL;
 
-	count = snprintf(buffer, PAGE_SIZE, "%d\n", result & 0xff);
+	count = snprintf(buffer, PAGE_SIZE, "%d\n", value);
 	return count;
 }
 
@@ -3794,7 +6103,7 @@ static ssize_t sony_nc_fan_speed_show(struct device *dev,
 	ssize_t count = 0;
 	unsigned int result;
 
-	if (sony_call_snc_handle(SONY_FAN_HANDLE, 0x0300, &result))
+	if (sony_call_snc_handle_cached(SONY_FAN_HANDLE, 0x0300, &result))
 		return -EINVAL;
 
 	count = snprintf(buffer, PAGE_SIZE, "%d\n",
@@ -3802,7 +6111,8 @@ static ssize_t sony_nc_fan_speed_show(struct device *dev,
 	return count;
 }
 
-static int sony_nc_fan_setup(struct platform_device *pd)
+static int sony_nc_fan_setup(struct platform_device *pd,
+					unsigned int handle)
 {
 	int ret;
 	unsigned int i, found;
@@ -3845,6 +6155,9 @@ static int sony_nc_fan_setup(struct platform_device *pd)
 			goto attrserror;
 	}
 
+	sony_nc_shadow_register(SNC_SHADOW_FAN, sony_nc_fan_control_get,
+			sony_nc_fan_control_set);
+
 	return 0;
 
 attrserror:
@@ -3862,6 +6175,7 @@ static int sony_nc_fan_cleanup(struct platform_device *pd)
 	if (sony_fan) {
 		int i;
 
+		sony_nc_shadow_unregister(SNC_SHADOW_FAN);
 		for (i = 0; i < FAN_ATTRS_NUM; i++)
 			device_remove_file(&pd->dev, &sony_fan->attrs[i]);
 
@@ -3908,17 +6222,9 @@ static int sony_nc_odd_remove(void)
 }
 #endif
 
-static ssize_t sony_nc_odd_status_store(struct device *dev,
-		struct device_attribute *attr,
-		const char *buffer, size_t count)
+static int sony_nc_odd_status_set(unsigned long value)
 {
 	unsigned int result;
-	unsigned long value;
-
-	if (count > 31)
-		return -EINVAL;
-	if (strict_strtoul(buffer, 10, &value) || value > 1)
-		return -EINVAL;
 
 #if 0
 	if (off)
@@ -3939,7 +6245,21 @@ static ssize_t sony_nc_odd_status_store(struct device *dev,
 		/* force a bus scan? */
 #endif
 
-	return count;
+	return 0;
+}
+
+static ssize_t sony_nc_odd_status_store(struct device *dev,
+		struct device_attribute *attr,
+		const char *buffer, size_t count)
+{
+	unsigned long value;
+
+	if (count > 31)
+		return -EINVAL;
+	if (strict_strtoul(buffer, 10, &value) || value > 1)
+		return -EINVAL;
+
+	return sony_pf_cmd_submit(sony_nc_odd_status_set, value, count);
 }
 
 static ssize_t sony_nc_odd_status_show(struct device *dev,
@@ -3955,7 +6275,8 @@ static ssize_t sony_nc_odd_status_show(struct device *dev,
 	return count;
 }
 
-static int sony_nc_odd_setup(struct platform_device *pd)
+static int sony_nc_odd_setup(struct platform_device *pd,
+					unsigned int handle)
 {
 #define ODD_TAB_SIZE 32
 	u8 list[ODD_TAB_SIZE] = { 0 };
@@ -4032,15 +6353,14 @@ static struct backlight_device *sony_backlight_device;
 
 static int sony_backlight_update_status(struct backlight_device *bd)
 {
-	return acpi_callsetfunc(sony_nc_acpi_handle, "SBRT",
-				bd->props.brightness + 1, NULL);
+	return sony_nc_method_set(SNC_SBRT, bd->props.brightness + 1, NULL);
 }
 
 static int sony_backlight_get_brightness(struct backlight_device *bd)
 {
 	unsigned int value;
 
-	if (acpi_callgetfunc(sony_nc_acpi_handle, "GBRT", &value))
+	if (sony_nc_method_get(SNC_GBRT, &value))
 		return 0;
 	/* brightness levels are 1-based, while backlight ones are 0-based */
 	return value - 1;
@@ -4059,7 +6379,6 @@ static const struct backlight_ops sony_als_backlight_ops = {
 
 static void sony_nc_backlight_setup(void)
 {
-	acpi_handle unused;
 	int max_brightness = 0;
 	const struct backlight_ops *ops = NULL;
 	struct backlight_properties props;
@@ -4069,8 +6388,7 @@ static void sony_nc_backlight_setup(void)
 		/* ALS based backlight device */
 		ops = &sony_als_backlight_ops;
 		max_brightness = sony_als->levels_num - 1;
-	} else if (ACPI_SUCCESS(acpi_get_handle(sony_nc_acpi_handle, "GBRT",
-						&unused))) {
+	} else if (sony_nc_methods[SNC_GBRT]) {
 		ops = &sony_backlight_ops;
 		max_brightness = SONY_MAX_BRIGHTNESS - 1;
 	} else {
@@ -4096,6 +6414,7 @@ static void sony_nc_backlight_cleanup(void)
 {
 	if (sony_backlight_device)
 		backlight_device_unregister(sony_backlight_device);
+	sony_backlight_device = NULL;
 }
 
 static void sony_nc_tests_resume(void)
@@ -4127,137 +6446,343 @@ static void sony_nc_tests_setup(void)
 	return;
 }
 
+/* Hybrid GFX switching, no setup needed, event only */
+static int sony_nc_hgfx_notify(struct acpi_device *device,
+					unsigned int handle, int *value)
+{
+	unsigned int result = 0;
+
+	sony_call_snc_handle(handle, 0x0000, &result);
+	dprintk("sony_nc_notify, Hybrid GFX event received "
+			"(reason: %s)\n", (result & 0x01) ?
+			"switch position change" : "unknown");
+
+	/* verify the switch state
+	   (1: discrete GFX, 0: integrated GFX)*/
+	result = 0;
+	sony_call_snc_handle(handle, 0x0100, &result);
+
+	/* sony_laptop_report_input_event(); */
+
+	*value = result & 0xff;
+
+	return EV_HGFX;
+}
+
+/* handles 0x0137 and 0x0143 drive both the kbd backlight and the ALS */
+static int sony_nc_kbd_als_setup(struct platform_device *pd,
+					unsigned int handle)
+{
+	sony_nc_kbd_backlight_setup(pd, handle);
+
+	return sony_nc_als_setup(pd, handle);
+}
+
+static int sony_nc_kbd_als_cleanup(struct platform_device *pd)
+{
+	sony_nc_kbd_backlight_cleanup(pd);
+
+	return sony_nc_als_cleanup(pd);
+}
+
+static void sony_nc_kbd_als_resume(unsigned int handle)
+{
+	sony_nc_kbd_backlight_resume(handle);
+	sony_nc_als_resume(handle);
+}
+
+static const struct sony_nc_handle_ops sony_nc_function_ops = {
+	.setup = sony_nc_function_setup,
+	.resume = sony_nc_function_resume,
+};
+
+static const struct sony_nc_handle_ops sony_nc_hotkeys_ops = {
+	.setup = sony_nc_hotkeys_setup,
+	.cleanup = sony_nc_hotkeys_cleanup,
+	.resume = sony_nc_function_resume,
+	.notify = sony_nc_hotkeys_notify,
+};
+
+static const struct sony_nc_handle_ops sony_nc_touchpad_ops = {
+	.setup = sony_nc_touchpad_setup,
+	.cleanup = sony_nc_touchpad_cleanup,
+};
+
+static const struct sony_nc_handle_ops sony_nc_battery_care_ops = {
+	.setup = sony_nc_battery_care_setup,
+	.cleanup = sony_nc_battery_care_cleanup,
+	.cache_ttl = &battery_care_cache_ttl,
+};
+
+static const struct sony_nc_handle_ops sony_nc_lid_resume_ops = {
+	.setup = sony_nc_lid_resume_setup,
+	.cleanup = sony_nc_lid_resume_cleanup,
+};
+
+static const struct sony_nc_handle_ops sony_nc_thermal_ops = {
+	.setup = sony_nc_thermal_setup,
+	.cleanup = sony_nc_thermal_cleanup,
+	.cache_ttl = &thermal_cache_ttl,
+};
+
+static const struct sony_nc_handle_ops sony_nc_odd_ops = {
+	.setup = sony_nc_odd_setup,
+	.cleanup = sony_nc_odd_cleanup,
+};
+
+static const struct sony_nc_handle_ops sony_nc_kbd_als_ops = {
+	.setup = sony_nc_kbd_als_setup,
+	.cleanup = sony_nc_kbd_als_cleanup,
+	.resume = sony_nc_kbd_als_resume,
+	.notify = sony_nc_als_notify,
+	.cache_ttl = &als_cache_ttl,
+};
+
+static const struct sony_nc_handle_ops sony_nc_als_ops = {
+	.setup = sony_nc_als_setup,
+	.cleanup = sony_nc_als_cleanup,
+	.resume = sony_nc_als_resume,
+	.notify = sony_nc_als_notify,
+	.cache_ttl = &als_cache_ttl,
+};
+
+static const struct sony_nc_handle_ops sony_nc_highspeed_charging_ops = {
+	.setup = sony_nc_highspeed_charging_setup,
+	.cleanup = sony_nc_highspeed_charging_cleanup,
+};
+
+static const struct sony_nc_handle_ops sony_nc_gsensor_ops = {
+	.setup = sony_nc_gsensor_setup,
+	.cleanup = sony_nc_gsensor_cleanup,
+	.notify = sony_nc_gsensor_notify,
+	.cache_ttl = &gsensor_cache_ttl,
+};
+
+static const struct sony_nc_handle_ops sony_nc_fan_ops = {
+	.setup = sony_nc_fan_setup,
+	.cleanup = sony_nc_fan_cleanup,
+	.cache_ttl = &fan_cache_ttl,
+};
+
+static const struct sony_nc_handle_ops sony_nc_rfkill_ops = {
+	.setup = sony_nc_rfkill_setup,
+	.cleanup = sony_nc_rfkill_cleanup,
+	.resume = sony_nc_rfkill_resume,
+	.notify = sony_nc_rfkill_notify,
+};
+
+static const struct sony_nc_handle_ops sony_nc_hgfx_ops = {
+	.notify = sony_nc_hgfx_notify,
+};
+
+static const struct sony_nc_handle_desc {
+	unsigned int handle;
+	const struct sony_nc_handle_ops *ops;
+} sony_nc_handle_table[] = {
+	{ 0x0100, &sony_nc_hotkeys_ops },
+	{ 0x0127, &sony_nc_hotkeys_ops },
+	{ 0x0101, &sony_nc_function_ops },
+	{ 0x0102, &sony_nc_function_ops },
+	{ 0x0105, &sony_nc_touchpad_ops },
+	{ 0x0148, &sony_nc_touchpad_ops }, /* same as 0x0105 + Fn-F1 combo */
+	{ 0x0115, &sony_nc_battery_care_ops },
+	{ 0x0136, &sony_nc_battery_care_ops },
+	{ 0x013f, &sony_nc_battery_care_ops },
+	{ 0x0119, &sony_nc_lid_resume_ops },
+	{ 0x0122, &sony_nc_thermal_ops },
+	{ 0x0126, &sony_nc_odd_ops },
+	{ 0x0137, &sony_nc_kbd_als_ops },
+	{ 0x0143, &sony_nc_kbd_als_ops },
+	{ 0x012f, &sony_nc_als_ops }, /* no keyboard backlight */
+	{ 0x0131, &sony_nc_highspeed_charging_ops },
+	{ 0x0134, &sony_nc_gsensor_ops },
+	{ 0x0147, &sony_nc_gsensor_ops },
+	{ SONY_FAN_HANDLE, &sony_nc_fan_ops },
+	{ 0x0124, &sony_nc_rfkill_ops },
+	{ 0x0135, &sony_nc_rfkill_ops },
+	{ 0x0128, &sony_nc_hgfx_ops },
+	{ 0x0146, &sony_nc_hgfx_ops },
+	{ 0, NULL }
+};
+
+static const struct sony_nc_handle_ops *sony_nc_handle_ops_find(
+							unsigned int handle)
+{
+	const struct sony_nc_handle_desc *desc;
+
+	for (desc = sony_nc_handle_table; desc->handle; desc++) {
+		if (desc->handle == handle)
+			return desc->ops;
+	}
+
+	return NULL;
+}
+
+/*
+ * The SNC handles discovery and the features setup run asynchronously
+ * so that the module load does not wait for the EC, the features show
+ * up as their setup completes and the probe_status attribute reports
+ * the progress.  The probe is a work item: an async_schedule() from the
+ * insmod task would make the module load wait for it anyway, the async
+ * domain only spreads the features setup.
+ */
+enum sony_nc_probe_state {
+	SNC_PROBE_DISCOVERY,
+	SNC_PROBE_SETUP,
+	SNC_PROBE_READY,
+	SNC_PROBE_FAILED,
+};
+
+static ASYNC_DOMAIN_EXCLUSIVE(sony_nc_setup_domain);
+static int sony_nc_probe_state;
+static atomic_t sony_nc_setup_done;
+static unsigned int sony_nc_setup_total;
+static unsigned int sony_nc_events_bitmask;
+static struct device_attribute sony_nc_probe_attr;
+
+static ssize_t sony_nc_probe_status_show(struct device *dev,
+		struct device_attribute *attr, char *buffer)
+{
+	/* set by the probe work meanwhile */
+	switch (ACCESS_ONCE(sony_nc_probe_state)) {
+	case SNC_PROBE_DISCOVERY:
+		return snprintf(buffer, PAGE_SIZE, "discovery\n");
+	case SNC_PROBE_SETUP:
+		return snprintf(buffer, PAGE_SIZE, "setup %d/%u\n",
+				atomic_read(&sony_nc_setup_done),
+				ACCESS_ONCE(sony_nc_setup_total));
+	case SNC_PROBE_READY:
+		return snprintf(buffer, PAGE_SIZE, "ready\n");
+	default:
+		return snprintf(buffer, PAGE_SIZE, "failed\n");
+	}
+}
+
+static void sony_nc_probe_state_set(int state)
+{
+	ACCESS_ONCE(sony_nc_probe_state) = state;
+	sysfs_notify(&sony_pf_device->dev.kobj, NULL, "probe_status");
+}
+
+/* setup of the feature behind the handle at offset data */
+static void sony_nc_setup_handle_async(void *data, async_cookie_t cookie)
+{
+	unsigned int i = (unsigned long) data;
+	unsigned int handle = handles->cap[i];
+	const struct sony_nc_handle_ops *ops;
+	ktime_t start = ktime_get();
+	int ret;
+
+	dprintk("looking at handle 0x%.4x\n", handle);
+
+	ops = sony_nc_handle_ops_find(handle);
+	ret = ops->setup(sony_pf_device, handle);
+	trace_sony_nc_handle_setup(handle, ret,
+			ktime_to_ns(ktime_sub(ktime_get(), start)));
+	if (ret < 0) {
+		pr_warn("handle 0x%.4x setup failed (ret: %i)",
+							handle, ret);
+	} else {
+		dprintk("handle 0x%.4x setup completed\n", handle);
+	}
+
+	/* online: notifications and resume go to the feature from now on */
+	sony_nc_handle_ops_set(i, ops);
+
+	atomic_inc(&sony_nc_setup_done);
+	sysfs_notify(&sony_pf_device->dev.kobj, NULL, "probe_status");
+}
+
 static void sony_nc_snc_setup_handles(struct platform_device *pd)
 {
 	unsigned int i;
 
 	for (i = 0; i < ARRAY_SIZE(handles->cap); i++) {
-		int ret = 0;
 		int unsigned handle = handles->cap[i];
+		const struct sony_nc_handle_ops *ops;
 
 		if (!handle)
 			continue;
 
-		dprintk("looking at handle 0x%.4x\n", handle);
+		ops = sony_nc_handle_ops_find(handle);
+		if (!ops)
+			continue;
 
-		switch (handle) {
-		case 0x0100:
-		case 0x0127:
-		case 0x0101:
-		case 0x0102:
-			ret = sony_nc_function_setup(handle);
-			break;
-		case 0x0105:
-		case 0x0148: /* same as 0x0105 + Fn-F1 combo */
-			ret = sony_nc_touchpad_setup(pd, handle);
-			break;
-		case 0x0115:
-		case 0x0136:
-		case 0x013f:
-			ret = sony_nc_battery_care_setup(pd, handle);
-			break;
-		case 0x0119:
-			ret = sony_nc_lid_resume_setup(pd);
-			break;
-		case 0x0122:
-			ret = sony_nc_thermal_setup(pd);
-			break;
-		case 0x0126:
-			ret = sony_nc_odd_setup(pd);
-			break;
-		case 0x0137:
-		case 0x0143:
-			ret = sony_nc_kbd_backlight_setup(pd, handle);
-		case 0x012f: /* no keyboard backlight */
-			ret = sony_nc_als_setup(pd, handle);
-			break;
-		case 0x0131:
-			ret = sony_nc_highspeed_charging_setup(pd);
-			break;
-		case 0x0134:
-		case 0x0147:
-			ret = sony_nc_gsensor_setup(pd, handle);
-			break;
-		case 0x0149:
-			ret = sony_nc_fan_setup(pd);
-			break;
-		case 0x0124:
-		case 0x0135:
-			ret = sony_nc_rfkill_setup(sony_nc_acpi_device, handle);
-			break;
-		default:
+		/* nothing to wait for */
+		if (!ops->setup) {
+			sony_nc_handle_ops_set(i, ops);
 			continue;
 		}
 
-		if (ret < 0) {
-			pr_warn("handle 0x%.4x setup failed (ret: %i)",
-								handle, ret);
-		} else {
-			dprintk("handle 0x%.4x setup completed\n", handle);
-		}
+		ACCESS_ONCE(sony_nc_setup_total) = sony_nc_setup_total + 1;
+		async_schedule_domain(sony_nc_setup_handle_async,
+				(void *) (unsigned long) i,
+				&sony_nc_setup_domain);
 	}
 
+	async_synchronize_full_domain(&sony_nc_setup_domain);
+
 	if (debug)
 		sony_nc_tests_setup();
 }
 
+static void sony_nc_snc_probe_work_fn(struct work_struct *work)
+{
+	unsigned int result;
+	ktime_t start = ktime_get();
+
+	/* retrieve the available handles, otherwise return */
+	if (sony_nc_handles_setup(sony_pf_device)) {
+		pr_err("unable to retrieve the SNC handles\n");
+		sony_nc_probe_state_set(SNC_PROBE_FAILED);
+		return;
+	}
+	trace_sony_nc_handle_setup(0, 0,
+			ktime_to_ns(ktime_sub(ktime_get(), start)));
+
+	/* setup found handles here */
+	sony_nc_probe_state_set(SNC_PROBE_SETUP);
+	sony_nc_snc_setup_handles(sony_pf_device);
+
+	/* the ALS based backlight needs the ALS setup done */
+	if (!acpi_video_backlight_support())
+		sony_nc_backlight_setup();
+
+	/* Enable all events for the found handles */
+	if (sony_nc_method_set(SNC_SN02, sony_nc_events_bitmask, &result)) {
+		pr_err("unable to enable the SNC events\n");
+		sony_nc_probe_state_set(SNC_PROBE_FAILED);
+		return;
+	}
+
+	sony_nc_probe_state_set(SNC_PROBE_READY);
+}
+
+static DECLARE_WORK(sony_nc_snc_probe_work, sony_nc_snc_probe_work_fn);
+
+/* wait for the asynchronous probe to complete */
+static void sony_nc_snc_sync(void)
+{
+	flush_work(&sony_nc_snc_probe_work);
+}
+
 static void sony_nc_snc_cleanup_handles(struct platform_device *pd)
 {
 	unsigned int i;
 
-	for (i = 0; i < ARRAY_SIZE(handles->cap); i++) {
+	if (!handles)
+		return;
 
-		int unsigned handle = handles->cap[i];
+	for (i = 0; i < ARRAY_SIZE(handles->cap); i++) {
+		const struct sony_nc_handle_ops *ops = handles->ops[i];
 
-		if (!handle)
+		if (!ops || !ops->cleanup)
 			continue;
 
-		dprintk("looking at handle 0x%.4x\n", handle);
-
-		switch (handle) {
-		case 0x0105:
-		case 0x0148:
-			sony_nc_touchpad_cleanup(pd);
-			break;
-		case 0x0115:
-		case 0x0136:
-		case 0x013f:
-			sony_nc_battery_care_cleanup(pd);
-			break;
-		case 0x0119:
-			sony_nc_lid_resume_cleanup(pd);
-			break;
-		case 0x0122:
-			sony_nc_thermal_cleanup(pd);
-			break;
-		case 0x0126:
-			sony_nc_odd_cleanup(pd);
-			break;
-		case 0x0137:
-		case 0x0143:
-			sony_nc_kbd_backlight_cleanup(pd);
-		case 0x012f:
-			sony_nc_als_cleanup(pd);
-			break;
-		case 0x0131:
-			sony_nc_highspeed_charging_cleanup(pd);
-			break;
-		case 0x0134:
-		case 0x0147:
-			sony_nc_gsensor_cleanup(pd);
-			break;
-		case 0x0149:
-			sony_nc_fan_cleanup(pd);
-			break;
-		case 0x0124:
-		case 0x0135:
-			sony_nc_rfkill_cleanup();
-			break;
-		default:
-			continue;
-		}
+		dprintk("looking at handle 0x%.4x\n", handles->cap[i]);
 
-		dprintk("handle 0x%.4x deconfigured\n", handle);
+		ops->cleanup(pd);
+		dprintk("handle 0x%.4x deconfigured\n", handles->cap[i]);
 	}
 }
 
@@ -4266,8 +6791,7 @@ static int sony_nc_snc_setup(struct platform_device *pd)
 	unsigned int i, string[4], bitmask, result;
 
 	for (i = 0; i < 4; i++) {
-		if (acpi_callsetfunc(sony_nc_acpi_handle,
-				"SN00", i, &string[i]))
+		if (sony_nc_method_set(SNC_SN00, i, &string[i]))
 			return -EIO;
 	}
 	if (strncmp("SncSupported", (char *) string, 0x10)) {
@@ -4275,7 +6799,7 @@ static int sony_nc_snc_setup(struct platform_device *pd)
 		return -1;
 	}
 
-	if (!acpi_callsetfunc(sony_nc_acpi_handle, "SN00", 0x04, &result)) {
+	if (!sony_nc_method_set(SNC_SN00, 0x04, &result)) {
 		unsigned int model, i;
 		for (model = 0, i = 0; i < 4; i++)
 			model |= ((result >> (i * 8)) & 0xff) << ((3 - i) * 8);
@@ -4283,20 +6807,23 @@ static int sony_nc_snc_setup(struct platform_device *pd)
 	}
 
 	/* retrieve the implemented offsets mask */
-	if (acpi_callsetfunc(sony_nc_acpi_handle, "SN00", 0x10, &bitmask))
+	if (sony_nc_method_set(SNC_SN00, 0x10, &bitmask))
 		return -EIO;
+	sony_nc_events_bitmask = bitmask;
 
-	/* retrieve the available handles, otherwise return */
-	if (sony_nc_handles_setup(pd))
-		return -2;
-
-	/* setup found handles here */
-	sony_nc_snc_setup_handles(pd);
-
-	/* Enable all events for the found handles, otherwise return */
-	if (acpi_callsetfunc(sony_nc_acpi_handle, "SN02", bitmask, &result))
+	sysfs_attr_init(&sony_nc_probe_attr.attr);
+	sony_nc_probe_attr.attr.name = "probe_status";
+	sony_nc_probe_attr.attr.mode = S_IRUGO;
+	sony_nc_probe_attr.show = sony_nc_probe_status_show;
+	if (device_create_file(&pd->dev, &sony_nc_probe_attr))
 		return -EIO;
 
+	/* the handles discovery and setup go on in background */
+	sony_nc_probe_state = SNC_PROBE_DISCOVERY;
+	atomic_set(&sony_nc_setup_done, 0);
+	sony_nc_setup_total = 0;
+	queue_work(system_unbound_wq, &sony_nc_snc_probe_work);
+
 	/* check for SN05 presence? */
 
 	return 0;
@@ -4306,11 +6833,15 @@ static int sony_nc_snc_cleanup(struct platform_device *pd)
 {
 	unsigned int result, bitmask;
 
+	sony_nc_snc_sync();
+	if (sony_nc_probe_attr.attr.name)
+		device_remove_file(&pd->dev, &sony_nc_probe_attr);
+
 	/* retrieve the event enabled handles */
-	acpi_callgetfunc(sony_nc_acpi_handle, "SN01", &bitmask);
+	sony_nc_method_get(SNC_SN01, &bitmask);
 
 	/* disable the event generation	for every handle */
-	acpi_callsetfunc(sony_nc_acpi_handle, "SN03", bitmask, &result);
+	sony_nc_method_set(SNC_SN03, bitmask, &result);
 
 	/* cleanup handles here */
 	sony_nc_snc_cleanup_handles(pd);
@@ -4320,58 +6851,62 @@ static int sony_nc_snc_cleanup(struct platform_device *pd)
 	return 0;
 }
 
-static int sony_nc_snc_resume(void)
+static void sony_nc_resume_deferred(struct work_struct *work);
+static DECLARE_WORK(sony_nc_resume_work, sony_nc_resume_deferred);
+
+static int sony_nc_snc_resume(void)
+{
+	unsigned int result, bitmask;
+	ktime_t start = ktime_get();
+
+	/* enable all events again unless the firmware kept them enabled */
+	if (sony_nc_method_get(SNC_SN01, &bitmask) ||
+			bitmask != sony_nc_events_bitmask) {
+		if (sony_nc_method_set(SNC_SN02, sony_nc_events_bitmask,
+					&result))
+			return -EIO;
+	}
+	sony_resume_step("events", 0, start);
+
+	/* nothing read before suspending can be trusted */
+	sony_nc_cache_invalidate_all();
+
+	/* the features state is restored once the resume is over */
+	INIT_COMPLETION(sony_nc_resume_done);
+	queue_work(system_freezable_wq, &sony_nc_resume_work);
+
+	return 0;
+}
+
+/* deferred part of the SNC resume */
+static void sony_nc_resume_deferred(struct work_struct *work)
 {
-	unsigned int i, result, bitmask;
+	unsigned int i;
+	ktime_t start = ktime_get();
 
-	/* retrieve the implemented offsets mask */
-	if (acpi_callsetfunc(sony_nc_acpi_handle, "SN00", 0x10, &bitmask))
-		return -EIO;
+	sony_nc_shadow_restore();
+	sony_resume_step("shadow", 0, start);
 
-	/* Enable all events, otherwise return */
-	if (acpi_callsetfunc(sony_nc_acpi_handle, "SN02", bitmask, &result))
-		return -EIO;
+	if (!handles)
+		goto out;
 
 	for (i = 0; i < ARRAY_SIZE(handles->cap); i++) {
-		int unsigned handle = handles->cap[i];
+		const struct sony_nc_handle_ops *ops = handles->ops[i];
 
-		if (!handle)
-			continue;
-
-		dprintk("looking at handle 0x%.4x\n", handle);
-
-		switch (handle) {
-		case 0x0100:
-		case 0x0127:
-		case 0x0101:
-		case 0x0102:
-			sony_nc_function_setup(handle);
-			break;
-		case 0x0122:
-			sony_nc_thermal_resume();
-			break;
-		case 0x0124:
-		case 0x0135:
-			/* re-read rfkill state */
-			sony_nc_rfkill_update();
-			break;
-		case 0x0137: /* kbd + als */
-		case 0x0143:
-			sony_nc_kbd_backlight_resume();
-		case 0x012f: /* als only */
-			sony_nc_als_resume();
-			break;
-		default:
+		if (!ops || !ops->resume)
 			continue;
-		}
 
-		dprintk("handle 0x%.4x updated\n", handle);
+		start = ktime_get();
+		ops->resume(handles->cap[i]);
+		sony_resume_step("handle", handles->cap[i], start);
+		dprintk("handle 0x%.4x updated\n", handles->cap[i]);
 	}
 
 	if (debug)
 		sony_nc_tests_resume();
 
-	return 0;
+out:
+	complete_all(&sony_nc_resume_done);
 }
 
 /*
@@ -4392,147 +6927,84 @@ static acpi_status sony_walk_callback(acpi_handle handle, u32 level,
 	return AE_OK;
 }
 
-#define EV_HOTKEYS	1
-#define EV_RFKILL	2
-#define EV_ALS		3
-#define EV_GSENSOR	4
-#define	EV_HGFX		5
 static void sony_nc_notify(struct acpi_device *device, u32 event)
 {
 	u8 ev = 0;
 	int value = 0;
-	char *env[2] = { NULL };
-
-	dprintk("sony_nc_notify, event: 0x%.2x\n", event);
+	unsigned int handle = 0;
+	struct sony_event_stamp st = {
+		.source = SONY_EVENT_SRC_SNC,
+		.code = event,
+		.start = ktime_get(),
+	};
 
 	/* handles related events */
 	if (event >= 0x90) {
-		unsigned int result = 0, handle = 0;
+		unsigned int result = 0;
+		const struct sony_nc_handle_ops *ops = NULL;
 
 		/* the event should corrispond to the offset of the method */
 		unsigned int offset = event - 0x90;
 
-		handle = handles->cap[offset];
-		switch (handle) {
-		/* list of handles known for generating events */
-		case 0x0100:
-		case 0x0127:
-			/* hotkey event, a key has been pressed, retrieve it */
-			value = sony_nc_hotkeys_decode(handle);
-			if (value > 0) /* known event */
-				sony_laptop_report_input_event(value);
-			else /* restore the original event */
-			    value = event;
-
-			ev = EV_HOTKEYS;
-			break;
-
-		case 0x0143:
-			sony_call_snc_handle(handle, 0x2000, &result);
-			/* event reasons are reverted */
-			value = (result & 0x03) == 1 ? 2 : 1;
-			dprintk("sony_nc_notify, ALS event received (reason:"
-				       " %s change)\n", value == 1 ? "light" :
-				       "backlight");
-
-			env[0] = (value == 1) ? "ALS=1" : "ALS=2";
-			kobject_uevent_env(&device->dev.kobj, KOBJ_CHANGE, env);
-
-			ev = EV_ALS;
-			break;
-
-		case 0x012f:
-		case 0x0137:
-			sony_call_snc_handle(handle, 0x0800, &result);
-			value = result & 0x03;
-			dprintk("sony_nc_notify, ALS event received (reason:"
-					" %s change)\n", value == 1 ? "light" :
-					"backlight");
-			if (value == 1) /* lighting change reason */
-				sony_nc_als_event_handler();
-
-			env[0] = (value == 1) ? "ALS=1" : "ALS=2";
-			kobject_uevent_env(&device->dev.kobj, KOBJ_CHANGE, env);
-
-			ev = EV_ALS;
-			break;
-
-		case 0x0124:
-		case 0x0135:
-			sony_call_snc_handle(handle, 0x0100, &result);
-			result &= 0x03;
-			dprintk("sony_nc_notify, RFKILL event received "
-					"(reason: %s)\n", result == 1 ?
-					"switch state changed" : "battery");
-
-			if (result == 1) { /* hw swtich event */
-				sony_nc_rfkill_update();
-				value = sony_nc_get_rfkill_hwblock();
-			} else if (result == 2) { /* battery event */
-				/*  we might need to change the WWAN rfkill
-				    state when the battery state changes
-				 */
-				sony_nc_rfkill_update_wwan();
+		if (handles && offset < ARRAY_SIZE(handles->cap)) {
+			handle = handles->cap[offset];
+			ops = sony_nc_handle_ops(offset);
+		}
+		if (ops)
+			sony_event_count(SONY_EVENT_SRC_SNC, event);
+		else
+			sony_event_count_unknown(SONY_EVENT_SRC_SNC);
+
+		/* the state behind the handle changed, drop cached values */
+		sony_nc_cache_invalidate_offset(offset);
+
+		/* unknown events are passed as they are */
+		value = event;
+		if (ops && ops->notify) {
+			int ret = ops->notify(device, handle, &value);
+
+			/* the handles report their keys while decoding */
+			sony_event_stamp(&st, SONY_EVENT_DECODE);
+			st.stage[SONY_EVENT_INPUT] =
+				st.stage[SONY_EVENT_DECODE];
+
+			/* consumed, no event for userspace */
+			if (ret < 0) {
+				trace_sony_nc_notify(event, handle, 0, value);
+				sony_event_ring_put(&st, value);
+				sony_event_stamp(&st, SONY_EVENT_QUEUE);
+				sony_event_stamp_done(&st);
 				return;
 			}
-
-			ev = EV_RFKILL;
-			break;
-
-		case 0x0134:
-		case 0x0147:
-			ev = 4;
-			value = EV_GSENSOR;
-			/* hdd protection event, notify userspace */
-
-			env[0] = "HDD_SHOCK=1";
-			kobject_uevent_env(&device->dev.kobj, KOBJ_CHANGE, env);
-
-			break;
-
-		case 0x0128:
-		case 0x0146:
-			/* Hybrid GFX switching, 1 */
-			sony_call_snc_handle(handle, 0x0000, &result);
-			dprintk("sony_nc_notify, Hybrid GFX event received "
-					"(reason: %s)\n", (result & 0x01) ?
-					"switch position change" : "unknown");
-
-			/* verify the switch state
-			   (1: discrete GFX, 0: integrated GFX)*/
-			result = 0;
-			sony_call_snc_handle(handle, 0x0100, &result);
-
-			/* sony_laptop_report_input_event(); */
-
-			ev = EV_HGFX;
-			value = result & 0xff;
-			break;
-
-		default:
-			value = event;
-			dprintk("Unknowk event for handle: 0x%x\n", handle);
-			break;
+			ev = ret;
+		} else {
+			sony_event_stamp(&st, SONY_EVENT_DECODE);
+			sony_event_stamp(&st, SONY_EVENT_INPUT);
 		}
 
 		/* clear the event (and the event reason when present) */
-		acpi_callsetfunc(sony_nc_acpi_handle, "SN05", 1 << offset,
-				&result);
+		sony_nc_method_set(SNC_SN05, 1 << offset, &result);
 	} else {
 		ev = 1;
+		sony_event_count(SONY_EVENT_SRC_SNC, event);
+		sony_event_stamp(&st, SONY_EVENT_DECODE);
 		sony_laptop_report_input_event(event);
+		sony_event_stamp(&st, SONY_EVENT_INPUT);
 	}
 
+	trace_sony_nc_notify(event, handle, ev, value);
+	sony_event_ring_put(&st, value);
 	acpi_bus_generate_proc_event(device, ev, value);
 	acpi_bus_generate_netlink_event(device->pnp.device_class,
 					dev_name(&device->dev), ev, value);
+	sony_event_stamp(&st, SONY_EVENT_QUEUE);
+	sony_event_stamp_done(&st);
 }
 
 static int sony_nc_add(struct acpi_device *device)
 {
 	acpi_status status;
 	int result = 0;
-	acpi_handle handle;
 	struct sony_nc_value *item;
 
 	pr_info("%s v%s\n", SONY_NC_DRIVER_NAME, SONY_LAPTOP_DRIVER_VERSION);
@@ -4541,6 +7013,7 @@ static int sony_nc_add(struct acpi_device *device)
 	strcpy(acpi_device_class(device), "sony/hotkey");
 
 	sony_nc_acpi_handle = device->handle;
+	sony_nc_resolve_methods();
 
 	/* read device status */
 	result = acpi_bus_get_status(device);
@@ -4567,14 +7040,12 @@ static int sony_nc_add(struct acpi_device *device)
 		}
 	}
 
-	if (ACPI_SUCCESS(acpi_get_handle(sony_nc_acpi_handle, "ECON",
-					 &handle))) {
-		if (acpi_callsetfunc(sony_nc_acpi_handle, "ECON", 1, NULL))
+	if (sony_nc_methods[SNC_ECON]) {
+		if (sony_nc_method_set(SNC_ECON, 1, NULL))
 			dprintk("ECON Method failed\n");
 	}
 
-	if (ACPI_SUCCESS(acpi_get_handle(sony_nc_acpi_handle, "SN00",
-					 &handle))) {
+	if (sony_nc_methods[SNC_SN00]) {
 		dprintk("Doing SNC setup\n");
 
 		if (sony_nc_snc_setup(sony_pf_device))
@@ -4588,10 +7059,11 @@ static int sony_nc_add(struct acpi_device *device)
 		goto outsnc;
 	}
 
+	/* with SNC the backlight is registered once the probe completes */
 	if (acpi_video_backlight_support()) {
 		pr_info("brightness ignored, must be "
 			"controlled by ACPI video driver\n");
-	} else {
+	} else if (!sony_nc_methods[SNC_SN00]) {
 		sony_nc_backlight_setup();
 	}
 
@@ -4605,7 +7077,7 @@ static int sony_nc_add(struct acpi_device *device)
 		for (; item->acpiget && *item->acpiget; ++item->acpiget) {
 			if (ACPI_SUCCESS(acpi_get_handle(sony_nc_acpi_handle,
 							 *item->acpiget,
-							 &handle))) {
+							 &item->getter))) {
 				dprintk("Found %s getter: %s\n",
 						item->name, *item->acpiget);
 				item->devattr.attr.mode |= S_IRUGO;
@@ -4617,7 +7089,7 @@ static int sony_nc_add(struct acpi_device *device)
 		for (; item->acpiset && *item->acpiset; ++item->acpiset) {
 			if (ACPI_SUCCESS(acpi_get_handle(sony_nc_acpi_handle,
 							 *item->acpiset,
-							 &handle))) {
+							 &item->setter))) {
 				dprintk("Found %s setter: %s\n",
 						item->name, *item->acpiset);
 				item->devattr.attr.mode |= S_IWUSR;
@@ -4640,11 +7112,11 @@ out_sysfs:
 	for (item = sony_nc_values; item->name; ++item)
 		device_remove_file(&sony_pf_device->dev, &item->devattr);
 
-	sony_nc_backlight_cleanup();
-
 	sony_laptop_remove_input();
 
 outsnc:
+	sony_nc_snc_sync();
+	sony_nc_backlight_cleanup();
 	sony_nc_snc_cleanup(sony_pf_device);
 
 outpresent:
@@ -4658,6 +7130,9 @@ static int sony_nc_remove(struct acpi_device *device, int type)
 {
 	struct sony_nc_value *item;
 
+	sony_nc_snc_sync();
+	cancel_work_sync(&sony_nc_resume_work);
+	complete_all(&sony_nc_resume_done);
 	sony_nc_backlight_cleanup();
 
 	sony_nc_acpi_device = NULL;
@@ -4665,6 +7140,7 @@ static int sony_nc_remove(struct acpi_device *device, int type)
 	for (item = sony_nc_values; item->name; ++item)
 		device_remove_file(&sony_pf_device->dev, &item->devattr);
 
+	sony_pf_cmd_drain();
 	sony_nc_snc_cleanup(sony_pf_device);
 	sony_pf_remove();
 	sony_laptop_remove_input();
@@ -4676,38 +7152,51 @@ static int sony_nc_remove(struct acpi_device *device, int type)
 static int sony_nc_resume(struct acpi_device *device)
 {
 	struct sony_nc_value *item;
-	acpi_handle handle;
+	ktime_t start = ktime_get();
 
 	for (item = sony_nc_values; item->name; item++) {
+		unsigned int value;
 		int ret;
 
 		if (!item->valid)
 			continue;
-		ret = acpi_callsetfunc(sony_nc_acpi_handle, *item->acpiset,
-				       item->value, NULL);
+
+		/* skip what the firmware kept across the suspend */
+		if (item->getter &&
+				!sony_nc_value_get(item, &value) &&
+				value == item->value)
+			continue;
+
+		ret = sony_nc_value_set(item, item->value);
 		if (ret < 0) {
 			pr_err("%s: %d\n", __func__, ret);
 			break;
 		}
 	}
+	sony_resume_step("values", 0, start);
 
-	if (ACPI_SUCCESS(acpi_get_handle(sony_nc_acpi_handle, "ECON",
-					 &handle))) {
-		if (acpi_callsetfunc(sony_nc_acpi_handle, "ECON", 1, NULL))
+	if (sony_nc_methods[SNC_ECON]) {
+		start = ktime_get();
+		if (sony_nc_method_set(SNC_ECON, 1, NULL))
 			dprintk("ECON Method failed\n");
+		sony_resume_step("ECON", 0, start);
 	}
 
-	if (ACPI_SUCCESS(acpi_get_handle(sony_nc_acpi_handle, "SN00",
-					 &handle))) {
+	if (sony_nc_methods[SNC_SN00]) {
 		dprintk("Doing SNC setup\n");
 
+		start = ktime_get();
+		sony_nc_snc_sync();
+		sony_resume_step("probe wait", 0, start);
 		sony_nc_snc_resume();
 	}
 
 	/* set the last requested brightness level */
+	start = ktime_get();
 	if (sony_backlight_device &&
 		sony_backlight_ops.update_status(sony_backlight_device) < 0)
 		pr_warn("unable to restore brightness level\n");
+	sony_resume_step("backlight", 0, start);
 
 	return 0;
 }
@@ -4764,6 +7253,8 @@ struct sonypi_eventtypes {
 	struct sonypi_event	*events;
 };
 
+struct sony_pic_decode;
+
 struct sony_pic_dev {
 	struct acpi_device		*acpi_dev;
 	struct sony_pic_irq		*cur_irq;
@@ -4772,6 +7263,11 @@ struct sony_pic_dev {
 	struct list_head		ioports;
 	struct mutex			lock;
 	struct sonypi_eventtypes	*event_types;
+	struct sony_pic_decode __rcu	*decode;
+	/* last event read by the hard irq handler, for the irq thread */
+	u8				irq_ev;
+	u8				irq_data_mask;
+	ktime_t				irq_stamp;
 	int                             (*handle_irq)(const u8, const u8);
 	int				model;
 	u16				evport_offset;
@@ -5006,6 +7502,116 @@ static struct sonypi_eventtypes type3_events[] = {
 	{ 0 },
 };
 
+/*
+ * Flattened decoding of the SPIC interrupts: the data masks matching the
+ * same set of event types share a class and every class has a direct
+ * ev -> event table. Built at probe time, rebuilt when mask changes.
+ */
+struct sony_pic_decode {
+	u8 class[0x100];	/* data mask -> class */
+	u8 events[0][0x100];	/* class, ev -> event, 0 if unknown */
+};
+
+static DEFINE_MUTEX(sony_pic_decode_lock);
+
+static struct sony_pic_decode *sony_pic_decode_build(
+		struct sonypi_eventtypes *types, unsigned long mask)
+{
+	struct sony_pic_decode *d;
+	unsigned int dm, prev, i, j, classes = 0;
+	u8 class[0x100];
+	u32 *sets;
+
+	sets = kcalloc(0x100, sizeof(u32), GFP_KERNEL);
+	if (!sets)
+		return NULL;
+
+	/* the enabled types accepting every data mask, by priority */
+	for (dm = 0; dm < 0x100; dm++) {
+		for (i = 0; i < 32 && types[i].mask; i++) {
+			if ((dm & types[i].data) == types[i].data &&
+					(mask & types[i].mask))
+				sets[dm] |= 1 << i;
+		}
+
+		for (prev = 0; prev < dm; prev++) {
+			if (sets[prev] == sets[dm])
+				break;
+		}
+		class[dm] = prev < dm ? class[prev] : classes++;
+	}
+
+	d = kzalloc(sizeof(*d) + classes * sizeof(d->events[0]),
+			GFP_KERNEL);
+	if (!d)
+		goto out;
+
+	memcpy(d->class, class, sizeof(d->class));
+
+	/*
+	 * fill each class from the first data mask using it, the classes
+	 * are numbered in that order; the first type listing an ev wins
+	 */
+	for (dm = 0, classes = 0; dm < 0x100; dm++) {
+		u8 *events = d->events[class[dm]];
+
+		if (class[dm] != classes)
+			continue;
+		classes++;
+
+		for (i = 0; i < 32 && types[i].mask; i++) {
+			if (!(sets[dm] & (1 << i)))
+				continue;
+
+			for (j = 0; types[i].events[j].event; j++) {
+				u8 ev = types[i].events[j].data;
+
+				if (!events[ev])
+					events[ev] = types[i].events[j].event;
+			}
+		}
+	}
+
+out:
+	kfree(sets);
+	return d;
+}
+
+/* replace the decoding table, types NULL drops it */
+static int __sony_pic_decode_update(struct sonypi_eventtypes *types)
+{
+	struct sony_pic_decode *new = NULL, *old;
+
+	if (types) {
+		new = sony_pic_decode_build(types, mask);
+		if (!new)
+			return -ENOMEM;
+	}
+
+	old = rcu_dereference_protected(spic_dev.decode,
+			lockdep_is_held(&sony_pic_decode_lock));
+	rcu_assign_pointer(spic_dev.decode, new);
+	synchronize_rcu();
+	kfree(old);
+
+	return 0;
+}
+
+static int sony_pic_mask_set(const char *val, const struct kernel_param *kp)
+{
+	int ret = param_set_ulong(val, kp);
+
+	if (ret)
+		return ret;
+
+	mutex_lock(&sony_pic_decode_lock);
+	if (rcu_access_pointer(spic_dev.decode))
+		ret = __sony_pic_decode_update(spic_dev.event_types);
+	mutex_unlock(&sony_pic_decode_lock);
+
+	return ret;
+}
+
 /* low level spic calls */
 #define ITERATIONS_LONG		10000
 #define ITERATIONS_SHORT	10
@@ -5022,12 +7628,12 @@ static u8 sony_pic_call1(u8 dev)
 {
 	u8 v1, v2;
 
-	wait_on_command(inb_p(spic_dev.cur_ioport->io1.minimum + 4) & 2,
+	wait_on_command(sony_inb(spic_dev.cur_ioport->io1.minimum + 4) & 2,
 			ITERATIONS_LONG);
-	outb(dev, spic_dev.cur_ioport->io1.minimum + 4);
-	v1 = inb_p(spic_dev.cur_ioport->io1.minimum + 4);
-	v2 = inb_p(spic_dev.cur_ioport->io1.minimum);
-	dprintk("sony_pic_call1(0x%.2x): 0x%.4x\n", dev, (v2 << 8) | v1);
+	sony_outb(dev, spic_dev.cur_ioport->io1.minimum + 4);
+	v1 = sony_inb(spic_dev.cur_ioport->io1.minimum + 4);
+	v2 = sony_inb(spic_dev.cur_ioport->io1.minimum);
+	trace_sony_pic_call(1, dev, 0, 0, (v2 << 8) | v1);
 	return v2;
 }
 
@@ -5035,14 +7641,14 @@ static u8 sony_pic_call2(u8 dev, u8 fn)
 {
 	u8 v1;
 
-	wait_on_command(inb_p(spic_dev.cur_ioport->io1.minimum + 4) & 2,
+	wait_on_command(sony_inb(spic_dev.cur_ioport->io1.minimum + 4) & 2,
 			ITERATIONS_LONG);
-	outb(dev, spic_dev.cur_ioport->io1.minimum + 4);
-	wait_on_command(inb_p(spic_dev.cur_ioport->io1.minimum + 4) & 2,
+	sony_outb(dev, spic_dev.cur_ioport->io1.minimum + 4);
+	wait_on_command(sony_inb(spic_dev.cur_ioport->io1.minimum + 4) & 2,
 			ITERATIONS_LONG);
-	outb(fn, spic_dev.cur_ioport->io1.minimum);
-	v1 = inb_p(spic_dev.cur_ioport->io1.minimum);
-	dprintk("sony_pic_call2(0x%.2x - 0x%.2x): 0x%.4x\n", dev, fn, v1);
+	sony_outb(fn, spic_dev.cur_ioport->io1.minimum);
+	v1 = sony_inb(spic_dev.cur_ioport->io1.minimum);
+	trace_sony_pic_call(2, dev, fn, 0, v1);
 	return v1;
 }
 
@@ -5050,18 +7656,17 @@ static u8 sony_pic_call3(u8 dev, u8 fn, u8 v)
 {
 	u8 v1;
 
-	wait_on_command(inb_p(spic_dev.cur_ioport->io1.minimum + 4) & 2,
+	wait_on_command(sony_inb(spic_dev.cur_ioport->io1.minimum + 4) & 2,
 			ITERATIONS_LONG);
-	outb(dev, spic_dev.cur_ioport->io1.minimum + 4);
-	wait_on_command(inb_p(spic_dev.cur_ioport->io1.minimum + 4) & 2,
+	sony_outb(dev, spic_dev.cur_ioport->io1.minimum + 4);
+	wait_on_command(sony_inb(spic_dev.cur_ioport->io1.minimum + 4) & 2,
 			ITERATIONS_LONG);
-	outb(fn, spic_dev.cur_ioport->io1.minimum);
-	wait_on_command(inb_p(spic_dev.cur_ioport->io1.minimum + 4) & 2,
+	sony_outb(fn, spic_dev.cur_ioport->io1.minimum);
+	wait_on_command(sony_inb(spic_dev.cur_ioport->io1.minimum + 4) & 2,
 			ITERATIONS_LONG);
-	outb(v, spic_dev.cur_ioport->io1.minimum);
-	v1 = inb_p(spic_dev.cur_ioport->io1.minimum);
-	dprintk("sony_pic_call3(0x%.2x - 0x%.2x - 0x%.2x): 0x%.4x\n",
-			dev, fn, v, v1);
+	sony_outb(v, spic_dev.cur_ioport->io1.minimum);
+	v1 = sony_inb(spic_dev.cur_ioport->io1.minimum);
+	trace_sony_pic_call(3, dev, fn, v, v1);
 	return v1;
 }
 
@@ -5386,12 +7991,12 @@ static ssize_t sony_pic_bluetoothpower_show(struct device *dev,
 #define SONY_PIC_FAN0_STATUS	0x93
 static int sony_pic_set_fanspeed(unsigned long value)
 {
-	return ec_write(SONY_PIC_FAN0_STATUS, value);
+	return sony_ec_write(SONY_PIC_FAN0_STATUS, value);
 }
 
 static int sony_pic_get_fanspeed(u8 *value)
 {
-	return ec_read(SONY_PIC_FAN0_STATUS, value);
+	return sony_ec_read(SONY_PIC_FAN0_STATUS, value);
 }
 
 static ssize_t sony_pic_fanspeed_store(struct device *dev,
@@ -5459,17 +8064,89 @@ static struct attribute_group spic_attribute_group = {
 #define SONYPI_BAT2_FULL	0xba
 #define SONYPI_TEMP_STATUS	0xC1
 
+/*
+ * Timestamped event records, an opt-in alternative to the legacy byte
+ * stream selected per file with SONYPI_IOCSRECFMT.  These are private to
+ * this driver and not part of the original sonypi interface.
+ */
+#define SONYPI_RECFMT_BYTE	0
+#define SONYPI_RECFMT_RECORD	1
+#define SONYPI_IOCGRECFMT	_IOR('v', 0x40, __u8)
+#define SONYPI_IOCSRECFMT	_IOW('v', 0x41, __u8)
+
+struct sonypi_compat_record {
+	__u64	time;		/* monotonic entry time, ns */
+	__u8	event;
+	__u8	reserved[7];
+};
+
+/* what both fifos hold, formatted for each reader by its recfmt */
+struct sonypi_compat_entry {
+	u64	time;		/* monotonic entry time, ns */
+	u16	source;
+	u8	event;
+};
+
 struct sonypi_compat_s {
 	struct fasync_struct	*fifo_async;
 	struct kfifo		fifo;
+	struct kfifo		rec_fifo;
 	spinlock_t		fifo_lock;
+	struct mutex		read_lock;
 	wait_queue_head_t	fifo_proc_list;
 	atomic_t		open_count;
+	atomic_t		rec_users;
+	u8			last;		/* last queued events */
+	u8			rec_last;
 };
 static struct sonypi_compat_s sonypi_compat = {
 	.open_count = ATOMIC_INIT(0),
+	.rec_users = ATOMIC_INIT(0),
 };
 
+/* read unlocked by poll and the waiting readers, set under read_lock */
+static inline int sonypi_misc_recfmt(struct file *file)
+{
+	return (unsigned long) ACCESS_ONCE(file->private_data);
+}
+
+static inline struct kfifo *sonypi_compat_fifo(int fmt)
+{
+	if (fmt == SONYPI_RECFMT_RECORD)
+		return &sonypi_compat.rec_fifo;
+	return &sonypi_compat.fifo;
+}
+
+static inline struct kfifo *sonypi_misc_fifo(struct file *file)
+{
+	return sonypi_compat_fifo(sonypi_misc_recfmt(file));
+}
+
+static int sonypi_misc_set_recfmt(struct file *file, int fmt)
+{
+	unsigned long flags;
+
+	if (fmt != SONYPI_RECFMT_BYTE && fmt != SONYPI_RECFMT_RECORD)
+		return -EINVAL;
+	if (fmt == sonypi_misc_recfmt(file))
+		return 0;
+
+	mutex_lock(&sonypi_compat.read_lock);
+	if (fmt == SONYPI_RECFMT_RECORD) {
+		/* records are only queued while someone wants them */
+		spin_lock_irqsave(&sonypi_compat.fifo_lock, flags);
+		if (atomic_inc_return(&sonypi_compat.rec_users) == 1)
+			kfifo_reset(&sonypi_compat.rec_fifo);
+		spin_unlock_irqrestore(&sonypi_compat.fifo_lock, flags);
+	} else {
+		atomic_dec(&sonypi_compat.rec_users);
+	}
+	ACCESS_ONCE(file->private_data) = (void *)(unsigned long) fmt;
+	mutex_unlock(&sonypi_compat.read_lock);
+
+	return 0;
+}
+
 static int sonypi_misc_fasync(int fd, struct file *filp, int on)
 {
 	return fasync_helper(fd, filp, on, &sonypi_compat.fifo_async);
@@ -5477,6 +8154,7 @@ static int sonypi_misc_fasync(int fd, struct file *filp, int on)
 
 static int sonypi_misc_release(struct inode *inode, struct file *file)
 {
+	sonypi_misc_set_recfmt(file, SONYPI_RECFMT_BYTE);
 	atomic_dec(&sonypi_compat.open_count);
 	return 0;
 }
@@ -5493,35 +8171,110 @@ static int sonypi_misc_open(struct inode *inode, struct file *file)
 
 	spin_unlock_irqrestore(&sonypi_compat.fifo_lock, flags);
 
+	file->private_data = (void *)(unsigned long) SONYPI_RECFMT_BYTE;
+
 	return 0;
 }
 
+/* the byte or record format of n entries, returns its length */
+static size_t sonypi_misc_format(int fmt, void *out,
+		const struct sonypi_compat_entry *entries, unsigned int n)
+{
+	struct sonypi_compat_record *rec = out;
+	u8 *byte = out;
+	unsigned int i;
+
+	if (fmt != SONYPI_RECFMT_RECORD) {
+		for (i = 0; i < n; i++)
+			byte[i] = entries[i].event;
+		return n;
+	}
+
+	memset(rec, 0, n * sizeof(*rec));
+	for (i = 0; i < n; i++) {
+		rec[i].time = entries[i].time;
+		rec[i].event = entries[i].event;
+	}
+	return n * sizeof(*rec);
+}
+
+#define SONYPI_READ_BATCH	8	/* entries per copy to the reader */
+
 static ssize_t sonypi_misc_read(struct file *file, char __user *buf,
 				size_t count, loff_t *pos)
 {
-	ssize_t ret;
-	unsigned char c;
+	struct sonypi_compat_entry entries[SONYPI_READ_BATCH];
+	struct sonypi_compat_record out[SONYPI_READ_BATCH];
+	struct kfifo *fifo;
+	size_t unit, len;
+	ssize_t copied = 0;
+	unsigned int i, n;
+	int fmt, ret = 0;
+
+	/*
+	 * SONYPI_IOCSRECFMT changes the format under read_lock, it is
+	 * sampled once with read_lock held and stays for the whole copy.
+	 */
+	for (;;) {
+		mutex_lock(&sonypi_compat.read_lock);
+		fmt = sonypi_misc_recfmt(file);
+		fifo = sonypi_compat_fifo(fmt);
+		unit = 1;
+
+		/* records are only ever handed out whole */
+		if (fmt == SONYPI_RECFMT_RECORD) {
+			unit = sizeof(struct sonypi_compat_record);
+			if (count < unit) {
+				ret = -EINVAL;
+				goto out_unlock;
+			}
+		}
 
-	if ((kfifo_len(&sonypi_compat.fifo) == 0) &&
-	    (file->f_flags & O_NONBLOCK))
-		return -EAGAIN;
+		if (kfifo_len(fifo))
+			break;
+		mutex_unlock(&sonypi_compat.read_lock);
 
-	ret = wait_event_interruptible(sonypi_compat.fifo_proc_list,
-				       kfifo_len(&sonypi_compat.fifo) != 0);
-	if (ret)
-		return ret;
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
 
-	while (ret < count &&
-	       (kfifo_out_locked(&sonypi_compat.fifo, &c, sizeof(c),
-			  &sonypi_compat.fifo_lock) == sizeof(c))) {
-		if (put_user(c, buf++))
-			return -EFAULT;
-		ret++;
+		ret = wait_event_interruptible(sonypi_compat.fifo_proc_list,
+				kfifo_len(sonypi_misc_fifo(file)) != 0);
+		if (ret)
+			return ret;
+	}
+
+	/*
+	 * Entries leave the fifo whole under fifo_lock, so the event path
+	 * can drop the oldest one at any time, and are copied to the
+	 * reader from the stack.  read_lock keeps the readers in order.
+	 */
+	while (count - copied >= unit) {
+		n = min_t(size_t, (count - copied) / unit, SONYPI_READ_BATCH);
+		n = kfifo_out_spinlocked(fifo, entries, n * sizeof(entries[0]),
+				&sonypi_compat.fifo_lock) / sizeof(entries[0]);
+		if (!n)
+			break;
+
+		len = sonypi_misc_format(fmt, out, entries, n);
+		if (copy_to_user(buf + copied, out, len)) {
+			ret = -EFAULT;
+			break;
+		}
+		copied += len;
+
+		for (i = 0; i < n; i++)
+			sony_event_delivered(entries[i].source,
+					entries[i].event,
+					ns_to_ktime(entries[i].time));
 	}
+out_unlock:
+	mutex_unlock(&sonypi_compat.read_lock);
 
-	if (ret > 0) {
+	if (copied > 0) {
 		struct inode *inode = file->f_path.dentry->d_inode;
+
 		inode->i_atime = current_fs_time(inode->i_sb);
+		return copied;
 	}
 
 	return ret;
@@ -5530,7 +8283,7 @@ static ssize_t sonypi_misc_read(struct file *file, char __user *buf,
 static unsigned int sonypi_misc_poll(struct file *file, poll_table *wait)
 {
 	poll_wait(file, &sonypi_compat.fifo_proc_list, wait);
-	if (kfifo_len(&sonypi_compat.fifo))
+	if (kfifo_len(sonypi_misc_fifo(file)))
 		return POLLIN | POLLRDNORM;
 	return 0;
 }
@@ -5538,9 +8291,9 @@ static unsigned int sonypi_misc_poll(struct file *file, poll_table *wait)
 static int ec_read16(u8 addr, u16 *value)
 {
 	u8 val_lb, val_hb;
-	if (ec_read(addr, &val_lb))
+	if (sony_ec_read(addr, &val_lb))
 		return -1;
-	if (ec_read(addr + 1, &val_hb))
+	if (sony_ec_read(addr + 1, &val_hb))
 		return -1;
 	*value = val_lb | (val_hb << 8);
 	return 0;
@@ -5555,6 +8308,19 @@ static long sonypi_misc_ioctl(struct file *fp, unsigned int cmd,
 	u16 val16;
 	unsigned int value;
 
+	/* event format, unrelated to the SPIC state */
+	switch (cmd) {
+	case SONYPI_IOCGRECFMT:
+		val8 = sonypi_misc_recfmt(fp);
+		if (copy_to_user(argp, &val8, sizeof(val8)))
+			return -EFAULT;
+		return 0;
+	case SONYPI_IOCSRECFMT:
+		if (copy_from_user(&val8, argp, sizeof(val8)))
+			return -EFAULT;
+		return sonypi_misc_set_recfmt(fp, val8);
+	}
+
 	mutex_lock(&spic_dev.lock);
 	switch (cmd) {
 	case SONYPI_IOCGBRT:
@@ -5562,7 +8328,7 @@ static long sonypi_misc_ioctl(struct file *fp, unsigned int cmd,
 			ret = -EIO;
 			break;
 		}
-		if (acpi_callgetfunc(sony_nc_acpi_handle, "GBRT", &value)) {
+		if (sony_nc_method_get(SNC_GBRT, &value)) {
 			ret = -EIO;
 			break;
 		}
@@ -5579,8 +8345,7 @@ static long sonypi_misc_ioctl(struct file *fp, unsigned int cmd,
 			ret = -EFAULT;
 			break;
 		}
-		if (acpi_callsetfunc(sony_nc_acpi_handle, "SBRT",
-				(val8 >> 5) + 1, NULL)) {
+		if (sony_nc_method_set(SNC_SBRT, (val8 >> 5) + 1, NULL)) {
 			ret = -EIO;
 			break;
 		}
@@ -5621,7 +8386,7 @@ static long sonypi_misc_ioctl(struct file *fp, unsigned int cmd,
 			ret = -EFAULT;
 		break;
 	case SONYPI_IOCGBATFLAGS:
-		if (ec_read(SONYPI_BAT_FLAGS, &val8)) {
+		if (sony_ec_read(SONYPI_BAT_FLAGS, &val8)) {
 			ret = -EIO;
 			break;
 		}
@@ -5660,7 +8425,7 @@ static long sonypi_misc_ioctl(struct file *fp, unsigned int cmd,
 		break;
 	/* GET Temperature (useful under APM) */
 	case SONYPI_IOCGTEMP:
-		if (ec_read(SONYPI_TEMP_STATUS, &val8)) {
+		if (sony_ec_read(SONYPI_TEMP_STATUS, &val8)) {
 			ret = -EIO;
 			break;
 		}
@@ -5691,21 +8456,141 @@ static struct miscdevice sonypi_misc_device = {
 	.fops		= &sonypi_misc_fops,
 };
 
-static void sonypi_compat_report_event(u8 event)
+/*
+ * queue an entry following the overflow policy, fifo_lock held.  The
+ * readers only dequeue under fifo_lock, the oldest can always be dropped.
+ */
+static void sonypi_compat_queue(enum sony_event_fifo id, struct kfifo *fifo,
+		const struct sonypi_compat_entry *entry, u8 *last)
+{
+	struct sonypi_compat_entry old;
+	bool dropped = false;
+
+	if (kfifo_avail(fifo) < sizeof(*entry)) {
+		switch (ACCESS_ONCE(fifo_overflow)) {
+		case SONY_OVERFLOW_COALESCE:
+			if (*last == entry->event) {
+				sony_event_fifo_coalesced(id);
+				return;
+			}
+			break;
+		case SONY_OVERFLOW_DROP_OLDEST:
+			dropped = kfifo_out(fifo, &old, sizeof(old)) ==
+				sizeof(old);
+			break;
+		}
+	}
+
+	/* never queue a partial entry */
+	if (kfifo_avail(fifo) < sizeof(*entry)) {
+		sony_event_fifo_account(id, fifo, true);
+		return;
+	}
+
+	kfifo_in(fifo, entry, sizeof(*entry));
+	*last = entry->event;
+	sony_event_fifo_account(id, fifo, dropped);
+}
+
+static void sonypi_compat_report_event(struct sony_event_stamp *st)
 {
-	kfifo_in_locked(&sonypi_compat.fifo, (unsigned char *)&event,
-			sizeof(event), &sonypi_compat.fifo_lock);
+	struct sonypi_compat_entry entry = {
+		.time = ktime_to_ns(st->start),
+		.source = st->source,
+		.event = st->code,
+	};
+	unsigned long flags;
+
+	spin_lock_irqsave(&sonypi_compat.fifo_lock, flags);
+	sonypi_compat_queue(SONY_FIFO_COMPAT, &sonypi_compat.fifo, &entry,
+			&sonypi_compat.last);
+	if (atomic_read(&sonypi_compat.rec_users))
+		sonypi_compat_queue(SONY_FIFO_COMPAT_RECORD,
+				&sonypi_compat.rec_fifo, &entry,
+				&sonypi_compat.rec_last);
+	spin_unlock_irqrestore(&sonypi_compat.fifo_lock, flags);
+
 	kill_fasync(&sonypi_compat.fifo_async, SIGIO, POLL_IN);
 	wake_up_interruptible(&sonypi_compat.fifo_proc_list);
 }
 
+static int sonypi_compat_alloc(struct kfifo *fifo, struct kfifo *rec_fifo,
+		unsigned int size)
+{
+	int error;
+
+	error = kfifo_alloc(fifo, size * sizeof(struct sonypi_compat_entry),
+			GFP_KERNEL);
+	if (error)
+		return error;
+
+	error = kfifo_alloc(rec_fifo, size *
+			sizeof(struct sonypi_compat_entry), GFP_KERNEL);
+	if (error)
+		kfifo_free(fifo);
+
+	return error;
+}
+
+/* swap in fifos of the new size, only while nobody has the device open */
+static int sonypi_compat_resize(const char *val,
+		const struct kernel_param *kp)
+{
+	struct kfifo fifo, rec_fifo, old, rec_old;
+	unsigned long flags, size;
+	int ret;
+
+	ret = strict_strtoul(val, 10, &size);
+	if (ret)
+		return ret;
+	if (!size || size > SONY_LAPTOP_FIFO_MAX)
+		return -EINVAL;
+
+	mutex_lock(&sony_laptop_fifo_mutex);
+	/* not in use yet, the value is used at allocation */
+	if (!kfifo_initialized(&sonypi_compat.fifo))
+		goto out;
+
+	ret = sonypi_compat_alloc(&fifo, &rec_fifo, size);
+	if (ret)
+		goto out_unlock;
+
+	mutex_lock(&sonypi_compat.read_lock);
+	spin_lock_irqsave(&sonypi_compat.fifo_lock, flags);
+	if (atomic_read(&sonypi_compat.open_count)) {
+		spin_unlock_irqrestore(&sonypi_compat.fifo_lock, flags);
+		mutex_unlock(&sonypi_compat.read_lock);
+		kfifo_free(&fifo);
+		kfifo_free(&rec_fifo);
+		ret = -EBUSY;
+		goto out_unlock;
+	}
+	old = sonypi_compat.fifo;
+	rec_old = sonypi_compat.rec_fifo;
+	sonypi_compat.fifo = fifo;
+	sonypi_compat.rec_fifo = rec_fifo;
+	spin_unlock_irqrestore(&sonypi_compat.fifo_lock, flags);
+	mutex_unlock(&sonypi_compat.read_lock);
+	kfifo_free(&old);
+	kfifo_free(&rec_old);
+
+out:
+	compat_fifo_size = size;
+out_unlock:
+	mutex_unlock(&sony_laptop_fifo_mutex);
+	return ret;
+}
+
 static int sonypi_compat_init(void)
 {
 	int error;
 
 	spin_lock_init(&sonypi_compat.fifo_lock);
-	error =
-	 kfifo_alloc(&sonypi_compat.fifo, SONY_LAPTOP_BUF_SIZE, GFP_KERNEL);
+	mutex_init(&sonypi_compat.read_lock);
+	mutex_lock(&sony_laptop_fifo_mutex);
+	error = sonypi_compat_alloc(&sonypi_compat.fifo,
+			&sonypi_compat.rec_fifo, compat_fifo_size);
+	mutex_unlock(&sony_laptop_fifo_mutex);
 	if (error) {
 		pr_err("kfifo_alloc failed\n");
 		return error;
@@ -5727,19 +8612,25 @@ static int sonypi_compat_init(void)
 	return 0;
 
 err_free_kfifo:
+	mutex_lock(&sony_laptop_fifo_mutex);
+	kfifo_free(&sonypi_compat.rec_fifo);
 	kfifo_free(&sonypi_compat.fifo);
+	mutex_unlock(&sony_laptop_fifo_mutex);
 	return error;
 }
 
 static void sonypi_compat_exit(void)
 {
 	misc_deregister(&sonypi_misc_device);
+	mutex_lock(&sony_laptop_fifo_mutex);
+	kfifo_free(&sonypi_compat.rec_fifo);
 	kfifo_free(&sonypi_compat.fifo);
+	mutex_unlock(&sony_laptop_fifo_mutex);
 }
 #else
 static int sonypi_compat_init(void) { return 0; }
 static void sonypi_compat_exit(void) { }
-static void sonypi_compat_report_event(u8 event) { }
+static void sonypi_compat_report_event(struct sony_event_stamp *st) { }
 #endif /* CONFIG_SONYPI_COMPAT */
 
 /*
@@ -5879,8 +8770,8 @@ end:
  */
 static int sony_pic_disable(struct acpi_device *device)
 {
-	acpi_status ret = acpi_evaluate_object(device->handle, "_DIS", NULL,
-					       NULL);
+	acpi_status ret = sony_acpi_evaluate(device->handle, "_DIS", NULL,
+					     NULL);
 
 	if (ACPI_FAILURE(ret) && ret != AE_NOT_FOUND)
 		return -ENXIO;
@@ -6000,64 +8891,87 @@ end:
  * ISR: some event is available
  *
  *****************/
+/*
+ * hard irq handler: read (and so acknowledge) the event, the line stays
+ * masked until the thread below has handled it
+ */
 static irqreturn_t sony_pic_irq(int irq, void *dev_id)
 {
-	int i, j;
 	u8 ev = 0;
 	u8 data_mask = 0;
-	u8 device_event = 0;
+	ktime_t stamp = ktime_get();
 
 	struct sony_pic_dev *dev = (struct sony_pic_dev *) dev_id;
 
-	ev = inb_p(dev->cur_ioport->io1.minimum);
+	ev = sony_inb(dev->cur_ioport->io1.minimum);
 	if (dev->cur_ioport->io2.minimum)
-		data_mask = inb_p(dev->cur_ioport->io2.minimum);
+		data_mask = sony_inb(dev->cur_ioport->io2.minimum);
 	else
-		data_mask = inb_p(dev->cur_ioport->io1.minimum +
+		data_mask = sony_inb(dev->cur_ioport->io1.minimum +
 				dev->evport_offset);
 
-	dprintk("event ([%.2x] [%.2x]) at port 0x%.4x(+0x%.2x)\n",
-			ev, data_mask, dev->cur_ioport->io1.minimum,
-			dev->evport_offset);
-
-	if (ev == 0x00 || ev == 0xff)
+	if (ev == 0x00 || ev == 0xff) {
+		trace_sony_pic_irq(ev, data_mask,
+				dev->cur_ioport->io1.minimum, 0);
 		return IRQ_HANDLED;
+	}
 
-	for (i = 0; dev->event_types[i].mask; i++) {
+	dev->irq_ev = ev;
+	dev->irq_data_mask = data_mask;
+	dev->irq_stamp = stamp;
 
-		if ((data_mask & dev->event_types[i].data) !=
-		    dev->event_types[i].data)
-			continue;
+	return IRQ_WAKE_THREAD;
+}
 
-		if (!(mask & dev->event_types[i].mask))
-			continue;
+static irqreturn_t sony_pic_irq_thread(int irq, void *dev_id)
+{
+	struct sony_pic_dev *dev = (struct sony_pic_dev *) dev_id;
+	struct sony_pic_decode *decode;
+	u8 ev = dev->irq_ev;
+	u8 data_mask = dev->irq_data_mask;
+	u8 device_event = 0;
+	struct sony_event_stamp st = {
+		.source = SONY_EVENT_SRC_SPIC,
+		.start = dev->irq_stamp,
+	};
 
-		for (j = 0; dev->event_types[i].events[j].event; j++) {
-			if (ev == dev->event_types[i].events[j].data) {
-				device_event =
-					dev->event_types[i].events[j].event;
-				/* some events may require ignoring */
-				if (!device_event)
-					return IRQ_HANDLED;
-				goto found;
-			}
-		}
+	rcu_read_lock();
+	decode = rcu_dereference(dev->decode);
+	if (decode)
+		device_event = decode->events[decode->class[data_mask]][ev];
+	rcu_read_unlock();
+
+	if (device_event) {
+		trace_sony_pic_irq(ev, data_mask,
+				dev->cur_ioport->io1.minimum, device_event);
+		goto found;
 	}
+
 	/* Still not able to decode the event try to pass
 	 * it over to the minidriver
 	 */
+	trace_sony_pic_irq(ev, data_mask, dev->cur_ioport->io1.minimum, 0);
 	if (dev->handle_irq && dev->handle_irq(data_mask, ev) == 0)
 		return IRQ_HANDLED;
 
+	sony_event_count_unknown(SONY_EVENT_SRC_SPIC);
+
 	dprintk("unknown event ([%.2x] [%.2x]) at port 0x%.4x(+0x%.2x)\n",
 			ev, data_mask, dev->cur_ioport->io1.minimum,
 			dev->evport_offset);
 	return IRQ_HANDLED;
 
 found:
+	sony_event_count(SONY_EVENT_SRC_SPIC, device_event);
+	st.code = device_event;
+	sony_event_stamp(&st, SONY_EVENT_DECODE);
+	sony_event_ring_put(&st, (data_mask << 8) | ev);
 	sony_laptop_report_input_event(device_event);
+	sony_event_stamp(&st, SONY_EVENT_INPUT);
 	acpi_bus_generate_proc_event(dev->acpi_dev, 1, device_event);
-	sonypi_compat_report_event(device_event);
+	sonypi_compat_report_event(&st);
+	sony_event_stamp(&st, SONY_EVENT_QUEUE);
+	sony_event_stamp_done(&st);
 	return IRQ_HANDLED;
 }
 
@@ -6102,6 +9016,10 @@ static int sony_pic_remove(struct acpi_device *device, int type)
 	spic_dev.cur_ioport = NULL;
 	spic_dev.cur_irq = NULL;
 
+	mutex_lock(&sony_pic_decode_lock);
+	__sony_pic_decode_update(NULL);
+	mutex_unlock(&sony_pic_decode_lock);
+
 	dprintk(SONY_PIC_DRIVER_NAME " removed.\n");
 	return 0;
 }
@@ -6119,6 +9037,14 @@ static int sony_pic_add(struct acpi_device *device)
 	sony_pic_detect_device_type(&spic_dev);
 	mutex_init(&spic_dev.lock);
 
+	mutex_lock(&sony_pic_decode_lock);
+	result = __sony_pic_decode_update(spic_dev.event_types);
+	mutex_unlock(&sony_pic_decode_lock);
+	if (result) {
+		pr_err("Unable to build the event decoding table\n");
+		return result;
+	}
+
 	/* read _PRS resources */
 	result = sony_pic_possible_resources(device);
 	if (result) {
@@ -6179,8 +9105,9 @@ static int sony_pic_add(struct acpi_device *device)
 
 	/* request IRQ */
 	list_for_each_entry_reverse(irq, &spic_dev.interrupts, list) {
-		if (!request_irq(irq->irq.interrupts[0], sony_pic_irq,
-				IRQF_DISABLED, "sony-laptop", &spic_dev)) {
+		if (!request_threaded_irq(irq->irq.interrupts[0],
+				sony_pic_irq, sony_pic_irq_thread,
+				IRQF_ONESHOT, "sony-laptop", &spic_dev)) {
 			dprintk("IRQ: %d - triggering: %d - "
 					"polarity: %d - shr: %d\n",
 					irq->irq.interrupts[0],
@@ -6251,6 +9178,10 @@ err_free_resources:
 	spic_dev.cur_ioport = NULL;
 	spic_dev.cur_irq = NULL;
 
+	mutex_lock(&sony_pic_decode_lock);
+	__sony_pic_decode_update(NULL);
+	mutex_unlock(&sony_pic_decode_lock);
+
 	return result;
 }
 
@@ -6263,7 +9194,10 @@ static int sony_pic_suspend(struct acpi_device *device, pm_message_t state)
 
 static int sony_pic_resume(struct acpi_device *device)
 {
+	ktime_t start = ktime_get();
+
 	sony_pic_enable(device, spic_dev.cur_ioport, spic_dev.cur_irq);
+	sony_resume_step("SPIC", 0, start);
 	return 0;
 }
 
@@ -6307,6 +9241,13 @@ static int __init sony_laptop_init(void)
 {
 	int result;
 
+	/* nothing to wait for until the first resume */
+	complete_all(&sony_nc_resume_done);
+
+	/* optional, the events still reach the other interfaces */
+	if (sony_event_ring_setup())
+		pr_warn("event ring not available\n");
+
 	if (!no_spic && dmi_check_system(sonypi_dmi_table)) {
 		result = acpi_bus_register_driver(&sony_pic_driver);
 		if (result) {
@@ -6322,20 +9263,25 @@ static int __init sony_laptop_init(void)
 		goto out_unregister_pic;
 	}
 
+	sony_laptop_debugfs_setup();
+
 	return 0;
 
 out_unregister_pic:
 	if (spic_drv_registered)
 		acpi_bus_unregister_driver(&sony_pic_driver);
 out:
+	sony_event_ring_cleanup();
 	return result;
 }
 
 static void __exit sony_laptop_exit(void)
 {
+	sony_laptop_debugfs_cleanup();
 	acpi_bus_unregister_driver(&sony_nc_driver);
 	if (spic_drv_registered)
 		acpi_bus_unregister_driver(&sony_pic_driver);
+	sony_event_ring_cleanup();
 }
 
 module_init(sony_laptop_init);
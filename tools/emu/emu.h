@@ -0,0 +1,76 @@
+/*
+ * Harness side of the userspace kernel: the tables kept by kernel.c
+ * for the sysfs and debugfs files, the input and ACPI events, the
+ * driver bindings and the module parameters.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef _EMU_H
+#define _EMU_H
+
+#include <linux/kernel.h>
+#include <linux/acpi.h>
+
+extern int emu_verbose;
+extern bool emu_trace_enabled;
+
+/* live kmalloc/vmalloc allocations, 0 once everything has been freed */
+long emu_allocations(void);
+
+int emu_param_set(const char *name, const char *value);
+int emu_param_get(const char *name, char *buffer);
+
+/* sysfs attributes, by name, of all the devices */
+struct device_attribute *emu_sysfs_find(const char *name,
+		struct device **dev);
+ssize_t emu_sysfs_show(const char *name, char *buffer);
+ssize_t emu_sysfs_store(const char *name, const char *buffer, size_t count);
+unsigned int emu_sysfs_list(const char **names, unsigned int max);
+unsigned long emu_sysfs_notified(const char *name);
+
+/* debugfs files, read or written through their file operations */
+ssize_t emu_debugfs_read(const char *name, char *buffer, size_t size);
+ssize_t emu_debugfs_write(const char *name, const char *buffer,
+		size_t count);
+
+/* input events reported by the driver, consumed by the checks */
+struct emu_input_event {
+	const char *dev;
+	unsigned int type;
+	unsigned int code;
+	int value;
+};
+int emu_input_take(unsigned int type, unsigned int code, int value);
+unsigned int emu_input_pending(void);
+void emu_input_flush(void);
+
+/* ACPI events generated by the driver */
+int emu_acpi_event_take(u8 type, int data);
+void emu_acpi_event_flush(void);
+
+/* the SNC device, bound when the driver registers */
+void emu_acpi_notify(u32 event);
+int emu_acpi_bound(const char *hid);
+int emu_suspend(void);
+int emu_resume(void);
+
+/* misc devices */
+const struct file_operations *emu_misc_find(const char *name);
+
+/* backlight and rfkill state */
+struct backlight_device *emu_backlight(void);
+int emu_rfkill_state(const char *name, bool *sw, bool *hw);
+
+/* flush the work queues and wait for the timers due by now */
+void emu_settle(void);
+/* a module load, as do_init_module() */
+int emu_module_init(int (*init)(void));
+
+/* 1 to bind the SPIC driver, 0 by default */
+extern int emu_dmi_match;
+extern int emu_video_backlight;
+
+#endif /* _EMU_H */
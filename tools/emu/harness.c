@@ -0,0 +1,623 @@
+/*
+ * sony-laptop.c in userspace: the driver runs against the SNC emulator
+ * and a scenario script drives and checks it, see README.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#include "../../sony-laptop.c"
+
+#include <unistd.h>
+
+#include "emu.h"
+#include "snc-emu.h"
+
+static const struct sony_laptop_backend snc_emu_backend = {
+	.evaluate = snc_emu_evaluate,
+	.ec_read = snc_emu_ec_read,
+	.ec_write = snc_emu_ec_write,
+	.inb = snc_emu_inb,
+	.outb = snc_emu_outb,
+};
+
+#define MAX_ARGS	96
+
+static const char *script;
+static unsigned int lineno;
+static bool loaded;
+/* the module state is not reset, it can be loaded once per script */
+static bool probed;
+
+static void fail(const char *fmt, ...)
+{
+	va_list ap;
+
+	fprintf(stderr, "%s:%u: ", script, lineno);
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+	fputc('\n', stderr);
+	exit(1);
+}
+
+static const struct {
+	const char *name;
+	int err;
+} errnos[] = {
+	{ "-EINVAL", -EINVAL },
+	{ "-EIO", -EIO },
+	{ "-ENODEV", -ENODEV },
+	{ "-ENOENT", -ENOENT },
+	{ "-EACCES", -EACCES },
+	{ "-EBUSY", -EBUSY },
+	{ "-EEXIST", -EEXIST },
+	{ "-ENOMEM", -ENOMEM },
+	{ "-EAGAIN", -EAGAIN },
+};
+
+static int is_errno(const char *s, int *err)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(errnos); i++) {
+		if (!strcmp(errnos[i].name, s)) {
+			*err = errnos[i].err;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static const char *errno_name(int err)
+{
+	static char buf[16];
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(errnos); i++) {
+		if (errnos[i].err == err)
+			return errnos[i].name;
+	}
+	snprintf(buf, sizeof(buf), "%d", err);
+
+	return buf;
+}
+
+static unsigned long number(const char *s)
+{
+	unsigned long v;
+
+	if (strict_strtoul(s, 0, &v))
+		fail("bad number %s", s);
+
+	return v;
+}
+
+static void check_argc(int argc, int min, int max)
+{
+	if (argc < min || argc > max)
+		fail("wrong number of arguments");
+}
+
+/* the words of the output against the expected ones */
+static void check_words(const char *what, char *out, int argc, char **argv)
+{
+	char copy[PAGE_SIZE];
+	char *word, *save;
+	int i = 0;
+
+	strcpy(copy, out);
+	for (word = strtok_r(out, " \t\n", &save); word;
+			word = strtok_r(NULL, " \t\n", &save), i++) {
+		if (i == argc || strcmp(word, argv[i]))
+			break;
+	}
+	if (word || i != argc)
+		fail("%s: unexpected \"%.*s\"", what,
+				(int) strcspn(copy, "\n"), copy);
+}
+
+static void do_probe(int argc, char **argv)
+{
+	int expected = 0, ret;
+
+	check_argc(argc, 1, 2);
+	if (argc == 2 && !is_errno(argv[1], &expected))
+		fail("bad errno %s", argv[1]);
+
+	if (probed)
+		fail("already probed once");
+	probed = true;
+
+	ret = emu_module_init(sony_laptop_init);
+	if (ret != expected)
+		fail("probe returned %s", errno_name(ret));
+	loaded = !ret;
+}
+
+/*
+ * the sonypi compat device, opened without a SPIC device, the events
+ * are queued as sony_pic_irq_thread does
+ */
+static struct inode compat_inode;
+static struct dentry compat_dentry = { .d_inode = &compat_inode };
+static struct file compat_file = {
+	.f_path.dentry = &compat_dentry,
+};
+static bool compat_opened;
+
+/* a reader blocked in the background */
+static struct {
+	pthread_t thread;
+	size_t count;
+	ssize_t ret;
+	bool running;
+} compat_reader;
+
+static void compat_close(void)
+{
+	sonypi_misc_fops.release(&compat_inode, &compat_file);
+	sonypi_compat_exit();
+	compat_opened = false;
+}
+
+static void do_compat(int argc, char **argv)
+{
+	struct sony_event_stamp st = { .source = SONY_EVENT_SRC_SPIC };
+	u8 fmt;
+	int ret;
+
+	if (!strcmp(argv[0], "compat-open")) {
+		check_argc(argc, 1, 1);
+		if (compat_opened)
+			fail("already open");
+		ret = sonypi_compat_init();
+		if (!ret)
+			ret = sonypi_misc_fops.open(&compat_inode,
+					&compat_file);
+		if (ret)
+			fail("open: %s", errno_name(ret));
+		compat_opened = true;
+		return;
+	}
+
+	if (!compat_opened)
+		fail("not open");
+	if (!strcmp(argv[0], "compat-close")) {
+		check_argc(argc, 1, 1);
+		compat_close();
+	} else if (!strcmp(argv[0], "compat-event")) {
+		check_argc(argc, 2, 2);
+		st.code = number(argv[1]);
+		st.start = ktime_get();
+		sonypi_compat_report_event(&st);
+	} else if (!strcmp(argv[0], "compat-recfmt")) {
+		check_argc(argc, 2, 2);
+		fmt = number(argv[1]);
+		ret = sonypi_misc_fops.unlocked_ioctl(&compat_file,
+				SONYPI_IOCSRECFMT, (unsigned long) &fmt);
+		if (ret)
+			fail("SONYPI_IOCSRECFMT: %s", errno_name(ret));
+	} else {
+		fail("unknown command %s", argv[0]);
+	}
+}
+
+static void *compat_read_thread(void *arg)
+{
+	/* exactly count bytes, an overflow shows with the sanitizers */
+	char *buffer = malloc(compat_reader.count);
+
+	compat_reader.ret = sonypi_misc_fops.read(&compat_file, buffer,
+			compat_reader.count, NULL);
+	free(buffer);
+
+	return NULL;
+}
+
+static void compat_read_check(ssize_t ret, const char *expected)
+{
+	int err;
+
+	if (ret > (ssize_t) compat_reader.count)
+		fail("read %zd bytes into %zu", ret, compat_reader.count);
+	if (is_errno(expected, &err) ? ret != err : ret != number(expected))
+		fail("read returned %s", errno_name(ret));
+}
+
+/* compat-read COUNT LEN|ERRNO, without blocking */
+static void do_compat_read(int argc, char **argv)
+{
+	check_argc(argc, 3, 3);
+	if (!compat_opened || compat_reader.running)
+		fail("not open or a reader is blocked");
+
+	compat_reader.count = number(argv[1]);
+	compat_file.f_flags = O_NONBLOCK;
+	compat_read_thread(NULL);
+	compat_file.f_flags = 0;
+	compat_read_check(compat_reader.ret, argv[2]);
+}
+
+/* compat-read-start COUNT, then compat-read-wait LEN|ERRNO */
+static void do_compat_read_async(int argc, char **argv)
+{
+	if (!compat_opened)
+		fail("not open");
+
+	if (!strcmp(argv[0], "compat-read-start")) {
+		check_argc(argc, 2, 2);
+		if (compat_reader.running)
+			fail("a reader is already blocked");
+		compat_reader.count = number(argv[1]);
+		if (pthread_create(&compat_reader.thread, NULL,
+					compat_read_thread, NULL))
+			fail("pthread_create failed");
+		compat_reader.running = true;
+		return;
+	}
+
+	check_argc(argc, 2, 2);
+	if (!compat_reader.running)
+		fail("no reader");
+	pthread_join(compat_reader.thread, NULL);
+	compat_reader.running = false;
+	compat_read_check(compat_reader.ret, argv[1]);
+}
+
+/* the event ring, the consumer acknowledges records to its tail */
+static struct file ring_file;
+static bool ring_opened;
+
+static unsigned long ring_delivered(void)
+{
+	unsigned long n = 0;
+	unsigned int i, k;
+
+	for (i = 0; i < ARRAY_SIZE(sony_event_latency); i++)
+		for (k = 0; k < SONY_STATS_BUCKETS; k++)
+			n += sony_event_latency[i][SONY_EVENT_DELIVER][k];
+
+	return n;
+}
+
+static void do_ring(int argc, char **argv)
+{
+	u32 tail;
+	int ret, err;
+
+	if (!strcmp(argv[0], "ring-open")) {
+		check_argc(argc, 1, 1);
+		ret = sony_event_ring_fops.open(NULL, &ring_file);
+		if (ret)
+			fail("open: %s", errno_name(ret));
+		ring_opened = true;
+		return;
+	}
+
+	if (!ring_opened)
+		fail("not open");
+	if (!strcmp(argv[0], "ring-poll")) {
+		check_argc(argc, 2, 2);
+		ret = !!sony_event_ring_fops.poll(&ring_file, NULL);
+		if (ret != number(argv[1]))
+			fail("poll: %d", ret);
+	} else if (!strcmp(argv[0], "ring-ack")) {
+		/* ring-ack N [ERRNO], the tail moves by N records */
+		check_argc(argc, 2, 3);
+		tail = sony_event_ring_tail(&ring_file) + number(argv[1]);
+		ret = sony_event_ring_fops.unlocked_ioctl(&ring_file,
+				SONY_EVENT_IOCACK, (unsigned long) &tail);
+		err = 0;
+		if (argc == 3 && !is_errno(argv[2], &err))
+			fail("unknown errno %s", argv[2]);
+		if (ret != err)
+			fail("SONY_EVENT_IOCACK: %s", errno_name(ret));
+	} else if (!strcmp(argv[0], "ring-delivered")) {
+		check_argc(argc, 2, 2);
+		if (ring_delivered() != number(argv[1]))
+			fail("%lu events delivered", ring_delivered());
+	} else {
+		fail("unknown command %s", argv[0]);
+	}
+}
+
+static void do_remove(void)
+{
+	long live;
+
+	if (!loaded)
+		fail("not loaded");
+
+	if (compat_opened)
+		compat_close();
+	ring_opened = false;
+	sony_laptop_exit();
+	loaded = false;
+
+	live = emu_allocations();
+	if (live)
+		fail("%ld allocations left after the removal", live);
+}
+
+static void do_read(int argc, char **argv)
+{
+	char buffer[PAGE_SIZE];
+	ssize_t ret;
+	int err;
+
+	check_argc(argc, 2, MAX_ARGS);
+	ret = emu_sysfs_show(argv[1], buffer);
+	if (argc == 3 && is_errno(argv[2], &err)) {
+		if (ret != err)
+			fail("read %s returned %s", argv[1],
+					ret < 0 ? errno_name(ret) : buffer);
+		return;
+	}
+
+	if (ret < 0)
+		fail("read %s: %s", argv[1], errno_name(ret));
+	if (ret >= PAGE_SIZE || buffer[ret])
+		fail("read %s: bad length %zd", argv[1], ret);
+	if (argc > 2)
+		check_words(argv[1], buffer, argc - 2, argv + 2);
+}
+
+/* the read has to take between min and max milliseconds */
+static void do_read_time(int argc, char **argv)
+{
+	char buffer[PAGE_SIZE];
+	unsigned long min, max;
+	ktime_t start;
+	s64 ms;
+	ssize_t ret;
+
+	check_argc(argc, 4, 4);
+	min = number(argv[2]);
+	max = number(argv[3]);
+
+	start = ktime_get();
+	ret = emu_sysfs_show(argv[1], buffer);
+	ms = ktime_to_ns(ktime_sub(ktime_get(), start)) / 1000000;
+	if (ret < 0)
+		fail("read %s: %s", argv[1], errno_name(ret));
+	if (ms < min || ms > max)
+		fail("read %s took %lld ms", argv[1], (long long) ms);
+}
+
+/* the value is made of the words up to an optional errno */
+static void do_write(int argc, char **argv)
+{
+	char buffer[256] = "";
+	ssize_t ret;
+	int i, expected = 0;
+
+	check_argc(argc, 3, 16);
+	if (is_errno(argv[argc - 1], &expected))
+		argc--;
+	for (i = 2; i < argc; i++) {
+		strcat(buffer, argv[i]);
+		strcat(buffer, i == argc - 1 ? "\n" : " ");
+	}
+	if (!expected)
+		expected = strlen(buffer);
+
+	ret = emu_sysfs_store(argv[1], buffer, strlen(buffer));
+	if (ret != expected)
+		fail("write %s %s returned %s", argv[1], argv[2],
+				errno_name(ret));
+}
+
+static void do_debugfs(int argc, char **argv)
+{
+	char buffer[16 * PAGE_SIZE];
+	ssize_t ret;
+	int i;
+
+	check_argc(argc, 2, MAX_ARGS);
+	ret = emu_debugfs_read(argv[1], buffer, sizeof(buffer));
+	if (ret < 0)
+		fail("debugfs %s: %s", argv[1], errno_name(ret));
+
+	/* every further argument has to show up in the file */
+	for (i = 2; i < argc; i++) {
+		if (!strstr(buffer, argv[i]))
+			fail("debugfs %s: no \"%s\" in\n%s", argv[1], argv[i],
+					buffer);
+	}
+}
+
+static void do_register(int argc, char **argv)
+{
+	u32 value;
+
+	check_argc(argc, 4, 4);
+	if (snc_emu_register(number(argv[1]), number(argv[2]), &value))
+		fail("no register 0x%lx of handle %s", number(argv[2]),
+				argv[1]);
+	if (value != number(argv[3]))
+		fail("register 0x%lx of handle %s is 0x%x",
+				number(argv[2]), argv[1], value);
+}
+
+static void action(int argc, char **argv)
+{
+	char err[128];
+	const char *cmd = argv[0];
+	unsigned long n;
+	int ret;
+
+	if (!strcmp(cmd, "probe")) {
+		do_probe(argc, argv);
+	} else if (!strcmp(cmd, "remove")) {
+		check_argc(argc, 1, 1);
+		do_remove();
+	} else if (!strcmp(cmd, "sync")) {
+		check_argc(argc, 1, 1);
+		sony_nc_snc_sync();
+		emu_settle();
+	} else if (!strcmp(cmd, "read")) {
+		do_read(argc, argv);
+	} else if (!strcmp(cmd, "read-time")) {
+		do_read_time(argc, argv);
+	} else if (!strcmp(cmd, "write")) {
+		do_write(argc, argv);
+	} else if (!strcmp(cmd, "attr") || !strcmp(cmd, "noattr")) {
+		check_argc(argc, 2, 2);
+		if (!emu_sysfs_find(argv[1], NULL) != (cmd[0] == 'n'))
+			fail("%s %s", cmd[0] == 'n' ? "unexpected" : "no",
+					argv[1]);
+	} else if (!strcmp(cmd, "notified")) {
+		check_argc(argc, 3, 3);
+		n = emu_sysfs_notified(argv[1]);
+		if (n != number(argv[2]))
+			fail("%s notified %lu times", argv[1], n);
+	} else if (!strcmp(cmd, "notify")) {
+		check_argc(argc, 2, 2);
+		emu_acpi_notify(number(argv[1]));
+	} else if (!strcmp(cmd, "key")) {
+		check_argc(argc, 3, 3);
+		if (!emu_input_take(EV_KEY, number(argv[1]),
+					number(argv[2])))
+			fail("no key %s %s", argv[1], argv[2]);
+	} else if (!strcmp(cmd, "nokeys")) {
+		check_argc(argc, 1, 1);
+		if (emu_input_pending())
+			fail("%u unexpected input events",
+					emu_input_pending());
+	} else if (!strcmp(cmd, "acpi-event")) {
+		check_argc(argc, 3, 3);
+		if (!emu_acpi_event_take(number(argv[1]), number(argv[2])))
+			fail("no ACPI event %s %s", argv[1], argv[2]);
+	} else if (!strcmp(cmd, "calls")) {
+		check_argc(argc, 3, 3);
+		n = snc_emu_calls(argv[1]);
+		if (n != number(argv[2]))
+			fail("%s called %lu times", argv[1], n);
+	} else if (!strcmp(cmd, "unhandled")) {
+		check_argc(argc, 2, 2);
+		n = snc_emu_unhandled();
+		if (n != number(argv[1]))
+			fail("%lu unhandled calls", n);
+	} else if (!strcmp(cmd, "enabled")) {
+		check_argc(argc, 2, 2);
+		if (snc_emu_events() != number(argv[1]))
+			fail("events enabled: 0x%x", snc_emu_events());
+	} else if (!strcmp(cmd, "register")) {
+		do_register(argc, argv);
+	} else if (!strcmp(cmd, "reset")) {
+		check_argc(argc, 1, 1);
+		snc_emu_calls_reset();
+		emu_input_flush();
+		emu_acpi_event_flush();
+	} else if (!strcmp(cmd, "param")) {
+		check_argc(argc, 3, 3);
+		ret = emu_param_set(argv[1], argv[2]);
+		if (ret)
+			fail("param %s: %s", argv[1], errno_name(ret));
+	} else if (!strcmp(cmd, "compat-read")) {
+		do_compat_read(argc, argv);
+	} else if (!strcmp(cmd, "compat-read-start") ||
+			!strcmp(cmd, "compat-read-wait")) {
+		do_compat_read_async(argc, argv);
+	} else if (!strncmp(cmd, "compat-", 7)) {
+		do_compat(argc, argv);
+	} else if (!strncmp(cmd, "ring-", 5)) {
+		do_ring(argc, argv);
+	} else if (!strcmp(cmd, "debugfs")) {
+		do_debugfs(argc, argv);
+	} else if (!strcmp(cmd, "suspend")) {
+		check_argc(argc, 1, 1);
+		if (emu_suspend())
+			fail("suspend failed");
+	} else if (!strcmp(cmd, "resume")) {
+		check_argc(argc, 1, 1);
+		if (emu_resume())
+			fail("resume failed");
+		emu_settle();
+	} else if (!strcmp(cmd, "sleep")) {
+		check_argc(argc, 2, 2);
+		usleep(number(argv[1]) * 1000);
+	} else {
+		/* the firmware description */
+		ret = snc_emu_command(argc, argv, err, sizeof(err));
+		if (ret < 0)
+			fail("%s", err);
+		if (ret > 0)
+			fail("unknown command %s", cmd);
+	}
+}
+
+static void run(FILE *f)
+{
+	char line[1024];
+	char *argv[MAX_ARGS + 1];
+	int argc;
+
+	while (fgets(line, sizeof(line), f)) {
+		char *save, *word;
+
+		lineno++;
+		line[strcspn(line, "#\n")] = '\0';
+
+		argc = 0;
+		for (word = strtok_r(line, " \t", &save); word;
+				word = strtok_r(NULL, " \t", &save)) {
+			if (argc == MAX_ARGS)
+				fail("too many arguments");
+			argv[argc++] = word;
+		}
+		if (!argc)
+			continue;
+		argv[argc] = NULL;
+
+		if (emu_verbose)
+			fprintf(stderr, "%s:%u: %s\n", script, lineno,
+					argv[0]);
+		action(argc, argv);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	FILE *f;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "v")) != -1) {
+		switch (opt) {
+		case 'v':
+			emu_verbose++;
+			break;
+		default:
+			goto usage;
+		}
+	}
+	if (optind != argc - 1)
+		goto usage;
+
+	script = argv[optind];
+	f = fopen(script, "r");
+	if (!f) {
+		perror(script);
+		return 2;
+	}
+
+	sony_backend = &snc_emu_backend;
+	emu_kernel_init();
+	run(f);
+	fclose(f);
+
+	if (loaded)
+		do_remove();
+	emu_kernel_exit();
+
+	printf("%s: ok\n", script);
+
+	return 0;
+
+usage:
+	fprintf(stderr, "usage: %s [-v] SCRIPT\n", argv[0]);
+	return 2;
+}
@@ -0,0 +1,55 @@
+#ifndef _EMU_ACPI_ACPI_BUS_H
+#define _EMU_ACPI_ACPI_BUS_H
+#include <linux/acpi.h>
+
+typedef struct {
+	int event;
+} pm_message_t;
+
+struct acpi_device_status {
+	u32 present:1;
+	u32 enabled:1;
+	u32 show_in_ui:1;
+	u32 functional:1;
+};
+struct acpi_device_pnp {
+	char bus_id[8];
+	char device_name[40];
+	char device_class[20];
+};
+struct acpi_device {
+	acpi_handle handle;
+	struct acpi_device_status status;
+	struct acpi_device_pnp pnp;
+	struct device dev;
+	void *driver_data;
+};
+#define acpi_device_class(d)	((d)->pnp.device_class)
+
+struct acpi_device_id {
+	const char id[9];
+	unsigned long driver_data;
+};
+struct acpi_device_ops {
+	int (*add)(struct acpi_device *);
+	int (*remove)(struct acpi_device *, int);
+	int (*suspend)(struct acpi_device *, pm_message_t);
+	int (*resume)(struct acpi_device *);
+	void (*notify)(struct acpi_device *, u32);
+};
+struct acpi_driver {
+	char name[80];
+	char class[80];
+	const struct acpi_device_id *ids;
+	unsigned int flags;
+	struct acpi_device_ops ops;
+	struct module *owner;
+};
+int acpi_bus_register_driver(struct acpi_driver *driver);
+void acpi_bus_unregister_driver(struct acpi_driver *driver);
+int acpi_bus_get_status(struct acpi_device *device);
+int acpi_bus_generate_proc_event(struct acpi_device *device, u8 type,
+		int data);
+int acpi_bus_generate_netlink_event(const char *class, const char *bid,
+		u8 type, int data);
+#endif
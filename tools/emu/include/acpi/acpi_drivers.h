@@ -0,0 +1 @@
+#include <acpi/acpi_bus.h>
@@ -0,0 +1,105 @@
+#ifndef _EMU_LINUX_ACPI_H
+#define _EMU_LINUX_ACPI_H
+#include <linux/kernel.h>
+
+typedef void *acpi_handle;
+typedef u32 acpi_status;
+typedef u32 acpi_object_type;
+typedef u64 acpi_size;
+typedef char *acpi_string;
+
+#define AE_OK			0x0000
+#define AE_ERROR		0x0001
+#define AE_NO_MEMORY		0x0004
+#define AE_NOT_FOUND		0x0005
+#define AE_BUFFER_OVERFLOW	0x000B
+#define AE_BAD_PARAMETER	0x1001
+#define AE_CTRL_TERMINATE	0x4004
+#define ACPI_SUCCESS(s)		(!(s))
+#define ACPI_FAILURE(s)		(s)
+
+#define ACPI_TYPE_ANY		0x00
+#define ACPI_TYPE_INTEGER	0x01
+#define ACPI_TYPE_STRING	0x02
+#define ACPI_TYPE_BUFFER	0x03
+#define ACPI_TYPE_PACKAGE	0x04
+#define ACPI_TYPE_METHOD	0x08
+#define ACPI_ALLOCATE_BUFFER	((acpi_size) -1)
+#define METHOD_NAME__PRS	"_PRS"
+#define METHOD_NAME__CRS	"_CRS"
+
+union acpi_object {
+	acpi_object_type type;
+	struct {
+		acpi_object_type type;
+		u64 value;
+	} integer;
+	struct {
+		acpi_object_type type;
+		u32 length;
+		u8 *pointer;
+	} buffer;
+};
+struct acpi_object_list {
+	u32 count;
+	union acpi_object *pointer;
+};
+struct acpi_buffer {
+	acpi_size length;
+	void *pointer;
+};
+struct acpi_device_info {
+	u32 name;
+	u8 param_count;
+};
+
+typedef acpi_status (*acpi_walk_callback)(acpi_handle, u32, void *, void **);
+acpi_status acpi_evaluate_object(acpi_handle handle, acpi_string name,
+		struct acpi_object_list *params, struct acpi_buffer *output);
+acpi_status acpi_get_handle(acpi_handle parent, acpi_string name,
+		acpi_handle *handle);
+acpi_status acpi_get_object_info(acpi_handle handle,
+		struct acpi_device_info **info);
+acpi_status acpi_walk_namespace(acpi_object_type type, acpi_handle start,
+		u32 depth, acpi_walk_callback pre, acpi_walk_callback post,
+		void *context, void **ret);
+int acpi_video_backlight_support(void);
+
+/* resources of the SPIC device */
+#define ACPI_RESOURCE_TYPE_IRQ			0
+#define ACPI_RESOURCE_TYPE_START_DEPENDENT	2
+#define ACPI_RESOURCE_TYPE_END_DEPENDENT	3
+#define ACPI_RESOURCE_TYPE_IO			4
+#define ACPI_RESOURCE_TYPE_END_TAG		7
+#define ACPI_DECODE_16				1
+#define ACPI_SHARED				1
+struct acpi_resource_io {
+	u8 io_decode;
+	u8 alignment;
+	u8 address_length;
+	u16 minimum;
+	u16 maximum;
+};
+struct acpi_resource_irq {
+	u8 descriptor_length;
+	u8 triggering;
+	u8 polarity;
+	u8 sharable;
+	u8 interrupt_count;
+	u8 interrupts[1];
+};
+struct acpi_resource {
+	u32 type;
+	u32 length;
+	union {
+		struct acpi_resource_io io;
+		struct acpi_resource_irq irq;
+	} data;
+};
+typedef acpi_status (*acpi_walk_resource_callback)(struct acpi_resource *,
+		void *);
+acpi_status acpi_walk_resources(acpi_handle handle, char *name,
+		acpi_walk_resource_callback cb, void *context);
+acpi_status acpi_set_current_resources(acpi_handle handle,
+		struct acpi_buffer *buffer);
+#endif
@@ -0,0 +1,29 @@
+#include <linux/kernel.h>
+#define BL_CORE_SUSPENDRESUME	1
+enum backlight_type {
+	BACKLIGHT_RAW = 1,
+	BACKLIGHT_PLATFORM,
+	BACKLIGHT_FIRMWARE,
+};
+struct backlight_device;
+struct backlight_properties {
+	int brightness;
+	int max_brightness;
+	int power;
+	enum backlight_type type;
+};
+struct backlight_ops {
+	unsigned int options;
+	int (*update_status)(struct backlight_device *);
+	int (*get_brightness)(struct backlight_device *);
+};
+struct backlight_device {
+	struct backlight_properties props;
+	const struct backlight_ops *ops;
+	struct device dev;
+};
+struct backlight_device *backlight_device_register(const char *name,
+		struct device *parent, void *devdata,
+		const struct backlight_ops *ops,
+		const struct backlight_properties *props);
+void backlight_device_unregister(struct backlight_device *bd);
@@ -0,0 +1,13 @@
+#include <linux/kernel.h>
+#define DMI_SYS_VENDOR		1
+#define DMI_PRODUCT_NAME	2
+struct dmi_strmatch {
+	int slot;
+	const char *substr;
+};
+struct dmi_system_id {
+	const char *ident;
+	struct dmi_strmatch matches[4];
+};
+#define DMI_MATCH(a, b)	{ a, b }
+int dmi_check_system(const struct dmi_system_id *list);
@@ -0,0 +1,67 @@
+#ifndef _EMU_LINUX_FS_H
+#define _EMU_LINUX_FS_H
+#include <linux/kernel.h>
+
+struct super_block;
+struct inode {
+	void *i_private;
+	struct super_block *i_sb;
+	struct timespec i_atime;
+};
+static inline struct timespec current_fs_time(struct super_block *sb)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return ts;
+}
+struct dentry {
+	struct inode *d_inode;
+};
+struct path {
+	struct dentry *dentry;
+};
+struct file {
+	unsigned int f_flags;
+	struct path f_path;
+	loff_t f_pos;
+	void *private_data;
+};
+struct vm_area_struct {
+	unsigned long vm_start;
+	unsigned long vm_end;
+	unsigned long vm_pgoff;
+	unsigned long vm_flags;
+};
+#define VM_WRITE	0x02
+#define VM_SHARED	0x08
+#define VM_MAYWRITE	0x20
+#ifndef O_NONBLOCK
+#define O_NONBLOCK	04000
+#endif
+
+typedef struct {
+	int unused;
+} poll_table;
+struct fasync_struct;
+
+struct file_operations {
+	struct module *owner;
+	loff_t (*llseek)(struct file *, loff_t, int);
+	ssize_t (*read)(struct file *, char __user *, size_t, loff_t *);
+	ssize_t (*write)(struct file *, const char __user *, size_t,
+			loff_t *);
+	unsigned int (*poll)(struct file *, poll_table *);
+	long (*unlocked_ioctl)(struct file *, unsigned int, unsigned long);
+	int (*mmap)(struct file *, struct vm_area_struct *);
+	int (*open)(struct inode *, struct file *);
+	int (*release)(struct inode *, struct file *);
+	int (*fasync)(int, struct file *, int);
+};
+loff_t noop_llseek(struct file *file, loff_t offset, int whence);
+int remap_vmalloc_range(struct vm_area_struct *vma, void *addr,
+		unsigned long pgoff);
+int fasync_helper(int fd, struct file *file, int on,
+		struct fasync_struct **fa);
+void kill_fasync(struct fasync_struct **fa, int sig, int band);
+#endif
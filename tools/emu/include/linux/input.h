@@ -0,0 +1,43 @@
+#ifndef _EMU_LINUX_INPUT_H
+#define _EMU_LINUX_INPUT_H
+#include <linux/kernel.h>
+#include <linux/input-event-codes.h>
+#define BUS_ISA		0x10
+#define INPUT_KEYMAP_BY_INDEX	(1 << 0)
+struct input_id {
+	u16 bustype;
+	u16 vendor;
+	u16 product;
+	u16 version;
+};
+struct input_keymap_entry {
+	u8 flags;
+	u8 len;
+	u16 index;
+	u32 keycode;
+	u8 scancode[32];
+};
+struct input_dev {
+	const char *name;
+	struct input_id id;
+	unsigned long evbit[(EV_CNT + 63) / 64];
+	unsigned long keybit[(KEY_CNT + 63) / 64];
+	unsigned long relbit[(REL_CNT + 63) / 64];
+	unsigned long mscbit[(MSC_CNT + 63) / 64];
+	unsigned int keycodemax;
+	unsigned int keycodesize;
+	void *keycode;
+	struct device dev;
+};
+struct input_dev *input_allocate_device(void);
+void input_free_device(struct input_dev *dev);
+int input_register_device(struct input_dev *dev);
+void input_unregister_device(struct input_dev *dev);
+void input_set_capability(struct input_dev *dev, unsigned int type,
+		unsigned int code);
+void input_event(struct input_dev *dev, unsigned int type,
+		unsigned int code, int value);
+#define input_report_key(d, c, v)	input_event(d, EV_KEY, c, !!(v))
+#define input_report_rel(d, c, v)	input_event(d, EV_REL, c, v)
+#define input_sync(d)			input_event(d, EV_SYN, SYN_REPORT, 0)
+#endif
@@ -0,0 +1,14 @@
+#include <linux/kernel.h>
+typedef int irqreturn_t;
+#define IRQ_NONE	0
+#define IRQ_HANDLED	1
+#define IRQ_WAKE_THREAD	2
+#define IRQF_SHARED	0x80
+#define IRQF_DISABLED	0x20
+#define IRQF_ONESHOT	0x2000
+typedef irqreturn_t (*irq_handler_t)(int, void *);
+int request_threaded_irq(unsigned int irq, irq_handler_t handler,
+		irq_handler_t thread_fn, unsigned long flags,
+		const char *name, void *dev);
+#define request_irq(i, h, f, n, d) request_threaded_irq(i, h, NULL, f, n, d)
+void free_irq(unsigned int irq, void *dev);
@@ -0,0 +1,648 @@
+/*
+ * Userspace implementation of the kernel interfaces used by
+ * sony-laptop.c, just enough to run the driver against the SNC
+ * emulator: locks are pthread based, work items, async calls and
+ * timers run on threads, sysfs and debugfs files are kept in tables
+ * the harness reads and writes.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef _EMU_LINUX_KERNEL_H
+#define _EMU_LINUX_KERNEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/types.h>
+#include <linux/ioctl.h>
+
+typedef uint8_t u8;
+typedef int8_t s8;
+typedef uint16_t u16;
+typedef int16_t s16;
+typedef uint32_t u32;
+typedef int32_t s32;
+typedef uint64_t u64;
+typedef int64_t s64;
+typedef uint8_t __u8;
+typedef uint16_t __u16;
+typedef uint32_t __u32;
+typedef uint64_t __u64;
+typedef int16_t __s16;
+typedef int32_t __s32;
+typedef int64_t __s64;
+typedef unsigned short umode_t;
+typedef unsigned int gfp_t;
+
+#define __user
+#define __init
+#define __exit
+#define __initdata
+#define __read_mostly
+#define __percpu
+#define __rcu
+#define __always_unused	__attribute__((unused))
+
+#define __stringify_1(x...)	#x
+#define __stringify(x...)	__stringify_1(x)
+
+#define ARRAY_SIZE(a)		(sizeof(a) / sizeof((a)[0]))
+#define container_of(p, t, m)	((t *)((char *)(p) - offsetof(t, m)))
+#define min(a, b)		((a) < (b) ? (a) : (b))
+#define max(a, b)		((a) > (b) ? (a) : (b))
+#define min_t(t, a, b)		((t)(a) < (t)(b) ? (t)(a) : (t)(b))
+#define max_t(t, a, b)		((t)(a) > (t)(b) ? (t)(a) : (t)(b))
+#define clamp_t(t, v, lo, hi)	min_t(t, max_t(t, v, lo), hi)
+#define BIT(n)			(1UL << (n))
+#define DIV_ROUND_UP(n, d)	(((n) + (d) - 1) / (d))
+#define PAGE_SIZE		4096UL
+#define PAGE_ALIGN(x)		(((x) + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1))
+#define likely(x)		__builtin_expect(!!(x), 1)
+#define unlikely(x)		__builtin_expect(!!(x), 0)
+/* an atomic lvalue, so that the sanitizers see the marked accesses */
+#define ACCESS_ONCE(x)		(*(_Atomic __typeof__(x) *) &(x))
+#define BUILD_BUG_ON(x)		((void) sizeof(char[1 - 2 * !!(x)]))
+#define BUG_ON(x)		do { if (x) emu_bug(__FILE__, __LINE__); } while (0)
+#define WARN_ON(x)		({ int __c = !!(x); \
+				   if (__c) emu_warn(__FILE__, __LINE__); __c; })
+
+#define ERESTARTSYS	512
+
+void emu_bug(const char *file, int line) __attribute__((noreturn));
+void emu_warn(const char *file, int line);
+
+/* printk, only shown with the harness -v flag */
+#define KERN_ERR	""
+#define KERN_WARNING	""
+#define KERN_INFO	""
+#define KERN_DEBUG	""
+#ifndef pr_fmt
+#define pr_fmt(fmt) fmt
+#endif
+int printk(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+#define pr_err(fmt, ...)	printk(KERN_ERR pr_fmt(fmt), ##__VA_ARGS__)
+#define pr_warn(fmt, ...)	printk(KERN_WARNING pr_fmt(fmt), ##__VA_ARGS__)
+#define pr_info(fmt, ...)	printk(KERN_INFO pr_fmt(fmt), ##__VA_ARGS__)
+#define pr_debug(fmt, ...)	printk(KERN_DEBUG pr_fmt(fmt), ##__VA_ARGS__)
+#define dev_warn(d, fmt, ...)	printk(fmt, ##__VA_ARGS__)
+
+int scnprintf(char *buf, size_t size, const char *fmt, ...);
+int strict_strtoul(const char *s, unsigned int base, unsigned long *res);
+int strict_strtol(const char *s, unsigned int base, long *res);
+int sysfs_streq(const char *a, const char *b);
+
+static inline int fls(unsigned int x)
+{
+	return x ? 32 - __builtin_clz(x) : 0;
+}
+
+static inline int ilog2(unsigned long n)
+{
+	return 63 - __builtin_clzl(n);
+}
+
+static inline bool is_power_of_2(unsigned long n)
+{
+	return n != 0 && (n & (n - 1)) == 0;
+}
+
+static inline unsigned long roundup_pow_of_two(unsigned long n)
+{
+	return n <= 1 ? 1 : 1UL << (ilog2(n - 1) + 1);
+}
+
+static inline unsigned long rounddown_pow_of_two(unsigned long n)
+{
+	return 1UL << ilog2(n);
+}
+
+/* module and parameters */
+struct module {
+	const char *name;
+};
+extern struct module __this_module;
+#define THIS_MODULE		(&__this_module)
+#define MODULE_AUTHOR(x)
+#define MODULE_DESCRIPTION(x)
+#define MODULE_LICENSE(x)
+#define MODULE_VERSION(x)
+#define MODULE_ALIAS(x)
+#define MODULE_PARM_DESC(a, b)
+#define MODULE_DEVICE_TABLE(a, b)
+#define EXPORT_SYMBOL(x)
+#define EXPORT_SYMBOL_GPL(x)
+#define module_init(x)
+#define module_exit(x)
+
+struct kernel_param;
+struct kernel_param_ops {
+	int (*set)(const char *val, const struct kernel_param *kp);
+	int (*get)(char *buffer, const struct kernel_param *kp);
+};
+struct kernel_param {
+	const char *name;
+	const struct kernel_param_ops *ops;
+	void *arg;
+};
+extern const struct kernel_param_ops param_ops_int;
+extern const struct kernel_param_ops param_ops_uint;
+extern const struct kernel_param_ops param_ops_ulong;
+int param_set_int(const char *val, const struct kernel_param *kp);
+int param_get_int(char *buffer, const struct kernel_param *kp);
+int param_set_uint(const char *val, const struct kernel_param *kp);
+int param_get_uint(char *buffer, const struct kernel_param *kp);
+int param_set_ulong(const char *val, const struct kernel_param *kp);
+int param_get_ulong(char *buffer, const struct kernel_param *kp);
+
+/* the parameters are registered at startup for the harness param command */
+void emu_param_register(const char *name, const struct kernel_param_ops *ops,
+		void *arg);
+#define module_param_cb(n, o, a, perm)					\
+	static void __attribute__((constructor)) __emu_param_##n(void)	\
+	{								\
+		emu_param_register(#n, o, a);				\
+	}
+#define module_param_named(n, v, type, perm)				\
+	module_param_cb(n, &param_ops_##type, &v, perm)
+#define module_param(n, type, perm)	module_param_named(n, n, type, perm)
+
+/* atomics */
+typedef struct {
+	int counter;
+} atomic_t;
+#define ATOMIC_INIT(i)	{ (i) }
+
+static inline int atomic_read(const atomic_t *v)
+{
+	return __atomic_load_n(&v->counter, __ATOMIC_SEQ_CST);
+}
+
+static inline void atomic_set(atomic_t *v, int i)
+{
+	__atomic_store_n(&v->counter, i, __ATOMIC_SEQ_CST);
+}
+
+static inline int atomic_add_return(int i, atomic_t *v)
+{
+	return __atomic_add_fetch(&v->counter, i, __ATOMIC_SEQ_CST);
+}
+
+#define atomic_add(i, v)	((void) atomic_add_return(i, v))
+#define atomic_inc(v)		((void) atomic_add_return(1, v))
+#define atomic_dec(v)		((void) atomic_add_return(-1, v))
+#define atomic_inc_return(v)	atomic_add_return(1, v)
+#define atomic_dec_and_test(v)	(atomic_add_return(-1, v) == 0)
+
+static inline int atomic_cmpxchg(atomic_t *v, int old, int new)
+{
+	__atomic_compare_exchange_n(&v->counter, &old, new, false,
+			__ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	return old;
+}
+
+static inline int atomic_xchg(atomic_t *v, int new)
+{
+	return __atomic_exchange_n(&v->counter, new, __ATOMIC_SEQ_CST);
+}
+
+#define smp_mb()	__atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define smp_rmb()	__atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define smp_wmb()	__atomic_thread_fence(__ATOMIC_RELEASE)
+
+/* spinlocks and mutexes, there is no interrupt context in userspace */
+typedef struct {
+	pthread_mutex_t m;
+} spinlock_t;
+#define __SPIN_LOCK_UNLOCKED(x)	{ PTHREAD_MUTEX_INITIALIZER }
+#define DEFINE_SPINLOCK(x)	spinlock_t x = __SPIN_LOCK_UNLOCKED(x)
+#define spin_lock_init(l)	pthread_mutex_init(&(l)->m, NULL)
+#define spin_lock(l)		pthread_mutex_lock(&(l)->m)
+#define spin_unlock(l)		pthread_mutex_unlock(&(l)->m)
+#define spin_lock_bh		spin_lock
+#define spin_unlock_bh		spin_unlock
+#define spin_lock_irq		spin_lock
+#define spin_unlock_irq		spin_unlock
+#define spin_lock_irqsave(l, f)	do { (f) = 0; spin_lock(l); } while (0)
+#define spin_unlock_irqrestore(l, f) \
+	do { (void) (f); spin_unlock(l); } while (0)
+#define local_irq_save(f)	((f) = 0)
+#define local_irq_restore(f)	((void) (f))
+
+struct mutex {
+	pthread_mutex_t m;
+};
+#define __MUTEX_INITIALIZER(x)	{ PTHREAD_MUTEX_INITIALIZER }
+#define DEFINE_MUTEX(x)		struct mutex x = __MUTEX_INITIALIZER(x)
+#define mutex_init(l)		pthread_mutex_init(&(l)->m, NULL)
+#define mutex_destroy(l)	pthread_mutex_destroy(&(l)->m)
+#define mutex_lock(l)		pthread_mutex_lock(&(l)->m)
+#define mutex_unlock(l)		pthread_mutex_unlock(&(l)->m)
+#define mutex_trylock(l)	(pthread_mutex_trylock(&(l)->m) == 0)
+#define mutex_lock_interruptible(l)	(mutex_lock(l), 0)
+
+/* a single cpu, the per cpu counters are updated atomically instead */
+#define DEFINE_PER_CPU(t, n)	t n
+#define DECLARE_PER_CPU(t, n)	extern t n
+#define this_cpu_inc(x)		__atomic_fetch_add(&(x), 1, __ATOMIC_RELAXED)
+#define this_cpu_add(x, v)	__atomic_fetch_add(&(x), v, __ATOMIC_RELAXED)
+#define __this_cpu_inc(x)	this_cpu_inc(x)
+#define this_cpu_ptr(p)		(p)
+#define per_cpu_ptr(p, c)	((void) (c), (p))
+#define per_cpu(v, c)		(v)
+#define for_each_possible_cpu(c)	for ((c) = 0; (c) < 1; (c)++)
+
+/* time */
+#define HZ	100
+/* updated by the tick thread */
+extern unsigned long emu_jiffies;
+#define jiffies	__atomic_load_n(&emu_jiffies, __ATOMIC_RELAXED)
+#define time_after(a, b)	((long) ((b) - (a)) < 0)
+#define time_before(a, b)	time_after(b, a)
+#define time_after_eq(a, b)	((long) ((a) - (b)) >= 0)
+#define time_before_eq(a, b)	time_after_eq(b, a)
+
+static inline unsigned long msecs_to_jiffies(unsigned int ms)
+{
+	return DIV_ROUND_UP(ms, 1000 / HZ);
+}
+
+static inline unsigned int jiffies_to_msecs(unsigned long j)
+{
+	return j * (1000 / HZ);
+}
+
+typedef union {
+	s64 tv64;
+} ktime_t;
+
+static inline ktime_t ktime_get(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ktime_t) { (s64) ts.tv_sec * 1000000000LL + ts.tv_nsec };
+}
+
+static inline ktime_t ktime_get_real(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (ktime_t) { (s64) ts.tv_sec * 1000000000LL + ts.tv_nsec };
+}
+
+#define ktime_sub(a, b)		((ktime_t) { (a).tv64 - (b).tv64 })
+#define ktime_add_ns(a, n)	((ktime_t) { (a).tv64 + (s64) (n) })
+#define ktime_to_ns(k)		((k).tv64)
+#define ktime_to_us(k)		((k).tv64 / 1000)
+#define ns_to_ktime(n)		((ktime_t) { (s64) (n) })
+#define ktime_us_delta(a, b)	ktime_to_us(ktime_sub(a, b))
+#define ktime_compare(a, b)	((a).tv64 < (b).tv64 ? -1 : \
+				 (a).tv64 > (b).tv64 ? 1 : 0)
+
+void udelay(unsigned long us);
+void mdelay(unsigned long ms);
+void msleep(unsigned int ms);
+
+/* timers fire from the tick thread */
+struct timer_list {
+	unsigned long expires;
+	void (*function)(unsigned long);
+	unsigned long data;
+	bool pending;
+	struct timer_list *next;
+};
+void setup_timer(struct timer_list *timer, void (*fn)(unsigned long),
+		unsigned long data);
+int mod_timer(struct timer_list *timer, unsigned long expires);
+int del_timer(struct timer_list *timer);
+int del_timer_sync(struct timer_list *timer);
+int timer_pending(const struct timer_list *timer);
+
+/* memory, the allocations are counted for the leak check */
+#define GFP_KERNEL	0
+#define GFP_ATOMIC	1
+void *kmalloc(size_t size, gfp_t flags);
+void *kzalloc(size_t size, gfp_t flags);
+void *kcalloc(size_t n, size_t size, gfp_t flags);
+void kfree(const void *p);
+void *vmalloc_user(unsigned long size);
+void vfree(const void *p);
+void *__alloc_percpu(size_t size, size_t align);
+#define alloc_percpu(t)	((t *) __alloc_percpu(sizeof(t), __alignof__(t)))
+void free_percpu(void *p);
+
+/* uaccess, the user buffers are plain memory */
+#define put_user(x, p)	(*(p) = (x), 0)
+#define get_user(x, p)	((x) = *(p), 0)
+
+static inline unsigned long copy_to_user(void __user *to, const void *from,
+		unsigned long n)
+{
+	memcpy(to, from, n);
+	return 0;
+}
+
+static inline unsigned long copy_from_user(void *to, const void __user *from,
+		unsigned long n)
+{
+	memcpy(to, from, n);
+	return 0;
+}
+
+/* ports and EC: the driver reaches them only through its backend */
+u8 inb_p(unsigned long port);
+u8 inb(unsigned long port);
+void outb(u8 value, unsigned long port);
+int ec_read(u8 addr, u8 *value);
+int ec_write(u8 addr, u8 value);
+struct resource;
+struct resource *request_region(unsigned long start, unsigned long n,
+		const char *name);
+void release_region(unsigned long start, unsigned long n);
+
+/* lists */
+struct list_head {
+	struct list_head *next, *prev;
+};
+#define LIST_HEAD_INIT(n)	{ &(n), &(n) }
+#define LIST_HEAD(n)		struct list_head n = LIST_HEAD_INIT(n)
+
+static inline void INIT_LIST_HEAD(struct list_head *l)
+{
+	l->next = l->prev = l;
+}
+
+static inline void list_add(struct list_head *n, struct list_head *head)
+{
+	n->next = head->next;
+	n->prev = head;
+	head->next->prev = n;
+	head->next = n;
+}
+
+static inline void list_add_tail(struct list_head *n, struct list_head *head)
+{
+	list_add(n, head->prev);
+}
+
+static inline void list_del(struct list_head *e)
+{
+	e->prev->next = e->next;
+	e->next->prev = e->prev;
+	e->next = e->prev = NULL;
+}
+
+static inline int list_empty(const struct list_head *head)
+{
+	return head->next == head;
+}
+
+#define list_entry(p, t, m)		container_of(p, t, m)
+#define list_first_entry(p, t, m)	list_entry((p)->next, t, m)
+#define list_for_each_entry(pos, head, m)				\
+	for (pos = list_entry((head)->next, __typeof__(*pos), m);	\
+	     &pos->m != (head);						\
+	     pos = list_entry(pos->m.next, __typeof__(*pos), m))
+#define list_for_each_entry_reverse(pos, head, m)			\
+	for (pos = list_entry((head)->prev, __typeof__(*pos), m);	\
+	     &pos->m != (head);						\
+	     pos = list_entry(pos->m.prev, __typeof__(*pos), m))
+#define list_for_each_entry_safe(pos, n, head, m)			\
+	for (pos = list_entry((head)->next, __typeof__(*pos), m),	\
+	     n = list_entry(pos->m.next, __typeof__(*pos), m);		\
+	     &pos->m != (head);						\
+	     pos = n, n = list_entry(n->m.next, __typeof__(*n), m))
+
+/* byte fifo, the size is rounded down to a power of 2 as in the kernel */
+struct kfifo {
+	unsigned int in;
+	unsigned int out;
+	unsigned int mask;
+	u8 *data;
+};
+int kfifo_alloc(struct kfifo *fifo, unsigned int size, gfp_t flags);
+void kfifo_free(struct kfifo *fifo);
+unsigned int kfifo_in(struct kfifo *fifo, const void *buf, unsigned int n);
+unsigned int kfifo_out(struct kfifo *fifo, void *buf, unsigned int n);
+unsigned int kfifo_out_peek(struct kfifo *fifo, void *buf, unsigned int n);
+int kfifo_to_user(struct kfifo *fifo, void __user *to, unsigned int n,
+		unsigned int *copied);
+#define kfifo_initialized(f)	((f)->data != NULL)
+#define kfifo_size(f)		((f)->mask + 1)
+/* the length is read without the lock of the fifo, as in the kernel */
+#define kfifo_len(f)		\
+	(__atomic_load_n(&(f)->in, __ATOMIC_ACQUIRE) -		\
+	 __atomic_load_n(&(f)->out, __ATOMIC_ACQUIRE))
+#define kfifo_avail(f)		(kfifo_size(f) - kfifo_len(f))
+#define kfifo_is_empty(f)	(kfifo_len(f) == 0)
+#define kfifo_is_full(f)	(kfifo_len(f) > (f)->mask)
+#define kfifo_reset(f)		\
+	(__atomic_store_n(&(f)->in, 0, __ATOMIC_RELEASE),	\
+	 __atomic_store_n(&(f)->out, 0, __ATOMIC_RELEASE))
+#define kfifo_in_spinlocked(f, b, n, l) ({			\
+	unsigned long __f;					\
+	unsigned int __r;					\
+	spin_lock_irqsave(l, __f);				\
+	__r = kfifo_in(f, b, n);				\
+	spin_unlock_irqrestore(l, __f);				\
+	__r; })
+#define kfifo_out_spinlocked(f, b, n, l) ({			\
+	unsigned long __f;					\
+	unsigned int __r;					\
+	spin_lock_irqsave(l, __f);				\
+	__r = kfifo_out(f, b, n);				\
+	spin_unlock_irqrestore(l, __f);				\
+	__r; })
+#define kfifo_in_locked		kfifo_in_spinlocked
+#define kfifo_out_locked	kfifo_out_spinlocked
+
+/* wait queues and completions */
+typedef struct {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+} wait_queue_head_t;
+#define DECLARE_WAIT_QUEUE_HEAD(n) \
+	wait_queue_head_t n = { PTHREAD_MUTEX_INITIALIZER, \
+				PTHREAD_COND_INITIALIZER }
+void init_waitqueue_head(wait_queue_head_t *wq);
+void wake_up_interruptible(wait_queue_head_t *wq);
+#define wake_up			wake_up_interruptible
+/* the condition is rechecked at least every millisecond */
+void __emu_wait(wait_queue_head_t *wq);
+#define wait_event_interruptible(wq, cond) ({			\
+	while (!(cond))						\
+		__emu_wait(&(wq));				\
+	0; })
+#define wait_event(wq, cond)	((void) wait_event_interruptible(wq, cond))
+
+struct completion {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	unsigned int done;
+};
+#define DECLARE_COMPLETION(n) \
+	struct completion n = { PTHREAD_MUTEX_INITIALIZER, \
+				PTHREAD_COND_INITIALIZER, 0 }
+void init_completion(struct completion *x);
+void complete(struct completion *x);
+void complete_all(struct completion *x);
+void wait_for_completion(struct completion *x);
+int wait_for_completion_interruptible(struct completion *x);
+int completion_done(struct completion *x);
+#define INIT_COMPLETION(x)	((x).done = 0)
+
+#define signal_pending(p)	0
+extern void *current;
+
+/* work queues, one thread each */
+struct work_struct;
+typedef void (*work_func_t)(struct work_struct *work);
+struct workqueue_struct;
+struct work_struct {
+	work_func_t func;
+	struct workqueue_struct *wq;
+	bool pending;
+	struct work_struct *next;
+};
+#define INIT_WORK(w, f)		(*(w) = (struct work_struct) { .func = (f) })
+#define DECLARE_WORK(n, f)	struct work_struct n = { .func = (f) }
+extern struct workqueue_struct *system_freezable_wq;
+extern struct workqueue_struct *system_wq;
+extern struct workqueue_struct *system_unbound_wq;
+struct workqueue_struct *alloc_ordered_workqueue(const char *name,
+		unsigned int flags, ...);
+void destroy_workqueue(struct workqueue_struct *wq);
+void flush_workqueue(struct workqueue_struct *wq);
+int queue_work(struct workqueue_struct *wq, struct work_struct *work);
+#define schedule_work(w)	queue_work(system_wq, w)
+int cancel_work_sync(struct work_struct *work);
+void flush_work(struct work_struct *work);
+
+/* async calls, a thread each */
+typedef u64 async_cookie_t;
+typedef void (async_func_ptr)(void *data, async_cookie_t cookie);
+struct async_domain {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	unsigned int running;
+};
+#define ASYNC_DOMAIN_EXCLUSIVE(n) \
+	struct async_domain n = { PTHREAD_MUTEX_INITIALIZER, \
+				  PTHREAD_COND_INITIALIZER, 0 }
+#define ASYNC_DOMAIN(n)		ASYNC_DOMAIN_EXCLUSIVE(n)
+async_cookie_t async_schedule_domain(async_func_ptr *fn, void *data,
+		struct async_domain *domain);
+void async_synchronize_full_domain(struct async_domain *domain);
+void async_synchronize_full(void);
+
+/* rcu, the readers hold a rwlock the grace period waits for */
+void rcu_read_lock(void);
+void rcu_read_unlock(void);
+void synchronize_rcu(void);
+#define rcu_dereference(p)		__atomic_load_n(&(p), __ATOMIC_ACQUIRE)
+#define rcu_dereference_protected(p, c)	(p)
+#define rcu_access_pointer(p)		(p)
+#define rcu_assign_pointer(p, v) \
+	__atomic_store_n(&(p), (v), __ATOMIC_RELEASE)
+#define lockdep_is_held(l)		1
+
+/* bits */
+static inline void __set_bit(int nr, unsigned long *addr)
+{
+	addr[nr / 64] |= 1UL << (nr % 64);
+}
+
+static inline void __clear_bit(int nr, unsigned long *addr)
+{
+	addr[nr / 64] &= ~(1UL << (nr % 64));
+}
+
+static inline int test_bit(int nr, const unsigned long *addr)
+{
+	return (addr[nr / 64] >> (nr % 64)) & 1;
+}
+
+#define set_bit		__set_bit
+#define clear_bit	__clear_bit
+
+/* device model and sysfs */
+struct kobject {
+	const char *name;
+};
+struct attribute {
+	const char *name;
+	umode_t mode;
+};
+struct device;
+struct device_attribute {
+	struct attribute attr;
+	ssize_t (*show)(struct device *dev, struct device_attribute *attr,
+			char *buf);
+	ssize_t (*store)(struct device *dev, struct device_attribute *attr,
+			const char *buf, size_t count);
+};
+struct attribute_group {
+	const char *name;
+	struct attribute **attrs;
+};
+struct dev_pm_ops {
+	int (*suspend)(struct device *dev);
+	int (*resume)(struct device *dev);
+	int (*resume_noirq)(struct device *dev);
+};
+struct device_driver {
+	const char *name;
+	struct module *owner;
+	const struct dev_pm_ops *pm;
+};
+struct device {
+	struct kobject kobj;
+	struct device *parent;
+	struct device_driver *driver;
+	const char *init_name;
+};
+#define __ATTR(n, m, s, st) \
+	{ .attr = { .name = __stringify(n), .mode = m }, .show = s, .store = st }
+#define DEVICE_ATTR(n, m, s, st) \
+	struct device_attribute dev_attr_##n = __ATTR(n, m, s, st)
+#define S_IRUGO		0444
+#define S_IWUGO		0222
+#define S_IRUSR		0400
+#define S_IWUSR		0200
+#define sysfs_attr_init(a)	do { } while (0)
+int device_create_file(struct device *dev, const struct device_attribute *a);
+void device_remove_file(struct device *dev, const struct device_attribute *a);
+int sysfs_create_group(struct kobject *kobj, const struct attribute_group *g);
+void sysfs_remove_group(struct kobject *kobj,
+		const struct attribute_group *g);
+void sysfs_notify(struct kobject *kobj, const char *dir, const char *attr);
+enum kobject_action {
+	KOBJ_CHANGE,
+};
+int kobject_uevent_env(struct kobject *kobj, enum kobject_action action,
+		char *envp[]);
+const char *dev_name(const struct device *dev);
+
+/* misc */
+#define IS_ERR_VALUE(x)	((unsigned long) (x) >= (unsigned long) -4095)
+#define IS_ERR(p)	IS_ERR_VALUE(p)
+#define IS_ERR_OR_NULL(p)	(!(p) || IS_ERR_VALUE(p))
+#define PTR_ERR(p)	((long) (p))
+#define ERR_PTR(e)	((void *) (long) (e))
+
+void emu_kernel_init(void);
+void emu_kernel_exit(void);
+
+#endif /* _EMU_LINUX_KERNEL_H */
@@ -0,0 +1,18 @@
+#include <linux/kernel.h>
+#define PCI_VENDOR_ID_INTEL		0x8086
+#define PCI_VENDOR_ID_SONY		0x104d
+#define PCI_DEVICE_ID_INTEL_82371AB_3	0x7113
+#define PCI_DEVICE_ID_INTEL_ICH6_1	0x2641
+#define PCI_DEVICE_ID_INTEL_ICH7_1	0x27b9
+#define PCI_DEVICE_ID_INTEL_ICH8_4	0x2815
+#define PCI_DEVICE_ID_INTEL_ICH9_1	0x2917
+struct pci_dev;
+/* no SPIC bridge in the emulated machine */
+static inline struct pci_dev *pci_get_device(unsigned int vendor,
+		unsigned int device, struct pci_dev *from)
+{
+	return NULL;
+}
+static inline void pci_dev_put(struct pci_dev *dev)
+{
+}
@@ -0,0 +1,20 @@
+#ifndef _EMU_LINUX_PLATFORM_DEVICE_H
+#define _EMU_LINUX_PLATFORM_DEVICE_H
+#include <linux/kernel.h>
+struct platform_device {
+	const char *name;
+	int id;
+	struct device dev;
+};
+struct platform_driver {
+	int (*probe)(struct platform_device *);
+	int (*remove)(struct platform_device *);
+	struct device_driver driver;
+};
+int platform_driver_register(struct platform_driver *drv);
+void platform_driver_unregister(struct platform_driver *drv);
+struct platform_device *platform_device_alloc(const char *name, int id);
+int platform_device_add(struct platform_device *pdev);
+void platform_device_put(struct platform_device *pdev);
+void platform_device_unregister(struct platform_device *pdev);
+#endif
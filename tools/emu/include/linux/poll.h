@@ -0,0 +1,13 @@
+#include <linux/fs.h>
+#define POLLIN		0x0001
+#define POLLRDNORM	0x0040
+#ifndef POLL_IN
+#define POLL_IN		1
+#endif
+#ifndef SIGIO
+#define SIGIO		29
+#endif
+static inline void poll_wait(struct file *file, wait_queue_head_t *wq,
+		poll_table *p)
+{
+}
@@ -0,0 +1,25 @@
+#include <linux/kernel.h>
+enum rfkill_type {
+	RFKILL_TYPE_ALL,
+	RFKILL_TYPE_WLAN,
+	RFKILL_TYPE_BLUETOOTH,
+	RFKILL_TYPE_UWB,
+	RFKILL_TYPE_WIMAX,
+	RFKILL_TYPE_WWAN,
+};
+struct rfkill;
+struct rfkill_ops {
+	void (*poll)(struct rfkill *, void *);
+	void (*query)(struct rfkill *, void *);
+	int (*set_block)(void *, bool);
+};
+struct rfkill *rfkill_alloc(const char *name, struct device *parent,
+		enum rfkill_type type, const struct rfkill_ops *ops,
+		void *data);
+int rfkill_register(struct rfkill *rfkill);
+void rfkill_unregister(struct rfkill *rfkill);
+void rfkill_destroy(struct rfkill *rfkill);
+bool rfkill_set_sw_state(struct rfkill *rfkill, bool blocked);
+bool rfkill_set_hw_state(struct rfkill *rfkill, bool blocked);
+void rfkill_init_sw_state(struct rfkill *rfkill, bool blocked);
+void rfkill_set_states(struct rfkill *rfkill, bool sw, bool hw);
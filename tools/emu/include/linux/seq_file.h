@@ -0,0 +1,20 @@
+#ifndef _EMU_LINUX_SEQ_FILE_H
+#define _EMU_LINUX_SEQ_FILE_H
+#include <linux/fs.h>
+struct seq_file {
+	char *buf;
+	size_t size;
+	size_t count;
+	void *private;
+	int (*show)(struct seq_file *, void *);
+};
+int seq_printf(struct seq_file *m, const char *fmt, ...)
+	__attribute__((format(printf, 2, 3)));
+int seq_puts(struct seq_file *m, const char *s);
+int single_open(struct file *file, int (*show)(struct seq_file *, void *),
+		void *data);
+int single_release(struct inode *inode, struct file *file);
+ssize_t seq_read(struct file *file, char __user *buf, size_t size,
+		loff_t *ppos);
+loff_t seq_lseek(struct file *file, loff_t offset, int whence);
+#endif
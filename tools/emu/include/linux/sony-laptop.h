@@ -0,0 +1,13 @@
+#ifndef _EMU_LINUX_SONYLAPTOP_H
+#define _EMU_LINUX_SONYLAPTOP_H
+#include <linux/types.h>
+#define SONY_PIC_COMMAND_SETCAMERA		1
+#define SONY_PIC_COMMAND_SETCAMERABRIGHTNESS	2
+#define SONY_PIC_COMMAND_SETCAMERACONTRAST	3
+#define SONY_PIC_COMMAND_SETCAMERAHUE		4
+#define SONY_PIC_COMMAND_SETCAMERACOLOR		5
+#define SONY_PIC_COMMAND_SETCAMERASHARPNESS	6
+#define SONY_PIC_COMMAND_SETCAMERAPICTURE	7
+#define SONY_PIC_COMMAND_SETCAMERAAGC		8
+int sony_pic_camera_command(int command, u8 value);
+#endif
@@ -0,0 +1,2 @@
+#include <linux/types.h>
+#include_next <linux/sonypi.h>
@@ -0,0 +1,11 @@
+#include <linux/kernel.h>
+/* the events are not recorded, -t turns the enabled checks on */
+extern bool emu_trace_enabled;
+#define TP_PROTO(args...)	args
+#define TP_ARGS(args...)	args
+#define TRACE_EVENT(name, proto, args, tstruct, assign, print)	\
+	static inline void trace_##name(proto) { }		\
+	static inline bool trace_##name##_enabled(void)		\
+	{							\
+		return emu_trace_enabled;			\
+	}
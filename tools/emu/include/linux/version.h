@@ -0,0 +1,3 @@
+#include <linux/kernel.h>
+#define KERNEL_VERSION(a, b, c)	(((a) << 16) + ((b) << 8) + (c))
+#define LINUX_VERSION_CODE	KERNEL_VERSION(3, 7, 0)
@@ -0,0 +1,2068 @@
+/*
+ * Userspace implementation of the kernel interfaces used by
+ * sony-laptop.c, see include/linux/kernel.h
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#include <unistd.h>
+#include <linux/kernel.h>
+#include <linux/fs.h>
+#include <linux/seq_file.h>
+#include <linux/debugfs.h>
+#include <linux/miscdevice.h>
+#include <linux/suspend.h>
+#include <linux/platform_device.h>
+#include <linux/input.h>
+#include <linux/backlight.h>
+#include <linux/rfkill.h>
+#include <linux/interrupt.h>
+#include <linux/dmi.h>
+#include <linux/acpi.h>
+#include <acpi/acpi_bus.h>
+
+#include "emu.h"
+#include "snc-emu.h"
+
+int emu_verbose;
+bool emu_trace_enabled;
+int emu_dmi_match;
+int emu_video_backlight;
+struct module __this_module = { "sony_laptop" };
+void *current;
+
+/*********** printk and bugs ***********/
+
+static pthread_mutex_t emu_printk_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int printk(const char *fmt, ...)
+{
+	va_list ap;
+	int ret;
+
+	if (!emu_verbose)
+		return 0;
+
+	pthread_mutex_lock(&emu_printk_lock);
+	fputs("[kernel] ", stderr);
+	va_start(ap, fmt);
+	ret = vfprintf(stderr, fmt, ap);
+	va_end(ap);
+	pthread_mutex_unlock(&emu_printk_lock);
+
+	return ret;
+}
+
+void emu_bug(const char *file, int line)
+{
+	fprintf(stderr, "BUG at %s:%d\n", file, line);
+	abort();
+}
+
+void emu_warn(const char *file, int line)
+{
+	fprintf(stderr, "WARNING at %s:%d\n", file, line);
+}
+
+/*********** strings ***********/
+
+int scnprintf(char *buf, size_t size, const char *fmt, ...)
+{
+	va_list ap;
+	int ret;
+
+	if (!size)
+		return 0;
+
+	va_start(ap, fmt);
+	ret = vsnprintf(buf, size, fmt, ap);
+	va_end(ap);
+
+	return ret < (int) size ? ret : (int) size - 1;
+}
+
+/* as the kernel: the whole string must be a number, but a newline */
+int strict_strtoul(const char *s, unsigned int base, unsigned long *res)
+{
+	size_t len = strlen(s);
+	char *end;
+
+	if (!len || *s == '-' || *s == '+')
+		return -EINVAL;
+
+	errno = 0;
+	*res = strtoul(s, &end, base);
+	if (errno || end == s)
+		return -EINVAL;
+	if (*end == '\n')
+		end++;
+
+	return *end ? -EINVAL : 0;
+}
+
+int strict_strtol(const char *s, unsigned int base, long *res)
+{
+	unsigned long val;
+	int ret;
+
+	if (*s == '-') {
+		ret = strict_strtoul(s + 1, base, &val);
+		if (!ret)
+			*res = -(long) val;
+		return ret;
+	}
+
+	ret = strict_strtoul(s, base, &val);
+	if (!ret)
+		*res = val;
+
+	return ret;
+}
+
+int sysfs_streq(const char *a, const char *b)
+{
+	while (*a && *a == *b) {
+		a++;
+		b++;
+	}
+
+	if (*a == *b)
+		return 1;
+	if (!*a && *b == '\n' && !b[1])
+		return 1;
+	if (*a == '\n' && !a[1] && !*b)
+		return 1;
+
+	return 0;
+}
+
+/*********** module parameters ***********/
+
+#define EMU_PARAMS	64
+static struct kernel_param emu_params[EMU_PARAMS];
+static unsigned int emu_nparams;
+
+void emu_param_register(const char *name, const struct kernel_param_ops *ops,
+		void *arg)
+{
+	if (emu_nparams == EMU_PARAMS)
+		emu_bug(__FILE__, __LINE__);
+
+	emu_params[emu_nparams].name = name;
+	emu_params[emu_nparams].ops = ops;
+	emu_params[emu_nparams].arg = arg;
+	emu_nparams++;
+}
+
+static struct kernel_param *emu_param_find(const char *name)
+{
+	unsigned int i;
+
+	for (i = 0; i < emu_nparams; i++) {
+		if (!strcmp(emu_params[i].name, name))
+			return &emu_params[i];
+	}
+
+	return NULL;
+}
+
+int emu_param_set(const char *name, const char *value)
+{
+	struct kernel_param *kp = emu_param_find(name);
+
+	if (!kp)
+		return -ENOENT;
+
+	return kp->ops->set(value, kp);
+}
+
+int emu_param_get(const char *name, char *buffer)
+{
+	struct kernel_param *kp = emu_param_find(name);
+
+	if (!kp)
+		return -ENOENT;
+	if (!kp->ops->get)
+		return -EPERM;
+
+	return kp->ops->get(buffer, kp);
+}
+
+int param_set_int(const char *val, const struct kernel_param *kp)
+{
+	long v;
+
+	if (strict_strtol(val, 0, &v) || v < INT_MIN || v > INT_MAX)
+		return -EINVAL;
+	*(int *) kp->arg = v;
+
+	return 0;
+}
+
+int param_get_int(char *buffer, const struct kernel_param *kp)
+{
+	return sprintf(buffer, "%d", *(int *) kp->arg);
+}
+
+int param_set_uint(const char *val, const struct kernel_param *kp)
+{
+	unsigned long v;
+
+	if (strict_strtoul(val, 0, &v) || v > UINT_MAX)
+		return -EINVAL;
+	*(unsigned int *) kp->arg = v;
+
+	return 0;
+}
+
+int param_get_uint(char *buffer, const struct kernel_param *kp)
+{
+	return sprintf(buffer, "%u", *(unsigned int *) kp->arg);
+}
+
+int param_set_ulong(const char *val, const struct kernel_param *kp)
+{
+	return strict_strtoul(val, 0, (unsigned long *) kp->arg);
+}
+
+int param_get_ulong(char *buffer, const struct kernel_param *kp)
+{
+	return sprintf(buffer, "%lu", *(unsigned long *) kp->arg);
+}
+
+const struct kernel_param_ops param_ops_int = {
+	.set = param_set_int,
+	.get = param_get_int,
+};
+
+const struct kernel_param_ops param_ops_uint = {
+	.set = param_set_uint,
+	.get = param_get_uint,
+};
+
+const struct kernel_param_ops param_ops_ulong = {
+	.set = param_set_ulong,
+	.get = param_get_ulong,
+};
+
+/*********** memory ***********/
+
+static long emu_live_allocations;
+
+long emu_allocations(void)
+{
+	return __atomic_load_n(&emu_live_allocations, __ATOMIC_SEQ_CST);
+}
+
+static void *emu_counted(void *p)
+{
+	if (p)
+		__atomic_add_fetch(&emu_live_allocations, 1, __ATOMIC_SEQ_CST);
+	return p;
+}
+
+void *kmalloc(size_t size, gfp_t flags)
+{
+	return emu_counted(malloc(size ? size : 1));
+}
+
+void *kzalloc(size_t size, gfp_t flags)
+{
+	return emu_counted(calloc(1, size ? size : 1));
+}
+
+void *kcalloc(size_t n, size_t size, gfp_t flags)
+{
+	return emu_counted(calloc(n ? n : 1, size ? size : 1));
+}
+
+void kfree(const void *p)
+{
+	if (!p)
+		return;
+	__atomic_sub_fetch(&emu_live_allocations, 1, __ATOMIC_SEQ_CST);
+	free((void *) p);
+}
+
+void *vmalloc_user(unsigned long size)
+{
+	void *p;
+
+	if (posix_memalign(&p, PAGE_SIZE, PAGE_ALIGN(size)))
+		return NULL;
+	memset(p, 0, PAGE_ALIGN(size));
+
+	return emu_counted(p);
+}
+
+void vfree(const void *p)
+{
+	kfree(p);
+}
+
+void *__alloc_percpu(size_t size, size_t align)
+{
+	return kzalloc(size, GFP_KERNEL);
+}
+
+void free_percpu(void *p)
+{
+	kfree(p);
+}
+
+/*********** ports and EC ***********/
+
+/* the native accessors, only reachable by bypassing the driver backend */
+static void emu_bypass(const char *what)
+{
+	fprintf(stderr, "%s called outside of the driver backend\n", what);
+	abort();
+}
+
+u8 inb_p(unsigned long port)
+{
+	emu_bypass("inb_p");
+	return 0;
+}
+
+u8 inb(unsigned long port)
+{
+	emu_bypass("inb");
+	return 0;
+}
+
+void outb(u8 value, unsigned long port)
+{
+	emu_bypass("outb");
+}
+
+int ec_read(u8 addr, u8 *value)
+{
+	emu_bypass("ec_read");
+	return -EIO;
+}
+
+int ec_write(u8 addr, u8 value)
+{
+	emu_bypass("ec_write");
+	return -EIO;
+}
+
+acpi_status acpi_evaluate_object(acpi_handle handle, acpi_string name,
+		struct acpi_object_list *params, struct acpi_buffer *output)
+{
+	emu_bypass("acpi_evaluate_object");
+	return AE_ERROR;
+}
+
+struct resource *request_region(unsigned long start, unsigned long n,
+		const char *name)
+{
+	return (struct resource *) start;
+}
+
+void release_region(unsigned long start, unsigned long n)
+{
+}
+
+int request_threaded_irq(unsigned int irq, irq_handler_t handler,
+		irq_handler_t thread_fn, unsigned long flags,
+		const char *name, void *dev)
+{
+	return 0;
+}
+
+void free_irq(unsigned int irq, void *dev)
+{
+}
+
+int dmi_check_system(const struct dmi_system_id *list)
+{
+	return emu_dmi_match;
+}
+
+/*********** time and timers ***********/
+
+unsigned long emu_jiffies = (unsigned long) -300 * HZ;
+
+static pthread_mutex_t emu_timer_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t emu_timer_cond = PTHREAD_COND_INITIALIZER;
+static struct timer_list *emu_timers;
+static struct timer_list *emu_timer_running;
+static pthread_t emu_tick_thread;
+static bool emu_tick_stop;
+
+void udelay(unsigned long us)
+{
+	usleep(us);
+}
+
+void mdelay(unsigned long ms)
+{
+	usleep(ms * 1000);
+}
+
+void msleep(unsigned int ms)
+{
+	usleep(ms * 1000);
+}
+
+void setup_timer(struct timer_list *timer, void (*fn)(unsigned long),
+		unsigned long data)
+{
+	memset(timer, 0, sizeof(*timer));
+	timer->function = fn;
+	timer->data = data;
+}
+
+/* emu_timer_lock held */
+static int emu_timer_unlink(struct timer_list *timer)
+{
+	struct timer_list **p;
+
+	if (!timer->pending)
+		return 0;
+
+	for (p = &emu_timers; *p; p = &(*p)->next) {
+		if (*p == timer) {
+			*p = timer->next;
+			break;
+		}
+	}
+	__atomic_store_n(&timer->pending, false, __ATOMIC_RELAXED);
+
+	return 1;
+}
+
+int mod_timer(struct timer_list *timer, unsigned long expires)
+{
+	int ret;
+
+	pthread_mutex_lock(&emu_timer_lock);
+	ret = emu_timer_unlink(timer);
+	timer->expires = expires;
+	__atomic_store_n(&timer->pending, true, __ATOMIC_RELAXED);
+	timer->next = emu_timers;
+	emu_timers = timer;
+	pthread_mutex_unlock(&emu_timer_lock);
+
+	return ret;
+}
+
+int del_timer(struct timer_list *timer)
+{
+	int ret;
+
+	pthread_mutex_lock(&emu_timer_lock);
+	ret = emu_timer_unlink(timer);
+	pthread_mutex_unlock(&emu_timer_lock);
+
+	return ret;
+}
+
+int del_timer_sync(struct timer_list *timer)
+{
+	int ret;
+
+	pthread_mutex_lock(&emu_timer_lock);
+	ret = emu_timer_unlink(timer);
+	while (emu_timer_running == timer)
+		pthread_cond_wait(&emu_timer_cond, &emu_timer_lock);
+	pthread_mutex_unlock(&emu_timer_lock);
+
+	return ret;
+}
+
+int timer_pending(const struct timer_list *timer)
+{
+	/* lockless, as in the kernel */
+	return __atomic_load_n(&timer->pending, __ATOMIC_RELAXED);
+}
+
+/* emu_timer_lock held, runs the expired timers */
+static void emu_timers_run(void)
+{
+	struct timer_list *t;
+
+again:
+	for (t = emu_timers; t; t = t->next) {
+		if (time_after_eq(jiffies, t->expires))
+			break;
+	}
+	if (!t)
+		return;
+
+	emu_timer_unlink(t);
+	emu_timer_running = t;
+	pthread_mutex_unlock(&emu_timer_lock);
+	t->function(t->data);
+	pthread_mutex_lock(&emu_timer_lock);
+	emu_timer_running = NULL;
+	pthread_cond_broadcast(&emu_timer_cond);
+	goto again;
+}
+
+static void *emu_tick(void *arg)
+{
+	ktime_t start = ktime_get();
+	unsigned long base = jiffies;
+
+	pthread_mutex_lock(&emu_timer_lock);
+	while (!emu_tick_stop) {
+		s64 ms = ktime_to_ns(ktime_sub(ktime_get(), start)) / 1000000;
+
+		__atomic_store_n(&emu_jiffies, base + ms / (1000 / HZ),
+				__ATOMIC_RELAXED);
+		emu_timers_run();
+		pthread_mutex_unlock(&emu_timer_lock);
+		usleep(1000);
+		pthread_mutex_lock(&emu_timer_lock);
+	}
+	pthread_mutex_unlock(&emu_timer_lock);
+
+	return NULL;
+}
+
+/* wait until no timer is due */
+static void emu_timers_settle(void)
+{
+	struct timer_list *t;
+	bool due;
+
+	do {
+		pthread_mutex_lock(&emu_timer_lock);
+		due = emu_timer_running != NULL;
+		for (t = emu_timers; t && !due; t = t->next)
+			due = time_after_eq(jiffies + 1, t->expires);
+		pthread_mutex_unlock(&emu_timer_lock);
+		if (due)
+			usleep(1000);
+	} while (due);
+}
+
+/*********** fifo ***********/
+
+int kfifo_alloc(struct kfifo *fifo, unsigned int size, gfp_t flags)
+{
+	size = size < 2 ? 0 : rounddown_pow_of_two(size);
+
+	fifo->in = fifo->out = 0;
+	if (!size) {
+		fifo->data = NULL;
+		fifo->mask = 0;
+		return -EINVAL;
+	}
+
+	fifo->data = kmalloc(size, flags);
+	if (!fifo->data) {
+		fifo->mask = 0;
+		return -ENOMEM;
+	}
+	fifo->mask = size - 1;
+
+	return 0;
+}
+
+void kfifo_free(struct kfifo *fifo)
+{
+	kfree(fifo->data);
+	fifo->data = NULL;
+	fifo->in = fifo->out = fifo->mask = 0;
+}
+
+static void emu_kfifo_copy_in(struct kfifo *fifo, const void *buf,
+		unsigned int n, unsigned int off)
+{
+	unsigned int size = fifo->mask + 1;
+	unsigned int l;
+
+	off &= fifo->mask;
+	l = min(n, size - off);
+	memcpy(fifo->data + off, buf, l);
+	memcpy(fifo->data, (const u8 *) buf + l, n - l);
+}
+
+static void emu_kfifo_copy_out(struct kfifo *fifo, void *buf,
+		unsigned int n, unsigned int off)
+{
+	unsigned int size = fifo->mask + 1;
+	unsigned int l;
+
+	off &= fifo->mask;
+	l = min(n, size - off);
+	memcpy(buf, fifo->data + off, l);
+	memcpy((u8 *) buf + l, fifo->data, n - l);
+}
+
+unsigned int kfifo_in(struct kfifo *fifo, const void *buf, unsigned int n)
+{
+	n = min(n, kfifo_avail(fifo));
+	emu_kfifo_copy_in(fifo, buf, n, fifo->in);
+	__atomic_store_n(&fifo->in, fifo->in + n, __ATOMIC_RELEASE);
+
+	return n;
+}
+
+unsigned int kfifo_out_peek(struct kfifo *fifo, void *buf, unsigned int n)
+{
+	n = min(n, kfifo_len(fifo));
+	emu_kfifo_copy_out(fifo, buf, n, fifo->out);
+
+	return n;
+}
+
+unsigned int kfifo_out(struct kfifo *fifo, void *buf, unsigned int n)
+{
+	n = kfifo_out_peek(fifo, buf, n);
+	__atomic_store_n(&fifo->out, fifo->out + n, __ATOMIC_RELEASE);
+
+	return n;
+}
+
+int kfifo_to_user(struct kfifo *fifo, void __user *to, unsigned int n,
+		unsigned int *copied)
+{
+	*copied = kfifo_out(fifo, to, n);
+
+	return 0;
+}
+
+/*********** wait queues and completions ***********/
+
+void init_waitqueue_head(wait_queue_head_t *wq)
+{
+	pthread_mutex_init(&wq->lock, NULL);
+	pthread_cond_init(&wq->cond, NULL);
+}
+
+void wake_up_interruptible(wait_queue_head_t *wq)
+{
+	pthread_mutex_lock(&wq->lock);
+	pthread_cond_broadcast(&wq->cond);
+	pthread_mutex_unlock(&wq->lock);
+}
+
+void __emu_wait(wait_queue_head_t *wq)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_nsec += 1000000;
+	if (ts.tv_nsec >= 1000000000) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000;
+	}
+
+	pthread_mutex_lock(&wq->lock);
+	pthread_cond_timedwait(&wq->cond, &wq->lock, &ts);
+	pthread_mutex_unlock(&wq->lock);
+}
+
+void init_completion(struct completion *x)
+{
+	pthread_mutex_init(&x->lock, NULL);
+	pthread_cond_init(&x->cond, NULL);
+	x->done = 0;
+}
+
+void complete(struct completion *x)
+{
+	pthread_mutex_lock(&x->lock);
+	if (x->done != UINT_MAX)
+		x->done++;
+	pthread_cond_broadcast(&x->cond);
+	pthread_mutex_unlock(&x->lock);
+}
+
+void complete_all(struct completion *x)
+{
+	pthread_mutex_lock(&x->lock);
+	x->done = UINT_MAX;
+	pthread_cond_broadcast(&x->cond);
+	pthread_mutex_unlock(&x->lock);
+}
+
+void wait_for_completion(struct completion *x)
+{
+	pthread_mutex_lock(&x->lock);
+	while (!x->done)
+		pthread_cond_wait(&x->cond, &x->lock);
+	if (x->done != UINT_MAX)
+		x->done--;
+	pthread_mutex_unlock(&x->lock);
+}
+
+/* nothing signals the emulated tasks */
+int wait_for_completion_interruptible(struct completion *x)
+{
+	wait_for_completion(x);
+
+	return 0;
+}
+
+int completion_done(struct completion *x)
+{
+	int done;
+
+	pthread_mutex_lock(&x->lock);
+	done = x->done != 0;
+	pthread_mutex_unlock(&x->lock);
+
+	return done;
+}
+
+/*********** work queues ***********/
+
+struct workqueue_struct {
+	const char *name;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	struct work_struct *head;
+	struct work_struct *running;
+	bool stop;
+	struct workqueue_struct *next;
+};
+
+/* every work queue, flushed by emu_settle */
+static struct workqueue_struct *emu_workqueues;
+static pthread_mutex_t emu_workqueues_lock = PTHREAD_MUTEX_INITIALIZER;
+
+struct workqueue_struct *system_freezable_wq;
+struct workqueue_struct *system_wq;
+struct workqueue_struct *system_unbound_wq;
+
+static void *emu_worker(void *arg)
+{
+	struct workqueue_struct *wq = arg;
+	struct work_struct *work;
+
+	pthread_mutex_lock(&wq->lock);
+	while (!wq->stop || wq->head) {
+		if (!wq->head) {
+			pthread_cond_wait(&wq->cond, &wq->lock);
+			continue;
+		}
+
+		work = wq->head;
+		wq->head = work->next;
+		work->pending = false;
+		wq->running = work;
+		pthread_mutex_unlock(&wq->lock);
+		work->func(work);
+		pthread_mutex_lock(&wq->lock);
+		wq->running = NULL;
+		pthread_cond_broadcast(&wq->cond);
+	}
+	pthread_mutex_unlock(&wq->lock);
+
+	return NULL;
+}
+
+static struct workqueue_struct *emu_workqueue_create(const char *name)
+{
+	struct workqueue_struct *wq = calloc(1, sizeof(*wq));
+
+	if (!wq)
+		return NULL;
+
+	wq->name = name;
+	pthread_mutex_init(&wq->lock, NULL);
+	pthread_cond_init(&wq->cond, NULL);
+	if (pthread_create(&wq->thread, NULL, emu_worker, wq)) {
+		free(wq);
+		return NULL;
+	}
+
+	pthread_mutex_lock(&emu_workqueues_lock);
+	wq->next = emu_workqueues;
+	emu_workqueues = wq;
+	pthread_mutex_unlock(&emu_workqueues_lock);
+
+	return wq;
+}
+
+struct workqueue_struct *alloc_ordered_workqueue(const char *name,
+		unsigned int flags, ...)
+{
+	struct workqueue_struct *wq = emu_workqueue_create(name);
+
+	return emu_counted(wq);
+}
+
+void flush_workqueue(struct workqueue_struct *wq)
+{
+	pthread_mutex_lock(&wq->lock);
+	while (wq->head || wq->running)
+		pthread_cond_wait(&wq->cond, &wq->lock);
+	pthread_mutex_unlock(&wq->lock);
+}
+
+static void emu_workqueue_stop(struct workqueue_struct *wq)
+{
+	struct workqueue_struct **p;
+
+	pthread_mutex_lock(&emu_workqueues_lock);
+	for (p = &emu_workqueues; *p; p = &(*p)->next) {
+		if (*p == wq) {
+			*p = wq->next;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&emu_workqueues_lock);
+
+	pthread_mutex_lock(&wq->lock);
+	wq->stop = true;
+	pthread_cond_broadcast(&wq->cond);
+	pthread_mutex_unlock(&wq->lock);
+	pthread_join(wq->thread, NULL);
+}
+
+void destroy_workqueue(struct workqueue_struct *wq)
+{
+	emu_workqueue_stop(wq);
+	kfree(wq);
+}
+
+int queue_work(struct workqueue_struct *wq, struct work_struct *work)
+{
+	struct work_struct **p;
+
+	pthread_mutex_lock(&wq->lock);
+	if (work->pending) {
+		pthread_mutex_unlock(&wq->lock);
+		return 0;
+	}
+
+	work->pending = true;
+	work->wq = wq;
+	work->next = NULL;
+	for (p = &wq->head; *p; p = &(*p)->next)
+		;
+	*p = work;
+	pthread_cond_broadcast(&wq->cond);
+	pthread_mutex_unlock(&wq->lock);
+
+	return 1;
+}
+
+int cancel_work_sync(struct work_struct *work)
+{
+	struct workqueue_struct *wq = work->wq;
+	struct work_struct **p;
+	int ret = 0;
+
+	if (!wq)
+		return 0;
+
+	pthread_mutex_lock(&wq->lock);
+	if (work->pending) {
+		for (p = &wq->head; *p; p = &(*p)->next) {
+			if (*p == work) {
+				*p = work->next;
+				break;
+			}
+		}
+		work->pending = false;
+		ret = 1;
+	}
+	while (wq->running == work)
+		pthread_cond_wait(&wq->cond, &wq->lock);
+	pthread_mutex_unlock(&wq->lock);
+
+	return ret;
+}
+
+void flush_work(struct work_struct *work)
+{
+	struct workqueue_struct *wq = work->wq;
+
+	if (!wq)
+		return;
+
+	pthread_mutex_lock(&wq->lock);
+	while (work->pending || wq->running == work)
+		pthread_cond_wait(&wq->cond, &wq->lock);
+	pthread_mutex_unlock(&wq->lock);
+}
+
+/*********** async ***********/
+
+struct emu_async {
+	async_func_ptr *fn;
+	void *data;
+	async_cookie_t cookie;
+	struct async_domain *domain;
+};
+
+static async_cookie_t emu_async_cookie;
+
+/*
+ * PF_USED_ASYNC: from 3.8 do_init_module() waits for every async call
+ * when the init task scheduled one
+ */
+static __thread bool emu_used_async;
+static pthread_mutex_t emu_async_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t emu_async_cond = PTHREAD_COND_INITIALIZER;
+static unsigned int emu_async_running;
+
+static void *emu_async_run(void *arg)
+{
+	struct emu_async *a = arg;
+	struct async_domain *domain = a->domain;
+
+	a->fn(a->data, a->cookie);
+	free(a);
+
+	pthread_mutex_lock(&domain->lock);
+	domain->running--;
+	pthread_cond_broadcast(&domain->cond);
+	pthread_mutex_unlock(&domain->lock);
+
+	pthread_mutex_lock(&emu_async_lock);
+	emu_async_running--;
+	pthread_cond_broadcast(&emu_async_cond);
+	pthread_mutex_unlock(&emu_async_lock);
+
+	return NULL;
+}
+
+async_cookie_t async_schedule_domain(async_func_ptr *fn, void *data,
+		struct async_domain *domain)
+{
+	struct emu_async *a = malloc(sizeof(*a));
+	async_cookie_t cookie;
+	pthread_attr_t attr;
+	pthread_t thread;
+
+	/* a belongs to the thread once started */
+	cookie = __atomic_add_fetch(&emu_async_cookie, 1, __ATOMIC_SEQ_CST);
+	a->fn = fn;
+	a->data = data;
+	a->cookie = cookie;
+	a->domain = domain;
+
+	pthread_mutex_lock(&domain->lock);
+	domain->running++;
+	pthread_mutex_unlock(&domain->lock);
+
+	pthread_mutex_lock(&emu_async_lock);
+	emu_async_running++;
+	pthread_mutex_unlock(&emu_async_lock);
+	emu_used_async = true;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	if (pthread_create(&thread, &attr, emu_async_run, a)) {
+		/* synchronous fallback, as the kernel on allocation failure */
+		pthread_attr_destroy(&attr);
+		emu_async_run(a);
+		return cookie;
+	}
+	pthread_attr_destroy(&attr);
+
+	return cookie;
+}
+
+void async_synchronize_full_domain(struct async_domain *domain)
+{
+	pthread_mutex_lock(&domain->lock);
+	while (domain->running)
+		pthread_cond_wait(&domain->cond, &domain->lock);
+	pthread_mutex_unlock(&domain->lock);
+}
+
+void async_synchronize_full(void)
+{
+	pthread_mutex_lock(&emu_async_lock);
+	while (emu_async_running)
+		pthread_cond_wait(&emu_async_cond, &emu_async_lock);
+	pthread_mutex_unlock(&emu_async_lock);
+}
+
+int emu_module_init(int (*init)(void))
+{
+	int ret;
+
+	emu_used_async = false;
+	ret = init();
+	if (!ret && emu_used_async)
+		async_synchronize_full();
+
+	return ret;
+}
+
+/*********** rcu ***********/
+
+static pthread_rwlock_t emu_rcu = PTHREAD_RWLOCK_INITIALIZER;
+
+void rcu_read_lock(void)
+{
+	pthread_rwlock_rdlock(&emu_rcu);
+}
+
+void rcu_read_unlock(void)
+{
+	pthread_rwlock_unlock(&emu_rcu);
+}
+
+/* the readers running when called are gone once the write lock is taken */
+void synchronize_rcu(void)
+{
+	pthread_rwlock_wrlock(&emu_rcu);
+	pthread_rwlock_unlock(&emu_rcu);
+}
+
+/*********** sysfs ***********/
+
+#define EMU_SYSFS_FILES	128
+static struct emu_sysfs_file {
+	struct device *dev;
+	struct device_attribute *attr;
+	unsigned long notified;
+} emu_sysfs[EMU_SYSFS_FILES];
+static pthread_mutex_t emu_sysfs_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* emu_sysfs_lock held */
+static struct emu_sysfs_file *emu_sysfs_lookup(struct device *dev,
+		const char *name)
+{
+	unsigned int i;
+
+	for (i = 0; i < EMU_SYSFS_FILES; i++) {
+		if (emu_sysfs[i].attr && (!dev || emu_sysfs[i].dev == dev) &&
+				!strcmp(emu_sysfs[i].attr->attr.name, name))
+			return &emu_sysfs[i];
+	}
+
+	return NULL;
+}
+
+int device_create_file(struct device *dev, const struct device_attribute *a)
+{
+	unsigned int i;
+	int ret = -ENOSPC;
+
+	pthread_mutex_lock(&emu_sysfs_lock);
+	if (emu_sysfs_lookup(dev, a->attr.name)) {
+		fprintf(stderr, "sysfs: duplicate file %s\n", a->attr.name);
+		ret = -EEXIST;
+		goto out;
+	}
+
+	for (i = 0; i < EMU_SYSFS_FILES; i++) {
+		if (!emu_sysfs[i].attr) {
+			emu_sysfs[i].dev = dev;
+			emu_sysfs[i].attr = (struct device_attribute *) a;
+			emu_sysfs[i].notified = 0;
+			ret = 0;
+			break;
+		}
+	}
+out:
+	pthread_mutex_unlock(&emu_sysfs_lock);
+
+	return ret;
+}
+
+void device_remove_file(struct device *dev, const struct device_attribute *a)
+{
+	unsigned int i;
+
+	pthread_mutex_lock(&emu_sysfs_lock);
+	for (i = 0; i < EMU_SYSFS_FILES; i++) {
+		if (emu_sysfs[i].attr == a && emu_sysfs[i].dev == dev)
+			emu_sysfs[i].attr = NULL;
+	}
+	pthread_mutex_unlock(&emu_sysfs_lock);
+}
+
+int sysfs_create_group(struct kobject *kobj, const struct attribute_group *g)
+{
+	struct device *dev = container_of(kobj, struct device, kobj);
+	struct attribute **a;
+	int ret;
+
+	for (a = g->attrs; *a; a++) {
+		ret = device_create_file(dev,
+			container_of(*a, struct device_attribute, attr));
+		if (ret) {
+			while (a-- != g->attrs)
+				device_remove_file(dev, container_of(*a,
+					struct device_attribute, attr));
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+void sysfs_remove_group(struct kobject *kobj, const struct attribute_group *g)
+{
+	struct device *dev = container_of(kobj, struct device, kobj);
+	struct attribute **a;
+
+	for (a = g->attrs; *a; a++)
+		device_remove_file(dev,
+			container_of(*a, struct device_attribute, attr));
+}
+
+void sysfs_notify(struct kobject *kobj, const char *dir, const char *attr)
+{
+	struct device *dev = container_of(kobj, struct device, kobj);
+	struct emu_sysfs_file *f;
+
+	pthread_mutex_lock(&emu_sysfs_lock);
+	f = emu_sysfs_lookup(dev, attr);
+	if (f)
+		f->notified++;
+	pthread_mutex_unlock(&emu_sysfs_lock);
+}
+
+int kobject_uevent_env(struct kobject *kobj, enum kobject_action action,
+		char *envp[])
+{
+	return 0;
+}
+
+const char *dev_name(const struct device *dev)
+{
+	return dev->init_name ? dev->init_name : "emu";
+}
+
+struct device_attribute *emu_sysfs_find(const char *name,
+		struct device **dev)
+{
+	struct emu_sysfs_file *f;
+	struct device_attribute *attr = NULL;
+
+	pthread_mutex_lock(&emu_sysfs_lock);
+	f = emu_sysfs_lookup(NULL, name);
+	if (f) {
+		attr = f->attr;
+		if (dev)
+			*dev = f->dev;
+	}
+	pthread_mutex_unlock(&emu_sysfs_lock);
+
+	return attr;
+}
+
+ssize_t emu_sysfs_show(const char *name, char *buffer)
+{
+	struct device *dev;
+	struct device_attribute *attr = emu_sysfs_find(name, &dev);
+
+	if (!attr)
+		return -ENOENT;
+	if (!attr->show || !(attr->attr.mode & S_IRUGO))
+		return -EACCES;
+
+	memset(buffer, 0, PAGE_SIZE);
+	return attr->show(dev, attr, buffer);
+}
+
+ssize_t emu_sysfs_store(const char *name, const char *buffer, size_t count)
+{
+	struct device *dev;
+	struct device_attribute *attr = emu_sysfs_find(name, &dev);
+	char page[PAGE_SIZE];
+
+	if (!attr)
+		return -ENOENT;
+	if (!attr->store || !(attr->attr.mode & S_IWUGO))
+		return -EACCES;
+	if (count >= PAGE_SIZE)
+		return -EINVAL;
+
+	/* sysfs hands a NUL terminated page to the store */
+	memcpy(page, buffer, count);
+	page[count] = '\0';
+
+	return attr->store(dev, attr, page, count);
+}
+
+unsigned int emu_sysfs_list(const char **names, unsigned int max)
+{
+	unsigned int i, n = 0;
+
+	pthread_mutex_lock(&emu_sysfs_lock);
+	for (i = 0; i < EMU_SYSFS_FILES && n < max; i++) {
+		if (emu_sysfs[i].attr)
+			names[n++] = emu_sysfs[i].attr->attr.name;
+	}
+	pthread_mutex_unlock(&emu_sysfs_lock);
+
+	return n;
+}
+
+unsigned long emu_sysfs_notified(const char *name)
+{
+	struct emu_sysfs_file *f;
+	unsigned long n = 0;
+
+	pthread_mutex_lock(&emu_sysfs_lock);
+	f = emu_sysfs_lookup(NULL, name);
+	if (f)
+		n = f->notified;
+	pthread_mutex_unlock(&emu_sysfs_lock);
+
+	return n;
+}
+
+/*********** platform devices ***********/
+
+#define EMU_PLATFORM_DRIVERS	4
+static struct platform_driver *emu_pdrivers[EMU_PLATFORM_DRIVERS];
+static struct platform_device *emu_pdevice;
+
+int platform_driver_register(struct platform_driver *drv)
+{
+	unsigned int i;
+
+	for (i = 0; i < EMU_PLATFORM_DRIVERS; i++) {
+		if (!emu_pdrivers[i]) {
+			emu_pdrivers[i] = drv;
+			return 0;
+		}
+	}
+
+	return -ENOSPC;
+}
+
+void platform_driver_unregister(struct platform_driver *drv)
+{
+	unsigned int i;
+
+	for (i = 0; i < EMU_PLATFORM_DRIVERS; i++) {
+		if (emu_pdrivers[i] == drv)
+			emu_pdrivers[i] = NULL;
+	}
+}
+
+struct platform_device *platform_device_alloc(const char *name, int id)
+{
+	struct platform_device *pdev = kzalloc(sizeof(*pdev), GFP_KERNEL);
+
+	if (pdev) {
+		pdev->name = name;
+		pdev->id = id;
+		pdev->dev.init_name = name;
+		pdev->dev.kobj.name = name;
+	}
+
+	return pdev;
+}
+
+int platform_device_add(struct platform_device *pdev)
+{
+	unsigned int i;
+
+	emu_pdevice = pdev;
+	for (i = 0; i < EMU_PLATFORM_DRIVERS; i++) {
+		struct platform_driver *drv = emu_pdrivers[i];
+
+		if (!drv || strcmp(drv->driver.name, pdev->name))
+			continue;
+
+		pdev->dev.driver = &drv->driver;
+		/* as the driver core, a failed probe leaves it unbound */
+		if (drv->probe && drv->probe(pdev))
+			pdev->dev.driver = NULL;
+		break;
+	}
+
+	return 0;
+}
+
+void platform_device_put(struct platform_device *pdev)
+{
+	if (emu_pdevice == pdev)
+		emu_pdevice = NULL;
+	kfree(pdev);
+}
+
+void platform_device_unregister(struct platform_device *pdev)
+{
+	platform_device_put(pdev);
+}
+
+/*********** misc devices and files ***********/
+
+#define EMU_MISC_DEVICES	4
+static struct miscdevice *emu_misc[EMU_MISC_DEVICES];
+
+int misc_register(struct miscdevice *misc)
+{
+	unsigned int i;
+
+	for (i = 0; i < EMU_MISC_DEVICES; i++) {
+		if (!emu_misc[i]) {
+			emu_misc[i] = misc;
+			return 0;
+		}
+	}
+
+	return -EBUSY;
+}
+
+int misc_deregister(struct miscdevice *misc)
+{
+	unsigned int i;
+
+	for (i = 0; i < EMU_MISC_DEVICES; i++) {
+		if (emu_misc[i] == misc)
+			emu_misc[i] = NULL;
+	}
+
+	return 0;
+}
+
+const struct file_operations *emu_misc_find(const char *name)
+{
+	unsigned int i;
+
+	for (i = 0; i < EMU_MISC_DEVICES; i++) {
+		if (emu_misc[i] && !strcmp(emu_misc[i]->name, name))
+			return emu_misc[i]->fops;
+	}
+
+	return NULL;
+}
+
+loff_t noop_llseek(struct file *file, loff_t offset, int whence)
+{
+	return file->f_pos;
+}
+
+int remap_vmalloc_range(struct vm_area_struct *vma, void *addr,
+		unsigned long pgoff)
+{
+	return 0;
+}
+
+int fasync_helper(int fd, struct file *file, int on,
+		struct fasync_struct **fa)
+{
+	return 0;
+}
+
+void kill_fasync(struct fasync_struct **fa, int sig, int band)
+{
+}
+
+/*********** seq_file and debugfs ***********/
+
+int seq_printf(struct seq_file *m, const char *fmt, ...)
+{
+	va_list ap;
+	int len;
+
+	for (;;) {
+		va_start(ap, fmt);
+		len = vsnprintf(m->buf + m->count, m->size - m->count, fmt, ap);
+		va_end(ap);
+		if (m->count + len < m->size)
+			break;
+
+		m->size *= 2;
+		m->buf = realloc(m->buf, m->size);
+	}
+	m->count += len;
+
+	return 0;
+}
+
+int seq_puts(struct seq_file *m, const char *s)
+{
+	return seq_printf(m, "%s", s);
+}
+
+int single_open(struct file *file, int (*show)(struct seq_file *, void *),
+		void *data)
+{
+	struct seq_file *m = calloc(1, sizeof(*m));
+
+	if (!m)
+		return -ENOMEM;
+
+	m->size = PAGE_SIZE;
+	m->buf = malloc(m->size);
+	m->private = data;
+	m->show = show;
+	file->private_data = m;
+
+	return 0;
+}
+
+int single_release(struct inode *inode, struct file *file)
+{
+	struct seq_file *m = file->private_data;
+
+	free(m->buf);
+	free(m);
+
+	return 0;
+}
+
+ssize_t seq_read(struct file *file, char __user *buf, size_t size,
+		loff_t *ppos)
+{
+	struct seq_file *m = file->private_data;
+	size_t n;
+
+	/* the whole file is produced by the first read */
+	if (!*ppos) {
+		m->count = 0;
+		m->buf[0] = '\0';
+		m->show(m, NULL);
+	}
+
+	if (*ppos >= (loff_t) m->count)
+		return 0;
+
+	n = min(size, m->count - (size_t) *ppos);
+	memcpy(buf, m->buf + *ppos, n);
+	*ppos += n;
+
+	return n;
+}
+
+loff_t seq_lseek(struct file *file, loff_t offset, int whence)
+{
+	file->f_pos = offset;
+	return offset;
+}
+
+#define EMU_DEBUGFS_FILES	32
+static struct emu_debugfs_file {
+	struct dentry dentry;
+	struct inode inode;
+	struct dentry *parent;
+	const char *name;
+	const struct file_operations *fops;
+	bool used;
+} emu_debugfs[EMU_DEBUGFS_FILES];
+
+static struct dentry *emu_debugfs_add(const char *name, struct dentry *parent,
+		void *data, const struct file_operations *fops)
+{
+	unsigned int i;
+
+	for (i = 0; i < EMU_DEBUGFS_FILES; i++) {
+		struct emu_debugfs_file *f = &emu_debugfs[i];
+
+		if (f->used)
+			continue;
+
+		memset(f, 0, sizeof(*f));
+		f->used = true;
+		f->name = name;
+		f->parent = parent;
+		f->fops = fops;
+		f->inode.i_private = data;
+		f->dentry.d_inode = &f->inode;
+		return &f->dentry;
+	}
+
+	return NULL;
+}
+
+struct dentry *debugfs_create_dir(const char *name, struct dentry *parent)
+{
+	return emu_debugfs_add(name, parent, NULL, NULL);
+}
+
+struct dentry *debugfs_create_file(const char *name, umode_t mode,
+		struct dentry *parent, void *data,
+		const struct file_operations *fops)
+{
+	return emu_debugfs_add(name, parent, data, fops);
+}
+
+void debugfs_remove_recursive(struct dentry *dentry)
+{
+	unsigned int i;
+
+	if (!dentry)
+		return;
+
+	for (i = 0; i < EMU_DEBUGFS_FILES; i++) {
+		if (emu_debugfs[i].used && emu_debugfs[i].parent == dentry)
+			debugfs_remove_recursive(&emu_debugfs[i].dentry);
+	}
+	container_of(dentry, struct emu_debugfs_file, dentry)->used = false;
+}
+
+static struct emu_debugfs_file *emu_debugfs_find(const char *name)
+{
+	unsigned int i;
+
+	for (i = 0; i < EMU_DEBUGFS_FILES; i++) {
+		if (emu_debugfs[i].used && emu_debugfs[i].fops &&
+				!strcmp(emu_debugfs[i].name, name))
+			return &emu_debugfs[i];
+	}
+
+	return NULL;
+}
+
+ssize_t emu_debugfs_read(const char *name, char *buffer, size_t size)
+{
+	struct emu_debugfs_file *f = emu_debugfs_find(name);
+	struct file file = { 0 };
+	size_t len = 0;
+	ssize_t n;
+	int ret;
+
+	if (!f)
+		return -ENOENT;
+	if (!f->fops->read)
+		return -EACCES;
+
+	if (f->fops->open) {
+		ret = f->fops->open(&f->inode, &file);
+		if (ret)
+			return ret;
+	}
+
+	while (len + 1 < size) {
+		n = f->fops->read(&file, buffer + len, size - len - 1,
+				&file.f_pos);
+		if (n <= 0)
+			break;
+		len += n;
+	}
+	buffer[len] = '\0';
+
+	if (f->fops->release)
+		f->fops->release(&f->inode, &file);
+
+	return len;
+}
+
+ssize_t emu_debugfs_write(const char *name, const char *buffer, size_t count)
+{
+	struct emu_debugfs_file *f = emu_debugfs_find(name);
+	struct file file = { 0 };
+	ssize_t ret;
+
+	if (!f)
+		return -ENOENT;
+	if (!f->fops->write)
+		return -EACCES;
+
+	if (f->fops->open) {
+		ret = f->fops->open(&f->inode, &file);
+		if (ret)
+			return ret;
+	}
+	ret = f->fops->write(&file, buffer, count, &file.f_pos);
+	if (f->fops->release)
+		f->fops->release(&f->inode, &file);
+
+	return ret;
+}
+
+/*********** power management ***********/
+
+static struct notifier_block *emu_pm_notifiers;
+
+int register_pm_notifier(struct notifier_block *nb)
+{
+	nb->next = emu_pm_notifiers;
+	emu_pm_notifiers = nb;
+	return 0;
+}
+
+int unregister_pm_notifier(struct notifier_block *nb)
+{
+	struct notifier_block **p;
+
+	for (p = &emu_pm_notifiers; *p; p = &(*p)->next) {
+		if (*p == nb) {
+			*p = nb->next;
+			break;
+		}
+	}
+
+	return 0;
+}
+
+static void emu_pm_notify(unsigned long event)
+{
+	struct notifier_block *nb;
+
+	for (nb = emu_pm_notifiers; nb; nb = nb->next)
+		nb->notifier_call(nb, event, NULL);
+}
+
+/*********** input ***********/
+
+#define EMU_INPUT_EVENTS	1024
+static struct emu_input_event emu_input_log[EMU_INPUT_EVENTS];
+static unsigned int emu_input_head, emu_input_tail;
+static pthread_mutex_t emu_input_lock = PTHREAD_MUTEX_INITIALIZER;
+
+struct input_dev *input_allocate_device(void)
+{
+	return kzalloc(sizeof(struct input_dev), GFP_KERNEL);
+}
+
+void input_free_device(struct input_dev *dev)
+{
+	kfree(dev);
+}
+
+int input_register_device(struct input_dev *dev)
+{
+	return 0;
+}
+
+void input_unregister_device(struct input_dev *dev)
+{
+	/* the last reference goes with the registration */
+	kfree(dev);
+}
+
+void input_set_capability(struct input_dev *dev, unsigned int type,
+		unsigned int code)
+{
+	switch (type) {
+	case EV_KEY:
+		__set_bit(code, dev->keybit);
+		break;
+	case EV_REL:
+		__set_bit(code, dev->relbit);
+		break;
+	case EV_MSC:
+		__set_bit(code, dev->mscbit);
+		break;
+	}
+	__set_bit(type, dev->evbit);
+}
+
+/* the synchronization and scan code events are not checked */
+void input_event(struct input_dev *dev, unsigned int type,
+		unsigned int code, int value)
+{
+	struct emu_input_event *e;
+
+	if (type == EV_SYN || type == EV_MSC)
+		return;
+
+	pthread_mutex_lock(&emu_input_lock);
+	if (emu_input_head - emu_input_tail == EMU_INPUT_EVENTS)
+		emu_input_tail++;
+	e = &emu_input_log[emu_input_head++ % EMU_INPUT_EVENTS];
+	e->dev = dev->name;
+	e->type = type;
+	e->code = code;
+	e->value = value;
+	pthread_mutex_unlock(&emu_input_lock);
+
+	if (emu_verbose > 1)
+		fprintf(stderr, "[input] %s: type %u code %u value %d\n",
+				dev->name, type, code, value);
+}
+
+/* drops the events logged before the first match */
+int emu_input_take(unsigned int type, unsigned int code, int value)
+{
+	unsigned int i;
+	int found = 0;
+
+	pthread_mutex_lock(&emu_input_lock);
+	for (i = emu_input_tail; i != emu_input_head; i++) {
+		struct emu_input_event *e =
+			&emu_input_log[i % EMU_INPUT_EVENTS];
+
+		if (e->type == type && e->code == code && e->value == value) {
+			emu_input_tail = i + 1;
+			found = 1;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&emu_input_lock);
+
+	return found;
+}
+
+unsigned int emu_input_pending(void)
+{
+	unsigned int n;
+
+	pthread_mutex_lock(&emu_input_lock);
+	n = emu_input_head - emu_input_tail;
+	pthread_mutex_unlock(&emu_input_lock);
+
+	return n;
+}
+
+void emu_input_flush(void)
+{
+	pthread_mutex_lock(&emu_input_lock);
+	emu_input_tail = emu_input_head;
+	pthread_mutex_unlock(&emu_input_lock);
+}
+
+/*********** backlight and rfkill ***********/
+
+static struct backlight_device *emu_bl;
+
+struct backlight_device *backlight_device_register(const char *name,
+		struct device *parent, void *devdata,
+		const struct backlight_ops *ops,
+		const struct backlight_properties *props)
+{
+	struct backlight_device *bd = kzalloc(sizeof(*bd), GFP_KERNEL);
+
+	if (!bd)
+		return ERR_PTR(-ENOMEM);
+
+	bd->ops = ops;
+	bd->props = *props;
+	emu_bl = bd;
+
+	return bd;
+}
+
+void backlight_device_unregister(struct backlight_device *bd)
+{
+	if (!bd)
+		return;
+	if (emu_bl == bd)
+		emu_bl = NULL;
+	kfree(bd);
+}
+
+struct backlight_device *emu_backlight(void)
+{
+	return emu_bl;
+}
+
+struct rfkill {
+	const char *name;
+	enum rfkill_type type;
+	const struct rfkill_ops *ops;
+	void *data;
+	bool sw;
+	bool hw;
+	bool registered;
+};
+
+#define EMU_RFKILLS	8
+static struct rfkill *emu_rfkills[EMU_RFKILLS];
+
+struct rfkill *rfkill_alloc(const char *name, struct device *parent,
+		enum rfkill_type type, const struct rfkill_ops *ops,
+		void *data)
+{
+	struct rfkill *rfk = kzalloc(sizeof(*rfk), GFP_KERNEL);
+
+	if (!rfk)
+		return NULL;
+
+	rfk->name = name;
+	rfk->type = type;
+	rfk->ops = ops;
+	rfk->data = data;
+
+	return rfk;
+}
+
+int rfkill_register(struct rfkill *rfkill)
+{
+	unsigned int i;
+
+	for (i = 0; i < EMU_RFKILLS; i++) {
+		if (!emu_rfkills[i]) {
+			emu_rfkills[i] = rfkill;
+			rfkill->registered = true;
+			/* the core applies the initial state */
+			return rfkill->ops->set_block(rfkill->data, rfkill->sw);
+		}
+	}
+
+	return -ENOSPC;
+}
+
+void rfkill_unregister(struct rfkill *rfkill)
+{
+	unsigned int i;
+
+	for (i = 0; i < EMU_RFKILLS; i++) {
+		if (emu_rfkills[i] == rfkill)
+			emu_rfkills[i] = NULL;
+	}
+	rfkill->registered = false;
+}
+
+void rfkill_destroy(struct rfkill *rfkill)
+{
+	kfree(rfkill);
+}
+
+bool rfkill_set_sw_state(struct rfkill *rfkill, bool blocked)
+{
+	rfkill->sw = blocked;
+	return blocked || rfkill->hw;
+}
+
+bool rfkill_set_hw_state(struct rfkill *rfkill, bool blocked)
+{
+	rfkill->hw = blocked;
+	return blocked || rfkill->sw;
+}
+
+void rfkill_init_sw_state(struct rfkill *rfkill, bool blocked)
+{
+	rfkill->sw = blocked;
+}
+
+void rfkill_set_states(struct rfkill *rfkill, bool sw, bool hw)
+{
+	rfkill->sw = sw;
+	rfkill->hw = hw;
+}
+
+int emu_rfkill_state(const char *name, bool *sw, bool *hw)
+{
+	unsigned int i;
+
+	for (i = 0; i < EMU_RFKILLS; i++) {
+		if (emu_rfkills[i] && !strcmp(emu_rfkills[i]->name, name)) {
+			*sw = emu_rfkills[i]->sw;
+			*hw = emu_rfkills[i]->hw;
+			return 0;
+		}
+	}
+
+	return -ENOENT;
+}
+
+/*********** ACPI ***********/
+
+#define EMU_ACPI_EVENTS	256
+static struct {
+	u8 type;
+	int data;
+} emu_acpi_log[EMU_ACPI_EVENTS];
+static unsigned int emu_acpi_head, emu_acpi_tail;
+static pthread_mutex_t emu_acpi_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* the emulated SNC device and the driver bound to it */
+static struct acpi_device emu_snc_device;
+static struct acpi_driver *emu_snc_driver;
+
+acpi_status acpi_get_handle(acpi_handle parent, acpi_string name,
+		acpi_handle *handle)
+{
+	return snc_emu_get_handle(parent, name, handle);
+}
+
+acpi_status acpi_get_object_info(acpi_handle handle,
+		struct acpi_device_info **info)
+{
+	return AE_NOT_FOUND;
+}
+
+acpi_status acpi_walk_namespace(acpi_object_type type, acpi_handle start,
+		u32 depth, acpi_walk_callback pre, acpi_walk_callback post,
+		void *context, void **ret)
+{
+	return AE_OK;
+}
+
+int acpi_video_backlight_support(void)
+{
+	return emu_video_backlight;
+}
+
+acpi_status acpi_walk_resources(acpi_handle handle, char *name,
+		acpi_walk_resource_callback cb, void *context)
+{
+	return AE_NOT_FOUND;
+}
+
+acpi_status acpi_set_current_resources(acpi_handle handle,
+		struct acpi_buffer *buffer)
+{
+	return AE_ERROR;
+}
+
+static int emu_acpi_match(struct acpi_driver *driver, const char *hid)
+{
+	const struct acpi_device_id *id;
+
+	for (id = driver->ids; id->id[0]; id++) {
+		if (!strcmp(id->id, hid))
+			return 1;
+	}
+
+	return 0;
+}
+
+int acpi_bus_register_driver(struct acpi_driver *driver)
+{
+	if (!emu_acpi_match(driver, "SNY5001") || !snc_emu_device())
+		return 0;
+
+	memset(&emu_snc_device, 0, sizeof(emu_snc_device));
+	emu_snc_device.handle = snc_emu_device();
+	emu_snc_device.dev.init_name = "SNY5001:00";
+	strcpy(emu_snc_device.pnp.bus_id, "SNC");
+
+	/* the registration succeeds whatever the add returns */
+	if (!driver->ops.add(&emu_snc_device))
+		emu_snc_driver = driver;
+
+	return 0;
+}
+
+void acpi_bus_unregister_driver(struct acpi_driver *driver)
+{
+	if (driver != emu_snc_driver)
+		return;
+
+	driver->ops.remove(&emu_snc_device, 0);
+	emu_snc_driver = NULL;
+}
+
+int acpi_bus_get_status(struct acpi_device *device)
+{
+	device->status.present = 1;
+	device->status.enabled = 1;
+	device->status.functional = 1;
+
+	return 0;
+}
+
+int acpi_bus_generate_proc_event(struct acpi_device *device, u8 type,
+		int data)
+{
+	pthread_mutex_lock(&emu_acpi_lock);
+	if (emu_acpi_head - emu_acpi_tail == EMU_ACPI_EVENTS)
+		emu_acpi_tail++;
+	emu_acpi_log[emu_acpi_head % EMU_ACPI_EVENTS].type = type;
+	emu_acpi_log[emu_acpi_head % EMU_ACPI_EVENTS].data = data;
+	emu_acpi_head++;
+	pthread_mutex_unlock(&emu_acpi_lock);
+
+	return 0;
+}
+
+int acpi_bus_generate_netlink_event(const char *class, const char *bid,
+		u8 type, int data)
+{
+	return 0;
+}
+
+int emu_acpi_event_take(u8 type, int data)
+{
+	unsigned int i;
+	int found = 0;
+
+	pthread_mutex_lock(&emu_acpi_lock);
+	for (i = emu_acpi_tail; i != emu_acpi_head; i++) {
+		if (emu_acpi_log[i % EMU_ACPI_EVENTS].type == type &&
+				emu_acpi_log[i % EMU_ACPI_EVENTS].data == data) {
+			emu_acpi_tail = i + 1;
+			found = 1;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&emu_acpi_lock);
+
+	return found;
+}
+
+void emu_acpi_event_flush(void)
+{
+	pthread_mutex_lock(&emu_acpi_lock);
+	emu_acpi_tail = emu_acpi_head;
+	pthread_mutex_unlock(&emu_acpi_lock);
+}
+
+int emu_acpi_bound(const char *hid)
+{
+	return !strcmp(hid, "SNY5001") && emu_snc_driver;
+}
+
+void emu_acpi_notify(u32 event)
+{
+	if (emu_snc_driver && emu_snc_driver->ops.notify)
+		emu_snc_driver->ops.notify(&emu_snc_device, event);
+}
+
+int emu_suspend(void)
+{
+	pm_message_t state = { 0 };
+	int ret = 0;
+
+	emu_pm_notify(PM_SUSPEND_PREPARE);
+	if (emu_snc_driver && emu_snc_driver->ops.suspend)
+		ret = emu_snc_driver->ops.suspend(&emu_snc_device, state);
+
+	return ret;
+}
+
+/* the platform device resumes first, as it is a child of the SNC */
+int emu_resume(void)
+{
+	const struct dev_pm_ops *pm = NULL;
+	int ret = 0;
+
+	if (emu_pdevice && emu_pdevice->dev.driver)
+		pm = emu_pdevice->dev.driver->pm;
+	if (pm && pm->resume_noirq)
+		pm->resume_noirq(&emu_pdevice->dev);
+	if (emu_snc_driver && emu_snc_driver->ops.resume)
+		ret = emu_snc_driver->ops.resume(&emu_snc_device);
+	if (pm && pm->resume)
+		pm->resume(&emu_pdevice->dev);
+	emu_pm_notify(PM_POST_SUSPEND);
+
+	return ret;
+}
+
+/*********** setup ***********/
+
+/* the queues are not destroyed while the harness settles */
+void emu_settle(void)
+{
+	struct workqueue_struct *wq;
+
+	emu_timers_settle();
+	pthread_mutex_lock(&emu_workqueues_lock);
+	for (wq = emu_workqueues; wq; wq = wq->next)
+		flush_workqueue(wq);
+	pthread_mutex_unlock(&emu_workqueues_lock);
+	emu_timers_settle();
+}
+
+void emu_kernel_init(void)
+{
+	system_wq = emu_workqueue_create("events");
+	system_freezable_wq = emu_workqueue_create("events_freezable");
+	system_unbound_wq = emu_workqueue_create("events_unbound");
+	if (!system_wq || !system_freezable_wq || !system_unbound_wq ||
+			pthread_create(&emu_tick_thread, NULL, emu_tick, NULL)) {
+		fprintf(stderr, "unable to start the kernel threads\n");
+		exit(2);
+	}
+}
+
+void emu_kernel_exit(void)
+{
+	pthread_mutex_lock(&emu_timer_lock);
+	emu_tick_stop = true;
+	pthread_mutex_unlock(&emu_timer_lock);
+	pthread_join(emu_tick_thread, NULL);
+
+	emu_workqueue_stop(system_unbound_wq);
+	emu_workqueue_stop(system_freezable_wq);
+	emu_workqueue_stop(system_wq);
+}
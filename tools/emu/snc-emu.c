@@ -0,0 +1,862 @@
+/*
+ * SNC/EC/SPIC emulator behind the driver backend
+ *
+ * The SNC device is described by the scenario commands:
+ *
+ *   snc                          SN00, SN01, SN02, SN03, SN05, SN06, SN07
+ *   method NAME [VALUE|=TARGET]  a value method, setting it updates its
+ *                                own value or the one of TARGET
+ *   fail NAME                    the evaluations of NAME fail
+ *   model STRING                 the SN00 0x00-0x03 string
+ *   model-id N                   SN00 0x04
+ *   events MASK                  SN00 0x10, the implemented event offsets
+ *   handles H...                 SN00 0x20+i, the handle of offset i
+ *   reply H CMD[/MASK] VALUE     SN07 (and SN06) reply of a handle command
+ *   store H CMD[/MASK] GET [SH]  CMD stores its argument >> SH (16) as
+ *                                the reply of GET
+ *   fail H CMD[/MASK]            the SN06/SN07 command fails
+ *   buffer H CMD BYTES...        SN06 buffer reply, bytes in hex
+ *   latency NAME|H USEC          delay of every evaluation of a method
+ *                                or of a handle command
+ *   ec ADDR VALUE                EC register
+ *   port ADDR VALUE              I/O port
+ *
+ * The SN07 (SN06) argument carries the handle offset in its low byte,
+ * the command is the argument with the offset cleared. A command that
+ * matches no rule returns 0 and is counted as unhandled.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#include <unistd.h>
+#include <linux/kernel.h>
+#include <linux/acpi.h>
+
+#include "emu.h"
+#include "snc-emu.h"
+
+#define SNC_EMU_METHODS		64
+#define SNC_EMU_RULES		256
+#define SNC_EMU_HANDLES		0x10
+
+enum snc_emu_kind {
+	SNC_EMU_VALUE,
+	SNC_EMU_SN00,
+	SNC_EMU_SN01,
+	SNC_EMU_SN02,
+	SNC_EMU_SN03,
+	SNC_EMU_SN05,
+	SNC_EMU_SN06,
+	SNC_EMU_SN07,
+};
+
+static struct snc_emu_method {
+	char name[48];
+	enum snc_emu_kind kind;
+	u64 value;
+	int target;		/* method set by this one, -1 for itself */
+	bool fail;
+	unsigned long latency;	/* usec */
+	unsigned long calls;
+} snc_emu_methods[SNC_EMU_METHODS];
+static unsigned int snc_emu_nmethods;
+
+enum snc_emu_rule_type {
+	SNC_EMU_REPLY,
+	SNC_EMU_STORE,
+	SNC_EMU_FAIL,
+	SNC_EMU_BUFFER,
+};
+
+static struct snc_emu_rule {
+	enum snc_emu_rule_type type;
+	unsigned int handle;
+	u32 cmd;
+	u32 mask;
+	u32 value;		/* reply, or the GET command of a store */
+	unsigned int shift;
+	u8 data[128];
+	unsigned int len;
+} snc_emu_rules[SNC_EMU_RULES];
+static unsigned int snc_emu_nrules;
+
+static struct {
+	char model[17];
+	u32 model_id;
+	u32 events;
+	bool events_set;
+	u16 handles[SNC_EMU_HANDLES];
+	unsigned long latency[SNC_EMU_HANDLES];
+	unsigned long calls[SNC_EMU_HANDLES];
+	u32 enabled;
+	unsigned long acked;
+	unsigned long unhandled;
+	u8 ec[0x100];
+	u8 port[0x10000];
+} snc_emu = {
+	.model = "SncSupported",
+};
+
+/* the namespace object of the SNC device */
+static char snc_emu_device_object;
+
+static pthread_mutex_t snc_emu_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void snc_emu_defaults(void)
+{
+	memset(&snc_emu, 0, sizeof(snc_emu));
+	strcpy(snc_emu.model, "SncSupported");
+}
+
+/*********** namespace ***********/
+
+static struct snc_emu_method *snc_emu_method_find(const char *name)
+{
+	unsigned int i;
+
+	for (i = 0; i < snc_emu_nmethods; i++) {
+		if (!strcmp(snc_emu_methods[i].name, name))
+			return &snc_emu_methods[i];
+	}
+
+	return NULL;
+}
+
+static struct snc_emu_method *snc_emu_method_add(const char *name,
+		enum snc_emu_kind kind)
+{
+	struct snc_emu_method *m = snc_emu_method_find(name);
+
+	if (!m) {
+		if (snc_emu_nmethods == SNC_EMU_METHODS ||
+				strlen(name) >= sizeof(m->name))
+			return NULL;
+		m = &snc_emu_methods[snc_emu_nmethods++];
+		strcpy(m->name, name);
+	}
+
+	m->kind = kind;
+	m->value = 0;
+	m->target = -1;
+	m->fail = false;
+
+	return m;
+}
+
+acpi_handle snc_emu_device(void)
+{
+	return snc_emu_nmethods ? &snc_emu_device_object : NULL;
+}
+
+/* methods are found by their name, relative or absolute */
+acpi_status snc_emu_get_handle(acpi_handle parent, const char *name,
+		acpi_handle *handle)
+{
+	struct snc_emu_method *m;
+
+	if (parent && parent != &snc_emu_device_object)
+		return AE_NOT_FOUND;
+
+	m = snc_emu_method_find(name);
+	if (!m)
+		return AE_NOT_FOUND;
+
+	*handle = m;
+
+	return AE_OK;
+}
+
+/*********** rules ***********/
+
+static int snc_emu_offset(unsigned int handle)
+{
+	int i;
+
+	for (i = 0; i < SNC_EMU_HANDLES; i++) {
+		if (snc_emu.handles[i] == handle)
+			return i;
+	}
+
+	return -1;
+}
+
+static struct snc_emu_rule *snc_emu_rule_find(enum snc_emu_rule_type type,
+		unsigned int handle, u32 cmd)
+{
+	unsigned int i;
+
+	for (i = 0; i < snc_emu_nrules; i++) {
+		struct snc_emu_rule *r = &snc_emu_rules[i];
+
+		if (r->type == type && r->handle == handle &&
+				(cmd & r->mask) == (r->cmd & r->mask))
+			return r;
+	}
+
+	return NULL;
+}
+
+/* the reply of an exact command, created when missing */
+static struct snc_emu_rule *snc_emu_reply_get(unsigned int handle, u32 cmd)
+{
+	struct snc_emu_rule *r;
+	unsigned int i;
+
+	for (i = 0; i < snc_emu_nrules; i++) {
+		r = &snc_emu_rules[i];
+		if (r->type == SNC_EMU_REPLY && r->handle == handle &&
+				r->cmd == cmd && r->mask == 0xffffffff)
+			return r;
+	}
+
+	if (snc_emu_nrules == SNC_EMU_RULES)
+		return NULL;
+
+	r = &snc_emu_rules[snc_emu_nrules++];
+	memset(r, 0, sizeof(*r));
+	r->type = SNC_EMU_REPLY;
+	r->handle = handle;
+	r->cmd = cmd;
+	r->mask = 0xffffffff;
+
+	return r;
+}
+
+int snc_emu_register(unsigned int handle, u32 cmd, u32 *value)
+{
+	struct snc_emu_rule *r;
+	int ret = -ENOENT;
+
+	pthread_mutex_lock(&snc_emu_lock);
+	r = snc_emu_rule_find(SNC_EMU_REPLY, handle, cmd);
+	if (r) {
+		*value = r->value;
+		ret = 0;
+	}
+	pthread_mutex_unlock(&snc_emu_lock);
+
+	return ret;
+}
+
+/*********** evaluation ***********/
+
+/* the output buffer semantics of acpi_evaluate_object */
+static acpi_status snc_emu_output(struct acpi_buffer *output,
+		acpi_object_type type, u64 value, const u8 *data, u32 len)
+{
+	acpi_size needed = sizeof(union acpi_object);
+	union acpi_object *obj;
+
+	if (!output)
+		return AE_OK;
+
+	if (type == ACPI_TYPE_BUFFER)
+		needed += len;
+
+	if (output->length == ACPI_ALLOCATE_BUFFER) {
+		output->pointer = kmalloc(needed, GFP_KERNEL);
+		if (!output->pointer)
+			return AE_NO_MEMORY;
+	} else if (output->length < needed) {
+		output->length = needed;
+		return AE_BUFFER_OVERFLOW;
+	}
+	output->length = needed;
+
+	obj = output->pointer;
+	obj->type = type;
+	if (type == ACPI_TYPE_BUFFER) {
+		obj->buffer.length = len;
+		obj->buffer.pointer = (u8 *) (obj + 1);
+		memcpy(obj->buffer.pointer, data, len);
+	} else {
+		obj->integer.value = value;
+	}
+
+	return AE_OK;
+}
+
+static int snc_emu_argument(struct acpi_object_list *params, u64 *arg)
+{
+	union acpi_object *obj;
+
+	if (!params || !params->count)
+		return -1;
+
+	obj = &params->pointer[0];
+	if (obj->type == ACPI_TYPE_INTEGER) {
+		*arg = obj->integer.value;
+		return 0;
+	}
+	if (obj->type == ACPI_TYPE_BUFFER) {
+		*arg = 0;
+		memcpy(arg, obj->buffer.pointer, min_t(u32, obj->buffer.length,
+					sizeof(*arg)));
+		return 0;
+	}
+
+	return -1;
+}
+
+/* SN06 and SN07, snc_emu_lock held */
+static acpi_status snc_emu_handle_call(enum snc_emu_kind kind, u64 arg,
+		struct acpi_buffer *output, unsigned long *latency)
+{
+	struct snc_emu_rule *r;
+	unsigned int handle;
+	int offset = arg & 0xff;
+	u32 cmd = arg & ~0xffULL;
+
+	if (offset >= SNC_EMU_HANDLES || !snc_emu.handles[offset])
+		return AE_BAD_PARAMETER;
+
+	handle = snc_emu.handles[offset];
+	snc_emu.calls[offset]++;
+	*latency += snc_emu.latency[offset];
+
+	if (snc_emu_rule_find(SNC_EMU_FAIL, handle, cmd))
+		return AE_ERROR;
+
+	r = snc_emu_rule_find(SNC_EMU_STORE, handle, cmd);
+	if (r) {
+		struct snc_emu_rule *reply = snc_emu_reply_get(handle,
+				r->value);
+
+		if (reply)
+			reply->value = cmd >> r->shift;
+		return snc_emu_output(output, ACPI_TYPE_INTEGER, 0, NULL, 0);
+	}
+
+	if (kind == SNC_EMU_SN06) {
+		r = snc_emu_rule_find(SNC_EMU_BUFFER, handle, cmd);
+		if (r)
+			return snc_emu_output(output, ACPI_TYPE_BUFFER, 0,
+					r->data, r->len);
+	}
+
+	r = snc_emu_rule_find(SNC_EMU_REPLY, handle, cmd);
+	if (r)
+		return snc_emu_output(output, ACPI_TYPE_INTEGER, r->value,
+				NULL, 0);
+
+	snc_emu.unhandled++;
+	if (emu_verbose)
+		fprintf(stderr, "[snc-emu] unhandled SN0%c handle 0x%.4x "
+				"cmd 0x%.8x\n", kind == SNC_EMU_SN06 ? '6' : '7',
+				handle, cmd);
+
+	return snc_emu_output(output, ACPI_TYPE_INTEGER, 0, NULL, 0);
+}
+
+/* SN00, snc_emu_lock held */
+static u64 snc_emu_sn00(u64 arg)
+{
+	u32 word = 0;
+
+	if (arg < 4) {
+		memcpy(&word, snc_emu.model + arg * 4, 4);
+		return word;
+	}
+	if (arg == 0x04)
+		return snc_emu.model_id;
+	if (arg == 0x10) {
+		unsigned int i;
+
+		if (snc_emu.events_set)
+			return snc_emu.events;
+		/* by default every offset with a handle has events */
+		for (i = 0; i < SNC_EMU_HANDLES; i++) {
+			if (snc_emu.handles[i])
+				word |= 1 << i;
+		}
+		return word;
+	}
+	if (arg >= 0x20 && arg < 0x20 + SNC_EMU_HANDLES)
+		return snc_emu.handles[arg - 0x20];
+
+	snc_emu.unhandled++;
+
+	return 0;
+}
+
+acpi_status snc_emu_evaluate(acpi_handle handle, char *name,
+		struct acpi_object_list *params, struct acpi_buffer *output)
+{
+	struct snc_emu_method *m;
+	unsigned long latency;
+	acpi_status status;
+	u64 arg = 0, value = 0;
+	bool has_arg;
+
+	if (name) {
+		status = snc_emu_get_handle(handle, name, &handle);
+		if (ACPI_FAILURE(status))
+			return status;
+	}
+	if (!handle || handle == &snc_emu_device_object)
+		return AE_BAD_PARAMETER;
+
+	m = handle;
+	has_arg = !snc_emu_argument(params, &arg);
+
+	pthread_mutex_lock(&snc_emu_lock);
+	m->calls++;
+	latency = m->latency;
+
+	if (m->fail) {
+		status = AE_ERROR;
+		goto out;
+	}
+
+	switch (m->kind) {
+	case SNC_EMU_SN06:
+	case SNC_EMU_SN07:
+		if (!has_arg) {
+			status = AE_BAD_PARAMETER;
+			goto out;
+		}
+		status = snc_emu_handle_call(m->kind, arg, output, &latency);
+		goto out;
+	case SNC_EMU_SN00:
+		value = snc_emu_sn00(arg);
+		break;
+	case SNC_EMU_SN01:
+		value = snc_emu.enabled;
+		break;
+	case SNC_EMU_SN02:
+		snc_emu.enabled |= arg;
+		break;
+	case SNC_EMU_SN03:
+		snc_emu.enabled &= ~arg;
+		break;
+	case SNC_EMU_SN05:
+		snc_emu.acked |= arg;
+		break;
+	case SNC_EMU_VALUE:
+		/* the multiple arguments methods (_DSM) only reply */
+		if (has_arg && params->count == 1) {
+			struct snc_emu_method *t = m->target < 0 ? m :
+				&snc_emu_methods[m->target];
+
+			t->value = arg;
+		}
+		value = m->value;
+		break;
+	}
+	status = snc_emu_output(output, ACPI_TYPE_INTEGER, value, NULL, 0);
+
+out:
+	pthread_mutex_unlock(&snc_emu_lock);
+
+	if (latency)
+		usleep(latency);
+
+	return status;
+}
+
+/*********** EC and ports ***********/
+
+int snc_emu_ec_read(u8 addr, u8 *value)
+{
+	pthread_mutex_lock(&snc_emu_lock);
+	*value = snc_emu.ec[addr];
+	pthread_mutex_unlock(&snc_emu_lock);
+
+	return 0;
+}
+
+int snc_emu_ec_write(u8 addr, u8 value)
+{
+	pthread_mutex_lock(&snc_emu_lock);
+	snc_emu.ec[addr] = value;
+	pthread_mutex_unlock(&snc_emu_lock);
+
+	return 0;
+}
+
+u8 snc_emu_inb(unsigned long port)
+{
+	u8 value;
+
+	pthread_mutex_lock(&snc_emu_lock);
+	value = snc_emu.port[port & 0xffff];
+	pthread_mutex_unlock(&snc_emu_lock);
+
+	return value;
+}
+
+void snc_emu_outb(u8 value, unsigned long port)
+{
+	pthread_mutex_lock(&snc_emu_lock);
+	snc_emu.port[port & 0xffff] = value;
+	pthread_mutex_unlock(&snc_emu_lock);
+}
+
+/*********** counters ***********/
+
+unsigned long snc_emu_calls(const char *method)
+{
+	struct snc_emu_method *m;
+	unsigned long handle, n = 0;
+	const char *sep = strchr(method, ':');
+	int offset;
+
+	if (!sep) {
+		pthread_mutex_lock(&snc_emu_lock);
+		m = snc_emu_method_find(method);
+		if (m)
+			n = m->calls;
+		pthread_mutex_unlock(&snc_emu_lock);
+		return n;
+	}
+
+	/* handle calls, SN06 and SN07 are counted together */
+	if ((strncmp(method, "SN06:", 5) && strncmp(method, "SN07:", 5)) ||
+			strict_strtoul(sep + 1, 16, &handle))
+		return 0;
+
+	pthread_mutex_lock(&snc_emu_lock);
+	offset = snc_emu_offset(handle);
+	if (offset >= 0 && handle)
+		n = snc_emu.calls[offset];
+	pthread_mutex_unlock(&snc_emu_lock);
+
+	return n;
+}
+
+void snc_emu_calls_reset(void)
+{
+	unsigned int i;
+
+	pthread_mutex_lock(&snc_emu_lock);
+	for (i = 0; i < snc_emu_nmethods; i++)
+		snc_emu_methods[i].calls = 0;
+	memset(snc_emu.calls, 0, sizeof(snc_emu.calls));
+	snc_emu.unhandled = 0;
+	pthread_mutex_unlock(&snc_emu_lock);
+}
+
+u32 snc_emu_events(void)
+{
+	u32 events;
+
+	pthread_mutex_lock(&snc_emu_lock);
+	events = snc_emu.enabled;
+	pthread_mutex_unlock(&snc_emu_lock);
+
+	return events;
+}
+
+unsigned long snc_emu_unhandled(void)
+{
+	unsigned long n;
+
+	pthread_mutex_lock(&snc_emu_lock);
+	n = snc_emu.unhandled;
+	pthread_mutex_unlock(&snc_emu_lock);
+
+	return n;
+}
+
+void snc_emu_reset(void)
+{
+	pthread_mutex_lock(&snc_emu_lock);
+	snc_emu_nmethods = 0;
+	snc_emu_nrules = 0;
+	snc_emu_defaults();
+	pthread_mutex_unlock(&snc_emu_lock);
+}
+
+/*********** scenario commands ***********/
+
+static int snc_emu_number(const char *s, unsigned long *value)
+{
+	return strict_strtoul(s, 0, value);
+}
+
+/* CMD[/MASK] */
+static int snc_emu_command_mask(const char *s, u32 *cmd, u32 *mask)
+{
+	char buf[32];
+	char *slash;
+	unsigned long v;
+
+	if (strlen(s) >= sizeof(buf))
+		return -1;
+	strcpy(buf, s);
+
+	slash = strchr(buf, '/');
+	if (slash) {
+		*slash = '\0';
+		if (snc_emu_number(slash + 1, &v))
+			return -1;
+		*mask = v;
+	}
+	if (snc_emu_number(buf, &v))
+		return -1;
+	*cmd = v;
+
+	return 0;
+}
+
+static struct snc_emu_rule *snc_emu_rule_add(enum snc_emu_rule_type type)
+{
+	struct snc_emu_rule *r;
+
+	if (snc_emu_nrules == SNC_EMU_RULES)
+		return NULL;
+
+	r = &snc_emu_rules[snc_emu_nrules++];
+	memset(r, 0, sizeof(*r));
+	r->type = type;
+
+	return r;
+}
+
+static int snc_emu_handle_rule(int argc, char **argv, char *err,
+		size_t errlen)
+{
+	enum snc_emu_rule_type type;
+	struct snc_emu_rule *r;
+	unsigned long handle, v;
+	u32 cmd, mask;
+	int i;
+
+	if (!strcmp(argv[0], "reply"))
+		type = SNC_EMU_REPLY;
+	else if (!strcmp(argv[0], "store"))
+		type = SNC_EMU_STORE;
+	else if (!strcmp(argv[0], "fail"))
+		type = SNC_EMU_FAIL;
+	else
+		type = SNC_EMU_BUFFER;
+
+	if (argc < 3 || snc_emu_number(argv[1], &handle))
+		goto usage;
+	if ((type == SNC_EMU_REPLY && argc != 4) ||
+			(type == SNC_EMU_STORE && argc != 4 && argc != 5) ||
+			(type == SNC_EMU_FAIL && argc != 3))
+		goto usage;
+
+	mask = type == SNC_EMU_STORE ? 0xffff : 0xffffffff;
+	if (snc_emu_command_mask(argv[2], &cmd, &mask))
+		goto usage;
+
+	/* a rule given again replaces the previous one */
+	for (r = snc_emu_rules; r < snc_emu_rules + snc_emu_nrules; r++) {
+		if (r->type == type && r->handle == handle &&
+				r->cmd == cmd && r->mask == mask)
+			break;
+	}
+	if (r == snc_emu_rules + snc_emu_nrules)
+		r = snc_emu_rule_add(type);
+	if (!r) {
+		snprintf(err, errlen, "too many rules");
+		return -1;
+	}
+	r->handle = handle;
+	r->cmd = cmd;
+	r->mask = mask;
+	r->shift = 16;
+	r->len = 0;
+
+	switch (type) {
+	case SNC_EMU_REPLY:
+	case SNC_EMU_STORE:
+		if (snc_emu_number(argv[3], &v))
+			goto usage;
+		r->value = v;
+		if (argc == 5) {
+			if (snc_emu_number(argv[4], &v) || v > 31)
+				goto usage;
+			r->shift = v;
+		}
+		break;
+	case SNC_EMU_BUFFER:
+		for (i = 3; i < argc; i++) {
+			if (r->len == sizeof(r->data) ||
+					strict_strtoul(argv[i], 16, &v) ||
+					v > 0xff)
+				goto usage;
+			r->data[r->len++] = v;
+		}
+		break;
+	case SNC_EMU_FAIL:
+		break;
+	}
+
+	return 0;
+
+usage:
+	snprintf(err, errlen, "usage: %s HANDLE CMD[/MASK]%s", argv[0],
+			type == SNC_EMU_REPLY ? " VALUE" :
+			type == SNC_EMU_STORE ? " GETCMD [SHIFT]" :
+			type == SNC_EMU_BUFFER ? " HEXBYTES..." : "");
+	return -1;
+}
+
+static int __snc_emu_command(int argc, char **argv, char *err, size_t errlen)
+{
+	static const struct {
+		const char *name;
+		enum snc_emu_kind kind;
+	} snc[] = {
+		{ "SN00", SNC_EMU_SN00 },
+		{ "SN01", SNC_EMU_SN01 },
+		{ "SN02", SNC_EMU_SN02 },
+		{ "SN03", SNC_EMU_SN03 },
+		{ "SN05", SNC_EMU_SN05 },
+		{ "SN06", SNC_EMU_SN06 },
+		{ "SN07", SNC_EMU_SN07 },
+	};
+	struct snc_emu_method *m;
+	unsigned long v;
+	unsigned int i;
+
+	if (!strcmp(argv[0], "snc")) {
+		for (i = 0; i < ARRAY_SIZE(snc); i++) {
+			if (!snc_emu_method_add(snc[i].name, snc[i].kind))
+				goto full;
+		}
+		return 0;
+	}
+
+	if (!strcmp(argv[0], "method")) {
+		struct snc_emu_method *t = NULL;
+
+		if (argc < 2 || argc > 3)
+			goto usage;
+		if (argc == 3 && argv[2][0] == '=') {
+			t = snc_emu_method_find(argv[2] + 1);
+			if (!t) {
+				snprintf(err, errlen, "unknown method %s",
+						argv[2] + 1);
+				return -1;
+			}
+		} else if (argc == 3 && snc_emu_number(argv[2], &v)) {
+			goto usage;
+		}
+
+		m = snc_emu_method_add(argv[1], SNC_EMU_VALUE);
+		if (!m)
+			goto full;
+		if (t)
+			m->target = t - snc_emu_methods;
+		else if (argc == 3)
+			m->value = v;
+		return 0;
+	}
+
+	if (!strcmp(argv[0], "fail") && argc == 2) {
+		m = snc_emu_method_find(argv[1]);
+		if (!m) {
+			snprintf(err, errlen, "unknown method %s", argv[1]);
+			return -1;
+		}
+		m->fail = true;
+		return 0;
+	}
+
+	if (!strcmp(argv[0], "reply") || !strcmp(argv[0], "store") ||
+			!strcmp(argv[0], "fail") || !strcmp(argv[0], "buffer"))
+		return snc_emu_handle_rule(argc, argv, err, errlen);
+
+	if (!strcmp(argv[0], "model")) {
+		if (argc != 2 || strlen(argv[1]) > 16)
+			goto usage;
+		memset(snc_emu.model, 0, sizeof(snc_emu.model));
+		strcpy(snc_emu.model, argv[1]);
+		return 0;
+	}
+
+	if (!strcmp(argv[0], "model-id")) {
+		if (argc != 2 || snc_emu_number(argv[1], &v))
+			goto usage;
+		snc_emu.model_id = v;
+		return 0;
+	}
+
+	if (!strcmp(argv[0], "events")) {
+		if (argc != 2 || snc_emu_number(argv[1], &v))
+			goto usage;
+		snc_emu.events = v;
+		snc_emu.events_set = true;
+		return 0;
+	}
+
+	if (!strcmp(argv[0], "handles")) {
+		if (argc < 2 || argc > SNC_EMU_HANDLES + 1)
+			goto usage;
+		memset(snc_emu.handles, 0, sizeof(snc_emu.handles));
+		for (i = 1; i < (unsigned int) argc; i++) {
+			if (snc_emu_number(argv[i], &v) || v > 0xffff)
+				goto usage;
+			snc_emu.handles[i - 1] = v;
+		}
+		return 0;
+	}
+
+	if (!strcmp(argv[0], "latency")) {
+		unsigned long usec;
+
+		if (argc != 3 || snc_emu_number(argv[2], &usec))
+			goto usage;
+
+		if (!snc_emu_number(argv[1], &v)) {
+			int offset = snc_emu_offset(v);
+
+			if (!v || offset < 0) {
+				snprintf(err, errlen, "unknown handle %s",
+						argv[1]);
+				return -1;
+			}
+			snc_emu.latency[offset] = usec;
+			return 0;
+		}
+
+		m = snc_emu_method_find(argv[1]);
+		if (!m) {
+			snprintf(err, errlen, "unknown method %s", argv[1]);
+			return -1;
+		}
+		m->latency = usec;
+		return 0;
+	}
+
+	if (!strcmp(argv[0], "ec") || !strcmp(argv[0], "port")) {
+		unsigned long addr;
+		bool ec = argv[0][0] == 'e';
+
+		if (argc != 3 || snc_emu_number(argv[1], &addr) ||
+				addr > (ec ? 0xff : 0xffff) ||
+				snc_emu_number(argv[2], &v) || v > 0xff)
+			goto usage;
+		if (ec)
+			snc_emu.ec[addr] = v;
+		else
+			snc_emu.port[addr] = v;
+		return 0;
+	}
+
+	return 1;
+
+usage:
+	snprintf(err, errlen, "bad arguments to %s", argv[0]);
+	return -1;
+full:
+	snprintf(err, errlen, "too many methods");
+	return -1;
+}
+
+int snc_emu_command(int argc, char **argv, char *err, size_t errlen)
+{
+	int ret;
+
+	pthread_mutex_lock(&snc_emu_lock);
+	ret = __snc_emu_command(argc, argv, err, errlen);
+	pthread_mutex_unlock(&snc_emu_lock);
+
+	return ret;
+}
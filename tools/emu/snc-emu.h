@@ -0,0 +1,45 @@
+/*
+ * SNC/EC/SPIC emulator behind the driver backend
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef _SNC_EMU_H
+#define _SNC_EMU_H
+
+#include <linux/kernel.h>
+#include <linux/acpi.h>
+
+/*
+ * setup command of a scenario, argv[0] is the command name:
+ * returns 0 when applied, 1 when not an emulator command, -1 on error
+ */
+int snc_emu_command(int argc, char **argv, char *err, size_t errlen);
+void snc_emu_reset(void);
+
+/* the backend, see struct sony_laptop_backend */
+acpi_status snc_emu_evaluate(acpi_handle handle, char *name,
+		struct acpi_object_list *params, struct acpi_buffer *output);
+int snc_emu_ec_read(u8 addr, u8 *value);
+int snc_emu_ec_write(u8 addr, u8 value);
+u8 snc_emu_inb(unsigned long port);
+void snc_emu_outb(u8 value, unsigned long port);
+
+/* namespace lookups of the kernel side */
+acpi_handle snc_emu_device(void);
+acpi_status snc_emu_get_handle(acpi_handle parent, const char *name,
+		acpi_handle *handle);
+
+/* evaluations of a method (SN07:0x0122 counts a single handle) */
+unsigned long snc_emu_calls(const char *method);
+void snc_emu_calls_reset(void);
+/* SNC events enabled through SN02/SN03 */
+u32 snc_emu_events(void);
+/* evaluations that had no rule */
+unsigned long snc_emu_unhandled(void);
+/* SN07 register of a handle, as the last store left it */
+int snc_emu_register(unsigned int handle, u32 cmd, u32 *value);
+
+#endif /* _SNC_EMU_H */
@@ -0,0 +1,699 @@
+/*
+ * sony-bench: concurrent readers and writers on the sony-laptop sysfs
+ * attributes, reports per attribute ops/sec, p50/p99 latency and the
+ * contention on the EC access locks (debugfs lock_contention).
+ *
+ * Runs against the real platform device or, with -e, against the driver
+ * built in userspace on the SNC emulator, see README.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#include "../../sony-laptop.c"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "emu.h"
+#include "snc-emu.h"
+
+static const struct sony_laptop_backend snc_emu_backend = {
+	.evaluate = snc_emu_evaluate,
+	.ec_read = snc_emu_ec_read,
+	.ec_write = snc_emu_ec_write,
+	.inb = snc_emu_inb,
+	.outb = snc_emu_outb,
+};
+
+#define MAX_ATTRS	128
+#define MAX_THREADS	256
+#define MAX_LOCKS	32
+
+/* latency histogram, 16 linear sub-buckets per power of two (ns) */
+#define HIST_SUB_BITS	4
+#define HIST_SIZE	(64 << HIST_SUB_BITS)
+
+static unsigned int hist_index(u64 ns)
+{
+	unsigned int msb;
+
+	if (ns < (1 << HIST_SUB_BITS))
+		return ns;
+
+	msb = 63 - __builtin_clzll(ns);
+	return ((msb - HIST_SUB_BITS + 1) << HIST_SUB_BITS) |
+		((ns >> (msb - HIST_SUB_BITS)) & ((1 << HIST_SUB_BITS) - 1));
+}
+
+static u64 hist_value(unsigned int index)
+{
+	unsigned int major = index >> HIST_SUB_BITS;
+	u64 sub = index & ((1 << HIST_SUB_BITS) - 1);
+
+	if (!major)
+		return sub;
+
+	return (sub | (1 << HIST_SUB_BITS)) << (major - 1);
+}
+
+struct op_stats {
+	u64 ops;
+	u64 errors;
+	u64 hist[HIST_SIZE];
+};
+
+static void stats_add(struct op_stats *to, const struct op_stats *from)
+{
+	unsigned int i;
+
+	to->ops += from->ops;
+	to->errors += from->errors;
+	for (i = 0; i < HIST_SIZE; i++)
+		to->hist[i] += from->hist[i];
+}
+
+static double stats_percentile(const struct op_stats *st, unsigned int pct)
+{
+	u64 total = 0, seen = 0, rank;
+	unsigned int i;
+
+	for (i = 0; i < HIST_SIZE; i++)
+		total += st->hist[i];
+	if (!total)
+		return 0;
+
+	rank = (total * pct + 99) / 100;
+	for (i = 0; i < HIST_SIZE; i++) {
+		seen += st->hist[i];
+		if (seen >= rank)
+			break;
+	}
+
+	return hist_value(i) / 1000.0;
+}
+
+static struct attr {
+	char name[64];
+	char path[PATH_MAX];
+	char value[64];		/* written back by the writers */
+	bool writable;
+} attrs[MAX_ATTRS];
+static unsigned int nattrs;
+
+/* the selected attributes, all of them by default */
+static const char *selected[MAX_ATTRS];
+static unsigned int nselected;
+static const char *excluded[MAX_ATTRS] = {
+	"speed_stamina",	/* the write switches the GPU */
+};
+static unsigned int nexcluded = 1;
+
+static bool emulated;
+static const char *sysfs_dir = "/sys/devices/platform/sony-laptop";
+static const char *debugfs_dir = "/sys/kernel/debug/sony-laptop";
+static unsigned int readers = 4, writers = 1;
+static unsigned int duration_ms = 2000;
+static bool mixed;
+
+/*********** attribute access ***********/
+
+static ssize_t attr_read(struct attr *a, int fd, char *buffer, size_t size)
+{
+	ssize_t ret;
+
+	if (emulated) {
+		char page[PAGE_SIZE];
+
+		ret = emu_sysfs_show(a->name, page);
+		if (ret > 0) {
+			ret = min_t(size_t, ret, size - 1);
+			memcpy(buffer, page, ret);
+		}
+	} else {
+		ret = pread(fd, buffer, size - 1, 0);
+		if (ret < 0)
+			ret = -errno;
+	}
+	buffer[ret > 0 ? ret : 0] = '\0';
+
+	return ret;
+}
+
+static ssize_t attr_write(struct attr *a, int fd)
+{
+	size_t len = strlen(a->value);
+	ssize_t ret;
+
+	if (emulated)
+		return emu_sysfs_store(a->name, a->value, len);
+
+	ret = pwrite(fd, a->value, len, 0);
+
+	return ret < 0 ? -errno : ret;
+}
+
+static int attr_open(struct attr *a, bool write)
+{
+	if (emulated)
+		return 0;
+
+	return open(a->path, write ? O_WRONLY : O_RDONLY);
+}
+
+static bool listed(const char *name, const char **list, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i < n; i++) {
+		if (!strcmp(list[i], name))
+			return true;
+	}
+
+	return false;
+}
+
+static void attr_add(const char *name, const char *path, bool writable)
+{
+	struct attr *a;
+
+	if (nattrs == MAX_ATTRS || strlen(name) >= sizeof(a->name) ||
+			strlen(path) >= sizeof(a->path))
+		return;
+	if (nselected && !listed(name, selected, nselected))
+		return;
+	if (listed(name, excluded, nexcluded))
+		return;
+
+	a = &attrs[nattrs++];
+	strcpy(a->name, name);
+	strcpy(a->path, path);
+	a->writable = writable;
+}
+
+static void sysfs_scan_dir(const char *dir, const char *prefix)
+{
+	char path[PATH_MAX], name[NAME_MAX + 80];
+	struct dirent *d;
+	struct stat st;
+	DIR *dp = opendir(dir);
+
+	if (!dp)
+		return;
+
+	while ((d = readdir(dp))) {
+		if (!strcmp(d->d_name, "uevent") ||
+				!strcmp(d->d_name, "modalias"))
+			continue;
+
+		snprintf(path, sizeof(path), "%s/%s", dir, d->d_name);
+		if (stat(path, &st) || !S_ISREG(st.st_mode) ||
+				!(st.st_mode & S_IRUSR))
+			continue;
+
+		snprintf(name, sizeof(name), "%s%s", prefix, d->d_name);
+		attr_add(name, path, st.st_mode & S_IWUSR);
+	}
+	closedir(dp);
+}
+
+/* the platform device attributes and the state of the sony rfkills */
+static void sysfs_scan(void)
+{
+	char path[PATH_MAX], name[64], prefix[80];
+	struct dirent *d;
+	DIR *dp;
+	FILE *f;
+
+	sysfs_scan_dir(sysfs_dir, "");
+
+	dp = opendir("/sys/class/rfkill");
+	if (!dp)
+		return;
+
+	while ((d = readdir(dp))) {
+		if (d->d_name[0] == '.')
+			continue;
+
+		snprintf(path, sizeof(path), "/sys/class/rfkill/%s/name",
+				d->d_name);
+		f = fopen(path, "r");
+		if (!f)
+			continue;
+		if (fgets(name, sizeof(name), f) &&
+				!strncmp(name, "sony-", 5)) {
+			name[strcspn(name, "\n")] = '\0';
+			snprintf(path, sizeof(path), "/sys/class/rfkill/%s",
+					d->d_name);
+			snprintf(prefix, sizeof(prefix), "%s/", name);
+			sysfs_scan_dir(path, prefix);
+		}
+		fclose(f);
+	}
+	closedir(dp);
+}
+
+static void emu_scan(void)
+{
+	const char *names[MAX_ATTRS];
+	struct device_attribute *da;
+	unsigned int i, n;
+
+	n = emu_sysfs_list(names, MAX_ATTRS);
+	for (i = 0; i < n; i++) {
+		da = emu_sysfs_find(names[i], NULL);
+		if (da && da->show && (da->attr.mode & S_IRUGO))
+			attr_add(names[i], names[i],
+					da->store && (da->attr.mode & S_IWUGO));
+	}
+}
+
+/*
+ * the writers store the value read at start, the attributes whose value
+ * cannot be written back are only read
+ */
+static void attrs_prepare(void)
+{
+	char buffer[PAGE_SIZE];
+	unsigned int i;
+	ssize_t ret;
+	int fd;
+
+	for (i = 0; i < nattrs; i++) {
+		struct attr *a = &attrs[i];
+
+		if (!a->writable || !writers)
+			continue;
+
+		a->writable = false;
+		fd = attr_open(a, false);
+		if (fd < 0)
+			continue;
+		ret = attr_read(a, fd, buffer, sizeof(buffer));
+		if (!emulated)
+			close(fd);
+		if (ret <= 0 || strchr(buffer, '\n') != buffer + ret - 1 ||
+				ret >= (ssize_t) sizeof(a->value))
+			continue;
+		strcpy(a->value, buffer);
+
+		fd = attr_open(a, true);
+		if (fd < 0)
+			continue;
+		a->writable = attr_write(a, fd) == (ssize_t) strlen(a->value);
+		if (!emulated)
+			close(fd);
+	}
+}
+
+/*********** lock contention ***********/
+
+struct lock_snap {
+	unsigned int n;
+	struct {
+		char name[32];
+		unsigned long acquired;
+		unsigned long contended;
+		unsigned long long wait_us;
+	} lock[MAX_LOCKS];
+};
+
+static int lock_snapshot(struct lock_snap *snap)
+{
+	static char buffer[16 * PAGE_SIZE];
+	char *line, *save;
+	ssize_t len;
+
+	snap->n = 0;
+	if (emulated) {
+		len = emu_debugfs_read("lock_contention", buffer,
+				sizeof(buffer));
+	} else {
+		char path[PATH_MAX];
+		int fd;
+
+		snprintf(path, sizeof(path), "%s/lock_contention",
+				debugfs_dir);
+		fd = open(path, O_RDONLY);
+		if (fd < 0)
+			return -1;
+		len = read(fd, buffer, sizeof(buffer) - 1);
+		close(fd);
+		if (len >= 0)
+			buffer[len] = '\0';
+	}
+	if (len < 0)
+		return -1;
+
+	/* the first line is the header */
+	line = strtok_r(buffer, "\n", &save);
+	while ((line = strtok_r(NULL, "\n", &save)) && snap->n < MAX_LOCKS) {
+		if (sscanf(line, "%31s %lu %lu %llu",
+					snap->lock[snap->n].name,
+					&snap->lock[snap->n].acquired,
+					&snap->lock[snap->n].contended,
+					&snap->lock[snap->n].wait_us) == 4)
+			snap->n++;
+	}
+
+	return 0;
+}
+
+static void lock_report(const struct lock_snap *before,
+		const struct lock_snap *after)
+{
+	unsigned int i, j;
+
+	for (i = 0; i < after->n; i++) {
+		unsigned long acquired = after->lock[i].acquired;
+		unsigned long contended = after->lock[i].contended;
+		unsigned long long wait_us = after->lock[i].wait_us;
+
+		/* the counters may have been reset meanwhile */
+		for (j = 0; j < before->n; j++) {
+			if (strcmp(before->lock[j].name, after->lock[i].name) ||
+					before->lock[j].acquired > acquired)
+				continue;
+			acquired -= before->lock[j].acquired;
+			contended -= before->lock[j].contended;
+			wait_us -= before->lock[j].wait_us;
+			break;
+		}
+		if (!acquired)
+			continue;
+
+		printf("    lock %-12s acquired %-9lu contended %-9lu "
+				"(%5.1f%%) wait %llu us\n",
+				after->lock[i].name, acquired, contended,
+				100.0 * contended / acquired, wait_us);
+	}
+}
+
+/*********** load ***********/
+
+struct worker {
+	pthread_t thread;
+	unsigned int id;
+	bool writer;
+	unsigned int first, count;	/* attributes range */
+	int fds[MAX_ATTRS];
+	struct op_stats *stats;		/* per attribute of the range */
+};
+
+static bool stop;
+static pthread_barrier_t start_barrier;
+
+static u64 now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void *worker_run(void *arg)
+{
+	struct worker *w = arg;
+	char buffer[PAGE_SIZE];
+	unsigned int i, n = w->id;
+	u64 start;
+	ssize_t ret;
+
+	pthread_barrier_wait(&start_barrier);
+
+	while (!__atomic_load_n(&stop, __ATOMIC_RELAXED)) {
+		struct attr *a;
+		struct op_stats *st;
+
+		i = n++ % w->count;
+		a = &attrs[w->first + i];
+		st = &w->stats[i];
+		if (w->fds[i] < 0)
+			continue;
+
+		start = now_ns();
+		if (w->writer)
+			ret = attr_write(a, w->fds[i]);
+		else
+			ret = attr_read(a, w->fds[i], buffer, sizeof(buffer));
+
+		st->hist[hist_index(now_ns() - start)]++;
+		st->ops++;
+		if (ret < 0)
+			st->errors++;
+	}
+
+	return NULL;
+}
+
+static void print_stats(const char *what, unsigned int threads,
+		const struct op_stats *st, double seconds)
+{
+	printf("    %-5s x%-3u %10.0f ops/s  p50 %9.1f us  p99 %9.1f us",
+			what, threads, st->ops / seconds,
+			stats_percentile(st, 50), stats_percentile(st, 99));
+	if (st->errors)
+		printf("  %llu errors", (unsigned long long) st->errors);
+	printf("\n");
+}
+
+/* a phase: readers and writers on the attributes [first, first + count) */
+static void run_phase(unsigned int first, unsigned int count)
+{
+	static struct worker workers[MAX_THREADS];
+	struct lock_snap before, after;
+	unsigned int nwriters = 0, nthreads, i, t;
+	bool locks;
+	u64 start;
+	double seconds;
+
+	for (i = first; i < first + count; i++) {
+		if (attrs[i].writable)
+			nwriters = writers;
+	}
+	nthreads = readers + nwriters;
+
+	for (t = 0; t < nthreads; t++) {
+		struct worker *w = &workers[t];
+
+		w->id = t;
+		w->writer = t >= readers;
+		w->first = first;
+		w->count = count;
+		w->stats = calloc(count, sizeof(*w->stats));
+		if (!w->stats) {
+			perror("calloc");
+			exit(1);
+		}
+		for (i = 0; i < count; i++) {
+			w->fds[i] = -1;
+			if (!w->writer || attrs[first + i].writable)
+				w->fds[i] = attr_open(&attrs[first + i],
+						w->writer);
+		}
+	}
+
+	locks = !lock_snapshot(&before);
+	__atomic_store_n(&stop, false, __ATOMIC_RELAXED);
+	pthread_barrier_init(&start_barrier, NULL, nthreads + 1);
+	for (t = 0; t < nthreads; t++) {
+		if (pthread_create(&workers[t].thread, NULL, worker_run,
+					&workers[t])) {
+			perror("pthread_create");
+			exit(1);
+		}
+	}
+
+	pthread_barrier_wait(&start_barrier);
+	start = now_ns();
+	usleep(duration_ms * 1000);
+	__atomic_store_n(&stop, true, __ATOMIC_RELAXED);
+	for (t = 0; t < nthreads; t++)
+		pthread_join(workers[t].thread, NULL);
+	seconds = (now_ns() - start) / 1e9;
+	pthread_barrier_destroy(&start_barrier);
+	locks = locks && !lock_snapshot(&after);
+
+	for (i = 0; i < count; i++) {
+		struct op_stats *rd = calloc(1, sizeof(*rd));
+		struct op_stats *wr = calloc(1, sizeof(*wr));
+
+		for (t = 0; t < nthreads; t++)
+			stats_add(workers[t].writer ? wr : rd,
+					&workers[t].stats[i]);
+
+		printf("%s\n", attrs[first + i].name);
+		print_stats("read", readers, rd, seconds);
+		if (wr->ops)
+			print_stats("write", nwriters, wr, seconds);
+		free(rd);
+		free(wr);
+	}
+
+	if (locks) {
+		if (count > 1)
+			printf("all attributes\n");
+		lock_report(&before, &after);
+	}
+
+	for (t = 0; t < nthreads; t++) {
+		for (i = 0; i < count; i++) {
+			if (!emulated && workers[t].fds[i] >= 0)
+				close(workers[t].fds[i]);
+		}
+		free(workers[t].stats);
+	}
+}
+
+/*********** emulated device ***********/
+
+/* the firmware described by a scenario, up to its probe */
+static void emu_load(const char *script)
+{
+	char line[1024], err[128];
+	char *argv[97], *word, *save;
+	unsigned int lineno = 0;
+	int argc, ret;
+	FILE *f = fopen(script, "r");
+
+	if (!f) {
+		perror(script);
+		exit(2);
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+		lineno++;
+		line[strcspn(line, "#\n")] = '\0';
+
+		argc = 0;
+		for (word = strtok_r(line, " \t", &save); word && argc < 96;
+				word = strtok_r(NULL, " \t", &save))
+			argv[argc++] = word;
+		if (!argc)
+			continue;
+		argv[argc] = NULL;
+
+		if (!strcmp(argv[0], "probe"))
+			break;
+		if (!strcmp(argv[0], "param") && argc == 3)
+			ret = emu_param_set(argv[1], argv[2]) ? -1 : 0;
+		else
+			ret = snc_emu_command(argc, argv, err, sizeof(err));
+		if (ret) {
+			fprintf(stderr, "%s:%u: %s\n", script, lineno,
+				ret < 0 ? err : "not a firmware command");
+			exit(2);
+		}
+	}
+	fclose(f);
+
+	sony_backend = &snc_emu_backend;
+	emu_kernel_init();
+	if (emu_module_init(sony_laptop_init)) {
+		fprintf(stderr, "%s: the driver probe failed\n", script);
+		exit(1);
+	}
+	sony_nc_snc_sync();
+	emu_settle();
+}
+
+static void emu_unload(void)
+{
+	sony_laptop_exit();
+	emu_kernel_exit();
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s [-r READERS] [-w WRITERS] [-t MS] [-m] "
+		"[-a ATTR]... [-x ATTR]...\n"
+		"       [-e SCRIPT | -s SYSFS_DIR [-d DEBUGFS_DIR]]\n"
+		"  -r, -w  threads per attribute (4 readers, 1 writer)\n"
+		"  -t      duration of each attribute run (2000 ms)\n"
+		"  -m      a single run on all the attributes at once\n"
+		"  -a, -x  only, or never, benchmark ATTR\n"
+		"  -e      the emulated SNC described by a tools/emu script\n"
+		"  -s, -d  the device and debugfs directories\n", name);
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	const char *script = NULL;
+	unsigned int i;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "r:w:t:ma:x:e:s:d:v")) != -1) {
+		switch (opt) {
+		case 'r':
+			readers = atoi(optarg);
+			break;
+		case 'w':
+			writers = atoi(optarg);
+			break;
+		case 't':
+			duration_ms = atoi(optarg);
+			break;
+		case 'm':
+			mixed = true;
+			break;
+		case 'a':
+			if (nselected < MAX_ATTRS)
+				selected[nselected++] = optarg;
+			break;
+		case 'x':
+			if (nexcluded < MAX_ATTRS)
+				excluded[nexcluded++] = optarg;
+			break;
+		case 'e':
+			script = optarg;
+			break;
+		case 's':
+			sysfs_dir = optarg;
+			break;
+		case 'd':
+			debugfs_dir = optarg;
+			break;
+		case 'v':
+			emu_verbose++;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc || !readers || !duration_ms ||
+			readers + writers > MAX_THREADS)
+		usage(argv[0]);
+
+	if (script) {
+		emulated = true;
+		emu_load(script);
+		emu_scan();
+	} else {
+		sysfs_scan();
+	}
+	if (!nattrs) {
+		fprintf(stderr, "no attribute to benchmark\n");
+		return 1;
+	}
+	attrs_prepare();
+
+	printf("%u readers, %u writers, %u ms per run, %s\n", readers,
+			writers, duration_ms,
+			emulated ? script : sysfs_dir);
+	if (mixed) {
+		run_phase(0, nattrs);
+	} else {
+		for (i = 0; i < nattrs; i++)
+			run_phase(i, 1);
+	}
+
+	if (emulated)
+		emu_unload();
+
+	return 0;
+}